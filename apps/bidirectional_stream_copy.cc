@@ -3,129 +3,295 @@
 #include "byte_stream.hh"
 #include "eventloop.hh"
 
+#include "exception.hh"
+
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <fcntl.h>
+#include <functional>
 #include <iostream>
+#include <optional>
+#include <sys/stat.h>
 #include <unistd.h>
 
 using namespace std;
 
-void bidirectional_stream_copy( Socket& socket, string_view peer_name )
+namespace {
+constexpr size_t buffer_size = 1048576;
+
+// Splice only works between descriptors the kernel can move pages through (not ttys or other character devices)
+bool kernel_backed( const FileDescriptor& fd )
 {
-  constexpr size_t buffer_size = 1048576;
+  struct stat st {};
+  if ( fstat( fd.fd_num(), &st ) < 0 ) {
+    return false;
+  }
+  return S_ISSOCK( st.st_mode ) or S_ISFIFO( st.st_mode ) or S_ISREG( st.st_mode );
+}
 
-  EventLoop _eventloop {};
-  FileDescriptor _input { STDIN_FILENO };
-  FileDescriptor _output { STDOUT_FILENO };
-  ByteStream _outbound { buffer_size };
-  ByteStream _inbound { buffer_size };
-  bool _outbound_shutdown { false };
-  bool _inbound_shutdown { false };
+// One direction of the copy (stdin to socket, or socket to stdout)
+struct Channel
+{
+  std::string name;
+  FileDescriptor& source;
+  FileDescriptor& sink;
+  std::function<void()> finish; // called once everything from `source` has been written to `sink`
 
-  socket.set_blocking( false );
-  _input.set_blocking( false );
-  _output.set_blocking( false );
+  // buffered path: source -> ByteStream -> sink
+  ByteStream buffer { buffer_size };
 
-  // rule 1: read from stdin into outbound byte stream
-  _eventloop.add_rule(
-    "read from stdin into outbound byte stream",
-    _input,
+  // zero-copy path: source -> pipe -> sink, with the pipe occupancy tracked here
+  std::optional<std::pair<FileDescriptor, FileDescriptor>> pipe {};
+  size_t pipe_capacity {};
+  size_t in_pipe {};
+  bool pipe_full {};
+  bool source_finished {};
+  bool sink_finished {};
+
+  // throughput and syscall accounting for the copy itself (not counting poll)
+  uint64_t bytes_copied {};
+  uint64_t syscalls {};
+  chrono::steady_clock::time_point started { chrono::steady_clock::now() };
+  chrono::steady_clock::time_point finished {};
+
+  void open_pipe()
+  {
+    array<int, 2> fds {};
+    CheckSystemCall( "pipe2", ::pipe2( fds.data(), O_NONBLOCK | O_CLOEXEC ) );
+    pipe.emplace( FileDescriptor { fds[0] }, FileDescriptor { fds[1] } );
+
+    // ask for a pipe as large as the ByteStream (may be refused above /proc/sys/fs/pipe-max-size)
+    fcntl( fds[1], F_SETPIPE_SZ, static_cast<int>( buffer_size ) ); // NOLINT(*-vararg)
+    pipe_capacity = CheckSystemCall( "fcntl", fcntl( fds[1], F_GETPIPE_SZ ) ); // NOLINT(*-vararg)
+  }
+
+  void report() const
+  {
+    const auto end = sink_finished ? finished : chrono::steady_clock::now();
+    const double seconds = chrono::duration<double>( end - started ).count();
+    const double megabytes = static_cast<double>( bytes_copied ) / 1048576.0;
+    cerr << "DEBUG: " << name << ( pipe ? " (splice): " : " (buffered): " ) << bytes_copied << " bytes in "
+         << seconds << " s";
+    if ( seconds > 0 ) {
+      cerr << ", " << megabytes / seconds << " MB/s";
+    }
+    cerr << ", " << syscalls << " syscalls";
+    if ( megabytes > 0 ) {
+      cerr << " (" << static_cast<double>( syscalls ) / megabytes << " per MB)";
+    }
+    cerr << ".\n";
+  }
+};
+
+void add_buffered_rules( EventLoop& eventloop, Channel& ch, bool& error )
+{
+  eventloop.add_rule(
+    "read from " + ch.name + " source into byte stream",
+    ch.source,
     Direction::In,
     [&] {
-      string data;
-      data.resize( _outbound.writer().available_capacity() );
-      _input.read( data );
-      _outbound.writer().push( move( data ) );
-      if ( _input.eof() ) {
-        _outbound.writer().close();
+      ch.buffer.writer().read_from( ch.source );
+      ++ch.syscalls;
+      if ( ch.source.eof() ) {
+        ch.buffer.writer().close();
       }
     },
     [&] {
-      return !_outbound.has_error() and !_inbound.has_error() and ( _outbound.writer().available_capacity() > 0 )
-             and !_outbound.writer().is_closed();
+      return !error and ( ch.buffer.writer().available_capacity() > 0 ) and !ch.buffer.writer().is_closed();
     },
-    [&] { _outbound.writer().close(); },
+    [&] { ch.buffer.writer().close(); },
     [&] {
-      cerr << "DEBUG: Outbound stream had error from source.\n";
-      _outbound.set_error();
-      _inbound.set_error();
+      cerr << "DEBUG: " << ch.name << " stream had error from source.\n";
+      error = true;
     } );
 
-  // rule 2: read from outbound byte stream into socket
-  _eventloop.add_rule(
-    "read from outbound byte stream into socket",
-    socket,
+  eventloop.add_rule(
+    "read from " + ch.name + " byte stream into sink",
+    ch.sink,
     Direction::Out,
     [&] {
-      if ( _outbound.reader().bytes_buffered() ) {
-        _outbound.reader().pop( socket.write( _outbound.reader().peek() ) );
+      ch.bytes_copied += ch.buffer.reader().write_to( ch.sink );
+      ++ch.syscalls;
+      if ( ch.buffer.reader().is_finished() ) {
+        ch.sink_finished = true;
+        ch.finished = chrono::steady_clock::now();
+        ch.finish();
       }
-      if ( _outbound.reader().is_finished() ) {
-        socket.shutdown( SHUT_WR );
-        _outbound_shutdown = true;
-        cerr << "DEBUG: Outbound stream to " << peer_name << " finished.\n";
+    },
+    [&] {
+      return ch.buffer.reader().bytes_buffered() or ( ch.buffer.reader().is_finished() and not ch.sink_finished );
+    },
+    [&] { ch.buffer.writer().close(); },
+    [&] {
+      cerr << "DEBUG: " << ch.name << " stream had error from destination.\n";
+      error = true;
+    } );
+}
+
+void add_splice_rules( EventLoop& eventloop, Channel& ch, bool& error )
+{
+  eventloop.add_rule(
+    "splice from " + ch.name + " source into pipe",
+    ch.source,
+    Direction::In,
+    [&] {
+      const size_t moved = ch.source.splice_to( ch.pipe->second, ch.pipe_capacity - ch.in_pipe );
+      ++ch.syscalls;
+      ch.in_pipe += moved;
+      if ( ch.source.eof() ) {
+        ch.source_finished = true;
+      } else if ( moved == 0 and ch.in_pipe > 0 ) {
+        // a partly-filled pipe can run out of page slots before it reaches pipe_capacity bytes
+        ch.pipe_full = true;
       }
     },
+    [&] { return !error and !ch.source_finished and !ch.pipe_full and ( ch.in_pipe < ch.pipe_capacity ); },
+    [&] { ch.source_finished = true; },
+    [&] {
+      cerr << "DEBUG: " << ch.name << " stream had error from source.\n";
+      error = true;
+    } );
+
+  eventloop.add_rule(
+    "splice from " + ch.name + " pipe into sink",
+    ch.sink,
+    Direction::Out,
     [&] {
-      return _outbound.reader().bytes_buffered() or ( _outbound.reader().is_finished() and not _outbound_shutdown );
+      if ( ch.in_pipe > 0 ) {
+        const size_t moved = ch.pipe->first.splice_to( ch.sink, ch.in_pipe );
+        ++ch.syscalls;
+        ch.in_pipe -= moved;
+        ch.bytes_copied += moved;
+        ch.pipe_full = ch.pipe_full and moved == 0;
+      }
+      if ( ch.source_finished and ch.in_pipe == 0 ) {
+        ch.sink_finished = true;
+        ch.finished = chrono::steady_clock::now();
+        ch.finish();
+      }
     },
-    [&] { _outbound.writer().close(); },
+    [&] { return !error and ( ch.in_pipe > 0 or ( ch.source_finished and not ch.sink_finished ) ); },
+    [&] { ch.source_finished = true; },
     [&] {
-      cerr << "DEBUG: Outbound stream had error from destination.\n";
-      _outbound.set_error();
-      _inbound.set_error();
+      cerr << "DEBUG: " << ch.name << " stream had error from destination.\n";
+      error = true;
     } );
+}
+} // namespace
+
+void bidirectional_stream_copy( Socket& socket, string_view peer_name, bool zero_copy )
+{
+  EventLoop _eventloop {};
+  FileDescriptor _input { STDIN_FILENO };
+  FileDescriptor _output { STDOUT_FILENO };
+  bool _error { false };
+
+  socket.set_blocking( false );
+  _input.set_blocking( false );
+  _output.set_blocking( false );
+
+  Channel _outbound { "Outbound", _input, socket, [&] {
+                       socket.shutdown( SHUT_WR );
+                       cerr << "DEBUG: Outbound stream to " << peer_name << " finished.\n";
+                     } };
+  Channel _inbound { "Inbound", socket, _output, [&] {
+                      _output.close();
+                      cerr << "DEBUG: Inbound stream from " << peer_name << " finished"
+                           << ( _error ? " uncleanly.\n" : ".\n" );
+                    } };
+
+  for ( auto* ch : { &_outbound, &_inbound } ) {
+    // each direction independently falls back to the ByteStream path (e.g. when stdin or stdout is a terminal)
+    if ( zero_copy and kernel_backed( ch->source ) and kernel_backed( ch->sink ) ) {
+      ch->open_pipe();
+      add_splice_rules( _eventloop, *ch, _error );
+    } else {
+      add_buffered_rules( _eventloop, *ch, _error );
+    }
+  }
+
+  // loop until completion
+  while ( true ) {
+    if ( EventLoop::Result::Exit == _eventloop.wait_next_event( -1 ) ) {
+      break;
+    }
+  }
+
+  _outbound.report();
+  _inbound.report();
+}
 
-  // rule 3: read from socket into inbound byte stream
+void bidirectional_stream_copy( SPSCByteStream& outbound, SPSCByteStream& inbound, string_view peer_name )
+{
+  EventLoop _eventloop {};
+  FileDescriptor _input { STDIN_FILENO };
+  FileDescriptor _output { STDOUT_FILENO };
+  bool _inbound_shutdown { false };
+
+  _input.set_blocking( false );
+  _output.set_blocking( false );
+
+  // rule 1: read from stdin into the shared outbound stream
   _eventloop.add_rule(
-    "read from socket into inbound byte stream",
-    socket,
+    "read from stdin into outbound stream",
+    _input,
     Direction::In,
     [&] {
-      string data;
-      data.resize( _inbound.writer().available_capacity() );
-      socket.read( data );
-      _inbound.writer().push( move( data ) );
-      if ( socket.eof() ) {
-        _inbound.writer().close();
+      outbound.read_from( _input );
+      if ( _input.eof() ) {
+        outbound.close();
       }
     },
     [&] {
-      return !_inbound.has_error() and !_outbound.has_error() and ( _inbound.writer().available_capacity() > 0 )
-             and !_inbound.writer().is_closed();
+      return !outbound.has_error() and !inbound.has_error() and ( outbound.available_capacity() > 0 )
+             and !outbound.is_closed();
     },
-    [&] { _inbound.writer().close(); },
+    [&] { outbound.close(); },
     [&] {
-      cerr << "DEBUG: Inbound stream had error from source.\n";
-      _outbound.set_error();
-      _inbound.set_error();
+      cerr << "DEBUG: Outbound stream had error from source.\n";
+      outbound.set_error();
+      inbound.set_error();
     } );
 
-  // rule 4: read from inbound byte stream into stdout
+  // rule 2: wake up when the TCP thread frees space in a full outbound stream
   _eventloop.add_rule(
-    "read from inbound byte stream into stdout",
+    "outbound stream has space",
+    outbound.space_event(),
+    Direction::In,
+    [&] { SPSCByteStream::clear_event( outbound.space_event() ); },
+    [&] { return !outbound.is_closed() and !outbound.has_error(); } );
+
+  // rule 3: write from the shared inbound stream into stdout
+  _eventloop.add_rule(
+    "read from inbound stream into stdout",
     _output,
     Direction::Out,
     [&] {
-      if ( _inbound.reader().bytes_buffered() ) {
-        _inbound.reader().pop( _output.write( _inbound.reader().peek() ) );
-      }
-      if ( _inbound.reader().is_finished() ) {
+      inbound.write_to( _output );
+      if ( inbound.is_finished() ) {
         _output.close();
         _inbound_shutdown = true;
         cerr << "DEBUG: Inbound stream from " << peer_name << " finished"
-             << ( _inbound.has_error() ? " uncleanly.\n" : ".\n" );
+             << ( inbound.has_error() ? " uncleanly.\n" : ".\n" );
       }
     },
-    [&] {
-      return _inbound.reader().bytes_buffered() or ( _inbound.reader().is_finished() and not _inbound_shutdown );
-    },
-    [&] { _inbound.writer().close(); },
+    [&] { return inbound.bytes_buffered() or ( inbound.is_finished() and not _inbound_shutdown ); },
+    [&] { inbound.set_error(); },
     [&] {
       cerr << "DEBUG: Inbound stream had error from destination.\n";
-      _outbound.set_error();
-      _inbound.set_error();
+      outbound.set_error();
+      inbound.set_error();
     } );
 
+  // rule 4: wake up when the TCP thread pushes into an empty inbound stream (or closes it)
+  _eventloop.add_rule(
+    "inbound stream has data",
+    inbound.data_event(),
+    Direction::In,
+    [&] { SPSCByteStream::clear_event( inbound.data_event() ); },
+    [&] { return not _inbound_shutdown; } );
+
   // loop until completion
   while ( true ) {
     if ( EventLoop::Result::Exit == _eventloop.wait_next_event( -1 ) ) {
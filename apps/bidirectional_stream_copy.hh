@@ -1,6 +1,12 @@
 #pragma once
 
 #include "socket.hh"
+#include "spsc_byte_stream.hh"
 
-//! Copy socket input/output to stdin/stdout until finished
-void bidirectional_stream_copy( Socket& socket, std::string_view peer_name );
+//! Copy socket input/output to stdin/stdout until finished, then report throughput and syscalls per MB.
+//! With `zero_copy`, each direction whose ends are both kernel-backed (socket, pipe or file) is moved with
+//! splice(2) through an intermediate pipe instead of through a ByteStream.
+void bidirectional_stream_copy( Socket& socket, std::string_view peer_name, bool zero_copy = false );
+
+//! Copy stdin into `outbound` and `inbound` to stdout until finished (for a TCPMinnowSocket in direct mode)
+void bidirectional_stream_copy( SPSCByteStream& outbound, SPSCByteStream& inbound, std::string_view peer_name );
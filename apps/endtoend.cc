@@ -5,9 +5,12 @@
 #include "router.hh"
 #include "tcp_minnow_socket_impl.hh"
 #include "tcp_over_ip.hh"
+#include "tcp_segment.hh"
 
+#include <cstdint>
 #include <cstdlib>
 #include <iostream>
+#include <string>
 #include <thread>
 #include <utility>
 
@@ -65,6 +68,32 @@ string summary( const EthernetFrame& frame )
   return out;
 }
 
+// The TCP segments a host sends: those that occupy sequence numbers (data, SYN or FIN), and bare ACKs
+struct SegmentCounts
+{
+  uint64_t data {};
+  uint64_t acks {};
+
+  void count( const EthernetFrame& frame )
+  {
+    InternetDatagram dgram;
+    TCPSegment seg;
+    if ( frame.header.type != EthernetHeader::TYPE_IPv4 or not parse( dgram, frame.payload )
+         or dgram.header.proto != IPv4Header::PROTO_TCP
+         or not parse( seg, dgram.payload, dgram.header.pseudo_checksum() ) ) {
+      return;
+    }
+    ++( seg.message.sender.sequence_length() > 0 ? data : acks );
+  }
+
+  string to_string() const
+  {
+    const double ratio = data ? static_cast<double>( acks ) / static_cast<double>( data ) : 0;
+    return std::to_string( data ) + " segments with data and " + std::to_string( acks )
+           + " bare ACKs (ack-to-data ratio " + std::to_string( ratio ) + ")";
+  }
+};
+
 optional<EthernetFrame> maybe_receive_frame( FileDescriptor& fd )
 {
   vector<string> strs( 3 );
@@ -132,7 +161,12 @@ public:
     _interface.datagrams_received().pop();
     return unwrap_tcp_in_ip( dgram );
   }
-  void write( const TCPMessage& msg ) { _interface.send_datagram( wrap_tcp_in_ip( msg ), _next_hop ); }
+  void write( const TCPMessage& msg )
+  {
+    for ( const auto& dgram : wrap_tcp_in_ip( msg ) ) {
+      _interface.send_datagram( dgram, _next_hop );
+    }
+  }
   void tick( const size_t ms_since_last_tick ) { _interface.tick( ms_since_last_tick ); }
   NetworkInterface& interface() { return _interface; }
 
@@ -143,11 +177,13 @@ public:
 class TCPSocketEndToEnd : public TCPMinnowSocket<NetworkInterfaceAdapter>
 {
   Address _local_address;
+  TCPConfig _tcp_config;
 
 public:
-  TCPSocketEndToEnd( const Address& ip_address, const Address& next_hop )
+  TCPSocketEndToEnd( const Address& ip_address, const Address& next_hop, const TCPConfig& tcp_config )
     : TCPMinnowSocket<NetworkInterfaceAdapter>( NetworkInterfaceAdapter( ip_address, next_hop ) )
     , _local_address( ip_address )
+    , _tcp_config( tcp_config )
   {}
 
   void connect( const Address& address )
@@ -159,7 +195,7 @@ public:
     multiplexer_config.source = _local_address;
     multiplexer_config.destination = address;
 
-    TCPMinnowSocket<NetworkInterfaceAdapter>::connect( {}, multiplexer_config );
+    TCPMinnowSocket<NetworkInterfaceAdapter>::connect( _tcp_config, multiplexer_config );
   }
 
   void bind( const Address& address )
@@ -174,14 +210,18 @@ public:
   {
     FdAdapterConfig multiplexer_config;
     multiplexer_config.source = _local_address;
-    TCPMinnowSocket<NetworkInterfaceAdapter>::listen_and_accept( {}, multiplexer_config );
+    TCPMinnowSocket<NetworkInterfaceAdapter>::listen_and_accept( _tcp_config, multiplexer_config );
   }
 
   NetworkInterfaceAdapter& adapter() { return _datagram_adapter; }
 };
 
 // NOLINTBEGIN(*-cognitive-complexity)
-void program_body( bool is_client, const string& bounce_host, const string& bounce_port, const bool debug )
+void program_body( bool is_client,
+                   const string& bounce_host,
+                   const string& bounce_port,
+                   const bool debug,
+                   const bool delayed_ack )
 {
   class FramesOut : public NetworkInterface::OutputPort
   {
@@ -230,8 +270,13 @@ void program_body( bool is_client, const string& bounce_host, const string& boun
   }
 
   /* set up the client */
-  TCPSocketEndToEnd sock = is_client ? TCPSocketEndToEnd { Address { "192.168.0.50" }, Address { "192.168.0.1" } }
-                                     : TCPSocketEndToEnd { Address { "172.16.0.100" }, Address { "172.16.0.1" } };
+  TCPConfig tcp_config;
+  tcp_config.delayed_ack = delayed_ack;
+  TCPSocketEndToEnd sock
+    = is_client ? TCPSocketEndToEnd { Address { "192.168.0.50" }, Address { "192.168.0.1" }, tcp_config }
+                : TCPSocketEndToEnd { Address { "172.16.0.100" }, Address { "172.16.0.1" }, tcp_config };
+
+  SegmentCounts sent;
 
   atomic<bool> exit_flag {};
 
@@ -249,6 +294,7 @@ void program_body( bool is_client, const string& bounce_host, const string& boun
         if ( debug ) {
           cerr << "     Host->router:     " << summary( frame ) << "\n";
         }
+        sent.count( frame );
         router.interface( host_side )->recv_frame( frame );
         router.route();
       } );
@@ -332,13 +378,14 @@ void program_body( bool is_client, const string& bounce_host, const string& boun
   exit_flag = true;
   network_thread.join();
   cerr << "done.\n";
+  cerr << "Sent " << sent.to_string() << ( delayed_ack ? ", with" : ", without" ) << " delayed ACKs.\n";
 }
 // NOLINTEND(*-cognitive-complexity)
 
 void print_usage( const string& argv0 )
 {
-  cerr << "Usage: " << argv0 << " client HOST PORT [debug]\n";
-  cerr << "or     " << argv0 << " server HOST PORT [debug]\n";
+  cerr << "Usage: " << argv0 << " client HOST PORT [debug] [delayed-ack]\n";
+  cerr << "or     " << argv0 << " server HOST PORT [debug] [delayed-ack]\n";
 }
 
 int main( int argc, char* argv[] )
@@ -354,17 +401,30 @@ int main( int argc, char* argv[] )
       abort(); // For sticklers: don't try to access argv[0] if argc <= 0.
     }
 
-    if ( argc != 4 and argc != 5 ) {
+    if ( argc < 4 or argc > 6 ) {
       print_usage( args[0] );
       return EXIT_FAILURE;
     }
 
+    bool debug = false;
+    bool delayed_ack = false;
+    for ( const char* option : args.subspan( 4 ) ) {
+      if ( option == "debug"s ) {
+        debug = true;
+      } else if ( option == "delayed-ack"s ) {
+        delayed_ack = true;
+      } else {
+        print_usage( args[0] );
+        return EXIT_FAILURE;
+      }
+    }
+
     if ( args[1] != "client"s and args[1] != "server"s ) {
       print_usage( args[0] );
       return EXIT_FAILURE;
     }
 
-    program_body( args[1] == "client"s, args[2], args[3], argc == 5 );
+    program_body( args[1] == "client"s, args[2], args[3], debug, delayed_ack );
   } catch ( const exception& e ) {
     cerr << e.what() << "\n";
     return EXIT_FAILURE;
@@ -31,12 +31,21 @@ void show_usage( const char* argv0, const char* msg )
        << "   -s <port>       Set source port (client mode only)              (random)\n\n"
 
        << "   -w <winsz>      Use a window of <winsz> bytes                   " << TCPConfig::MAX_PAYLOAD_SIZE
-       << "\n\n"
+       << "\n"
+       << "   -A              Autotune the receive buffer: start small, and   (off)\n"
+       << "                   grow up to <winsz> as fast as data is read.\n\n"
 
        << "   -t <tmout>      Set rt_timeout to tmout                         " << TCPConfig::TIMEOUT_DFLT << "\n\n"
 
        << "   -d <tundev>     Connect to tun <tundev>                         " << TUN_DFLT << "\n\n"
 
+       << "   -G              Segmentation offload: the sender emits up to    (off)\n"
+       << "                   " << TCPConfig::MAX_GSO_PAYLOAD_SIZE << " bytes per message, split into\n"
+       << "                   datagrams on the way out.\n\n"
+
+       << "   -D              Hand data to the TCP thread through shared      (socket pair)\n"
+       << "                   lock-free rings instead of a socket pair.\n\n"
+
        << "   -Lu <loss>      Set uplink loss to <rate> (float in 0..1)       (no loss)\n"
        << "   -Ld <loss>      Set downlink loss to <rate> (float in 0..1)     (no loss)\n\n"
 
@@ -56,7 +65,7 @@ void check_argc( const span<char*>& args, size_t curr, const char* err )
   }
 }
 
-tuple<TCPConfig, FdAdapterConfig, bool, const char*> get_config( const span<char*>& args )
+tuple<TCPConfig, FdAdapterConfig, bool, bool, const char*> get_config( const span<char*>& args )
 {
   TCPConfig c_fsm {};
   c_fsm.isn = Wrap32 { random_device()() };
@@ -66,6 +75,7 @@ tuple<TCPConfig, FdAdapterConfig, bool, const char*> get_config( const span<char
 
   size_t curr = 1;
   bool listen = false;
+  bool direct = false;
   const size_t argc = args.size();
 
   string source_address = LOCAL_ADDRESS_DFLT;
@@ -76,6 +86,18 @@ tuple<TCPConfig, FdAdapterConfig, bool, const char*> get_config( const span<char
       listen = true;
       curr += 1;
 
+    } else if ( strncmp( "-D", args[curr], 3 ) == 0 ) {
+      direct = true;
+      curr += 1;
+
+    } else if ( strncmp( "-G", args[curr], 3 ) == 0 ) {
+      c_fsm.segmentation_offload = true;
+      curr += 1;
+
+    } else if ( strncmp( "-A", args[curr], 3 ) == 0 ) {
+      c_fsm.recv_autotuning = true;
+      curr += 1;
+
     } else if ( strncmp( "-a", args[curr], 3 ) == 0 ) {
       check_argc( args, curr, "ERROR: -a requires one argument." );
       source_address = args[curr + 1];
@@ -139,7 +161,7 @@ tuple<TCPConfig, FdAdapterConfig, bool, const char*> get_config( const span<char
     c_filt.source = { source_address, source_port };
   }
 
-  return make_tuple( c_fsm, c_filt, listen, tundev );
+  return make_tuple( c_fsm, c_filt, listen, direct, tundev );
 }
 } // namespace
 
@@ -157,17 +179,26 @@ int main( int argc, char** argv )
       return EXIT_FAILURE;
     }
 
-    auto [c_fsm, c_filt, listen, tun_dev_name] = get_config( args );
+    auto [c_fsm, c_filt, listen, direct, tun_dev_name] = get_config( args );
     LossyTCPOverIPv4MinnowSocket tcp_socket( LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>(
       TCPOverIPv4OverTunFdAdapter( TunFD( tun_dev_name == nullptr ? TUN_DFLT : tun_dev_name ) ) ) );
 
+    if ( direct ) {
+      tcp_socket.enable_direct_streams();
+    }
+
     if ( listen ) {
       tcp_socket.listen_and_accept( c_fsm, c_filt );
     } else {
       tcp_socket.connect( c_fsm, c_filt );
     }
 
-    bidirectional_stream_copy( tcp_socket, tcp_socket.peer_address().to_string() );
+    if ( direct ) {
+      bidirectional_stream_copy(
+        tcp_socket.outbound_stream(), tcp_socket.inbound_stream(), tcp_socket.peer_address().to_string() );
+    } else {
+      bidirectional_stream_copy( tcp_socket, tcp_socket.peer_address().to_string() );
+    }
     tcp_socket.wait_until_closed();
   } catch ( const exception& e ) {
     cerr << "Exception: " << e.what() << endl;
@@ -9,8 +9,9 @@ using namespace std;
 
 void show_usage( const char* argv0 )
 {
-  cerr << "Usage: " << argv0 << " [-l] <host> <port>\n\n"
-       << "  -l specifies listen mode; <host>:<port> is the listening address." << endl;
+  cerr << "Usage: " << argv0 << " [-l] [-z] <host> <port>\n\n"
+       << "  -l specifies listen mode; <host>:<port> is the listening address.\n"
+       << "  -z moves data with splice(2) when stdin/stdout are pipes, sockets or files." << endl;
 }
 
 int main( int argc, char** argv )
@@ -23,18 +24,32 @@ int main( int argc, char** argv )
     auto args = span( argv, argc );
 
     bool server_mode = false;
-    // NOLINTNEXTLINE(bugprone-assignment-*)
-    if ( argc < 3 || ( ( server_mode = ( strncmp( "-l", args[1], 3 ) == 0 ) ) && argc < 4 ) ) {
+    bool zero_copy = false;
+    size_t curr = 1;
+    for ( ; curr < args.size() && args[curr][0] == '-'; ++curr ) {
+      if ( strncmp( "-l", args[curr], 3 ) == 0 ) {
+        server_mode = true;
+      } else if ( strncmp( "-z", args[curr], 3 ) == 0 ) {
+        zero_copy = true;
+      } else {
+        show_usage( args[0] );
+        return EXIT_FAILURE;
+      }
+    }
+
+    if ( args.size() - curr != 2 ) {
       show_usage( args[0] );
       return EXIT_FAILURE;
     }
+    const char* host = args[curr];
+    const char* port = args[curr + 1];
 
     // in client mode, connect; in server mode, accept exactly one connection
     auto socket = [&] {
       if ( server_mode ) {
         TCPSocket listening_socket;                    // create a TCP socket
         listening_socket.set_reuseaddr();              // reuse the server's address as soon as the program quits
-        listening_socket.bind( { args[2], args[3] } ); // bind to specified address
+        listening_socket.bind( { host, port } );       // bind to specified address
         listening_socket.listen();                     // mark the socket as listening for incoming connections
         cerr << "DEBUG: Listening for incoming connection...\n";
         TCPSocket connected_socket = listening_socket.accept();
@@ -42,14 +57,14 @@ int main( int argc, char** argv )
         return connected_socket;
       }
       TCPSocket connecting_socket;
-      const Address peer { args[1], args[2] };
+      const Address peer { host, port };
       cerr << "DEBUG: Connecting to " << peer.to_string() << "... ";
       connecting_socket.connect( peer );
       cerr << "DEBUG: Successfully connected to " << connecting_socket.peer_address().to_string() << ".\n";
       return connecting_socket;
     }();
 
-    bidirectional_stream_copy( socket, socket.peer_address().to_string() );
+    bidirectional_stream_copy( socket, socket.peer_address().to_string(), zero_copy );
   } catch ( const exception& e ) {
     cerr << "Exception: " << e.what() << endl;
     return EXIT_FAILURE;
@@ -26,6 +26,13 @@ ttest(byte_stream_one_write)
 ttest(byte_stream_two_writes)
 ttest(byte_stream_many_writes)
 ttest(byte_stream_stress_test)
+ttest(byte_stream_chunked)
+ttest(byte_stream_spill)
+ttest(byte_stream_resize)
+ttest(byte_stream_spsc)
+ttest(connection_table)
+ttest(syn_cookies)
+ttest(timer_wheel)
 
 ttest(reassembler_single)
 ttest(reassembler_cap)
@@ -34,6 +41,8 @@ ttest(reassembler_dup)
 ttest(reassembler_holes)
 ttest(reassembler_overlapping)
 ttest(reassembler_win)
+ttest(reassembler_bitmap)
+ttest(reassembler_budget)
 
 ttest(wrapping_integers_cmp)
 ttest(wrapping_integers_wrap)
@@ -48,6 +57,9 @@ ttest(recv_reorder)
 ttest(recv_reorder_more)
 ttest(recv_close)
 ttest(recv_special)
+ttest(recv_sack)
+ttest(recv_window_scale)
+ttest(recv_autotune)
 
 ttest(send_connect)
 ttest(send_transmit)
@@ -56,6 +68,17 @@ ttest(send_window)
 ttest(send_ack)
 ttest(send_close)
 ttest(send_extra)
+ttest(send_rto)
+ttest(send_fast_retx)
+ttest(send_sack)
+ttest(send_mss)
+ttest(tcp_segment_sack)
+ttest(tcp_over_ip_gso)
+ttest(tcp_window_scale)
+ttest(tcp_recv_autotune)
+ttest(tcp_delayed_ack)
+ttest(tcp_stack)
+ttest(tcp_listener)
 
 ttest(net_interface)
 
@@ -95,3 +118,10 @@ set_tests_properties(${compile_name_opt} PROPERTIES FIXTURES_SETUP compile_opt)
 
 stest(byte_stream_speed_test)
 stest(reassembler_speed_test)
+stest(tcp_congestion_speed_test)
+stest(tcp_sack_speed_test)
+stest(tcp_gso_speed_test)
+stest(tcp_pmtu_speed_test)
+stest(tcp_listener_speed_test)
+stest(tcp_syn_flood_speed_test)
+stest(timer_wheel_speed_test)
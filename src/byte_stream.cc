@@ -1,8 +1,89 @@
 #include "byte_stream.hh"
+#include "file_descriptor.hh"
+
+#include <algorithm>
+#include <climits>
+#include <span>
+#include <stdexcept>
 
 using namespace std;
 
-ByteStream::ByteStream( uint64_t capacity ) : capacity_( capacity ) {}
+// In Storage::Chunked, read_from() reads at most this many bytes into a freshly allocated chunk
+static constexpr uint64_t CHUNKED_READ_SIZE = 65536;
+
+// In Storage::Chunked, a string this small keeps its bytes inside the chunk (no allocation to waste)
+static constexpr uint64_t SMALL_STRING_CAPACITY = string {}.capacity();
+
+// In Storage::Spill, read_from() reads at most this many bytes into the spill file at a time
+static constexpr uint64_t SPILL_READ_SIZE = 1 << 20;
+
+ByteStream::ByteStream( uint64_t capacity ) : ByteStream( capacity, Storage::Ring ) {}
+
+ByteStream::ByteStream( uint64_t capacity, Storage storage, uint64_t hot_capacity )
+  : storage_( storage )
+  , ring_( storage == Storage::Ring    ? capacity
+           : storage == Storage::Spill ? min( capacity, hot_capacity )
+                                       : 0,
+           '\0' )
+  , hot_capacity_( hot_capacity )
+  , spill_( capacity )
+  , capacity_( capacity )
+{}
+
+namespace {
+// Copy the bytes of `views`, in order, into a new ring of `size` bytes, starting at `start` and wrapping around
+string relayout( const vector<string_view>& views, uint64_t size, uint64_t start )
+{
+  string ring( size, '\0' );
+  uint64_t pos = start;
+  for ( const auto view : views ) {
+    const uint64_t first_part = min( static_cast<uint64_t>( view.size() ), size - pos );
+    std::copy_n( view.data(), first_part, ring.begin() + static_cast<ptrdiff_t>( pos ) );
+    std::copy_n( view.data() + first_part, view.size() - first_part, ring.begin() );
+    pos = ( pos + view.size() ) % size;
+  }
+  return ring;
+}
+} // namespace
+
+void ByteStream::set_capacity( uint64_t capacity )
+{
+  if ( capacity < this->reader().bytes_buffered() )
+    throw std::runtime_error( "ByteStream capacity can't be less than the bytes buffered" );
+
+  if ( this->storage_ == Storage::Ring && capacity != this->capacity_ ) {
+    // positions in the ring are the cumulative counters modulo the capacity, so every buffered byte moves
+    this->ring_ = relayout(
+      this->reader().peek_all(), capacity, capacity > 0 ? this->cumulatively_bytes_popped % capacity : 0 );
+  }
+
+  if ( this->storage_ == Storage::Spill ) {
+    this->spill_.set_max_size( capacity );
+    const uint64_t hot_ring_size = min( capacity, this->hot_capacity_ );
+    if ( hot_ring_size != this->ring_.size() ) {
+      // the hot ring's bytes move to the start of a ring of the new size (the spill file's stay where they are)
+      vector<string_view> hot;
+      for ( uint64_t offset = 0; offset < this->hot_size_; offset += hot.back().size() )
+        hot.push_back( this->reader().peek( offset ) );
+      this->ring_ = relayout( hot, hot_ring_size, 0 );
+      this->hot_head_ = 0;
+    }
+  }
+
+  this->capacity_ = capacity;
+}
+
+vector<span<char>> ByteStream::hot_free_space( uint64_t len )
+{
+  if ( len == 0 )
+    return {};
+  const uint64_t write_pos = ( this->hot_head_ + this->hot_size_ ) % this->ring_.size();
+  const uint64_t first_part = min( len, this->ring_.size() - write_pos );
+  vector<span<char>> free_space { { this->ring_.data() + write_pos, first_part } };
+  if ( first_part < len )
+    free_space.emplace_back( this->ring_.data(), len - first_part );
+  return free_space;
+}
 
 bool Writer::is_closed() const
 {
@@ -11,20 +92,81 @@ bool Writer::is_closed() const
 
 void Writer::push( string data )
 {
-  if (data.empty())
+  push( std::move( data ), 0 );
+}
+
+void Writer::push( string data, uint64_t skip )
+{
+  if ( skip >= data.size() )
     return;
   if ( this->has_closed )
     throw std::runtime_error( "Writer has already been closed" );
-  if ( data.size() > this->available_capacity() )
-  {
-    this->cumulatively_bytes_writen += this->available_capacity();
-    this->str += data.substr( 0, this->available_capacity() );
+
+  if ( this->storage_ == Storage::Chunked ) {
+    const uint64_t len = min( static_cast<uint64_t>( data.size() - skip ), this->available_capacity() );
+    if ( len == 0 )
+      return;
+    // only `len` counts against the capacity, so a string whose allocation is mostly a skipped prefix or spare
+    // room (more than `len` bytes of it) would pin memory that available_capacity() never shows: copy instead
+    if ( data.capacity() > max( 2 * len, SMALL_STRING_CAPACITY ) ) {
+      push_copy( string_view { data }.substr( skip, len ) );
+      return;
+    }
+    // keep the caller's string as a chunk of its own; only this newest chunk is trimmed to fit
+    data.resize( skip + len );
+    this->chunks_.push_back( { std::move( data ), skip } );
+    this->cumulatively_bytes_writen += len;
+    return;
+  }
+
+  push_copy( string_view { data }.substr( skip ) );
+}
+
+uint64_t Writer::push_copy( string_view data )
+{
+  if ( this->has_closed )
+    throw std::runtime_error( "Writer has already been closed" );
+
+  const uint64_t len = min( static_cast<uint64_t>( data.size() ), this->available_capacity() );
+  if ( len == 0 )
+    return 0;
+  data = data.substr( 0, len );
+
+  if ( this->storage_ == Storage::Chunked ) {
+    // small copies fill the spare room of the last chunk before they take a chunk (and an allocation) of their own
+    if ( !this->chunks_.empty() && this->chunks_.back().data.capacity() - this->chunks_.back().data.size() >= len )
+      this->chunks_.back().data.append( data );
+    else
+      this->chunks_.push_back( { string { data }, 0 } );
+    this->bytes_copied_ += len;
+    this->cumulatively_bytes_writen += len;
+    return len;
   }
-  else
-  {
-    this->cumulatively_bytes_writen += data.size();
-    this->str += data;
+
+  this->bytes_copied_ += len;
+
+  if ( this->storage_ == Storage::Spill ) {
+    // fill the hot ring first, unless older bytes are already waiting in the spill file
+    string_view rest = data;
+    const uint64_t hot_len = this->spill_.size() == 0 ? min( len, this->ring_.size() - this->hot_size_ ) : 0;
+    for ( const auto region : hot_free_space( hot_len ) ) {
+      std::copy_n( rest.data(), region.size(), region.data() );
+      rest.remove_prefix( region.size() );
+    }
+    this->hot_size_ += hot_len;
+    this->spill_.push( rest );
+    this->cumulatively_bytes_writen += len;
+    return len;
   }
+
+  // copy into the free space after the write position, wrapping around to the start of the ring
+  const uint64_t write_pos = this->cumulatively_bytes_writen % this->capacity_;
+  const uint64_t first_part = min( len, this->capacity_ - write_pos );
+  std::copy_n( data.data(), first_part, this->ring_.begin() + static_cast<ptrdiff_t>( write_pos ) );
+  std::copy_n( data.data() + first_part, len - first_part, this->ring_.begin() );
+
+  this->cumulatively_bytes_writen += len;
+  return len;
 }
 
 void Writer::close()
@@ -42,6 +184,57 @@ uint64_t Writer::bytes_pushed() const
   return this->cumulatively_bytes_writen;
 }
 
+uint64_t ByteStream::bytes_allocated() const
+{
+  uint64_t total = this->ring_.capacity();
+  for ( const auto& chunk : this->chunks_ )
+    total += chunk.data.capacity();
+  return total;
+}
+
+uint64_t Writer::read_from( FileDescriptor& fd )
+{
+  if ( this->has_closed )
+    throw std::runtime_error( "Writer has already been closed" );
+  // a zero-length readv() would look like EOF, so don't ask the kernel for nothing
+  if ( this->available_capacity() == 0 )
+    return 0;
+
+  if ( this->storage_ == Storage::Chunked ) {
+    string chunk( min( this->available_capacity(), CHUNKED_READ_SIZE ), '\0' );
+    chunk.resize( fd.read( { span<char> { chunk } } ) );
+    // (push() copies a short read out of the 64 KiB buffer, rather than keep it all)
+    const uint64_t len = chunk.size();
+    push( std::move( chunk ) );
+    return len;
+  }
+
+  if ( this->storage_ == Storage::Spill ) {
+    // read into the hot ring while it has room (and nothing is spilled), otherwise into the spill file
+    const uint64_t hot_len
+      = this->spill_.size() == 0 ? min( this->available_capacity(), this->ring_.size() - this->hot_size_ ) : 0;
+    const uint64_t spill_len = hot_len > 0 ? 0 : min( this->available_capacity(), SPILL_READ_SIZE );
+    const uint64_t len = fd.read( hot_len > 0 ? hot_free_space( hot_len ) : this->spill_.reserve( spill_len ) );
+    if ( hot_len > 0 )
+      this->hot_size_ += len;
+    else
+      this->spill_.commit( len );
+    this->cumulatively_bytes_writen += len;
+    return len;
+  }
+
+  // the free space is the part of the ring after the write position, plus the part that wraps to the start
+  const uint64_t write_pos = this->cumulatively_bytes_writen % this->capacity_;
+  const uint64_t first_part = min( this->available_capacity(), this->capacity_ - write_pos );
+  vector<span<char>> free_space { { this->ring_.data() + write_pos, first_part } };
+  if ( first_part < this->available_capacity() )
+    free_space.emplace_back( this->ring_.data(), this->available_capacity() - first_part );
+
+  const uint64_t len = fd.read( free_space );
+  this->cumulatively_bytes_writen += len;
+  return len;
+}
+
 bool Reader::is_finished() const
 {
   if (this->writer().is_closed() && this->bytes_buffered() == 0)
@@ -56,18 +249,95 @@ uint64_t Reader::bytes_popped() const
 
 string_view Reader::peek() const
 {
-  return {this->str};
+  return peek( 0 );
+}
+
+string_view Reader::peek( uint64_t offset ) const
+{
+  if ( offset >= bytes_buffered() )
+    return {};
+
+  if ( this->storage_ == Storage::Chunked ) {
+    // find the chunk that holds the byte at `offset`, and return the rest of that chunk
+    for ( const auto& chunk : this->chunks_ ) {
+      if ( offset < chunk.view().size() )
+        return chunk.view().substr( offset );
+      offset -= chunk.view().size();
+    }
+    return {};
+  }
+
+  if ( this->storage_ == Storage::Spill ) {
+    // the spill file's bytes come after everything in the hot ring, and are viewed straight from its mapping
+    if ( offset >= this->hot_size_ )
+      return this->spill_.peek( offset - this->hot_size_ );
+    const uint64_t read_pos = ( this->hot_head_ + offset ) % this->ring_.size();
+    return { this->ring_.data() + read_pos, min( this->hot_size_ - offset, this->ring_.size() - read_pos ) };
+  }
+
+  // the view stops at the end of the buffered bytes or at the end of the ring, whichever comes first
+  const uint64_t read_pos = ( this->cumulatively_bytes_popped + offset ) % this->capacity_;
+  const uint64_t len = min( bytes_buffered() - offset, this->capacity_ - read_pos );
+  return { this->ring_.data() + read_pos, len };
+}
+
+vector<string_view> Reader::peek_all() const
+{
+  vector<string_view> views;
+  if ( this->storage_ == Storage::Chunked ) {
+    views.reserve( this->chunks_.size() );
+    for ( const auto& chunk : this->chunks_ )
+      views.push_back( chunk.view() );
+    return views;
+  }
+
+  // at most two pieces per ring: up to its end, and the part that wrapped around to its start
+  for ( uint64_t offset = 0; offset < bytes_buffered(); offset += views.back().size() )
+    views.push_back( peek( offset ) );
+  return views;
+}
+
+uint64_t Reader::write_to( FileDescriptor& fd )
+{
+  auto views = peek_all();
+  if ( views.empty() )
+    return 0;
+  views.resize( min( views.size(), static_cast<size_t>( IOV_MAX ) ) );
+
+  const uint64_t len = fd.write( views );
+  pop( len );
+  return len;
 }
 
 void Reader::pop( uint64_t len )
 {
   if ( len > bytes_buffered() )
     throw std::runtime_error( "Not enough data to pop" );
-  this->str = this->str.substr( len );
   cumulatively_bytes_popped += len;
+
+  if ( this->storage_ == Storage::Chunked ) {
+    // skip over the popped bytes, releasing every chunk that has been consumed completely
+    while ( len > 0 ) {
+      auto& front = this->chunks_.front();
+      const uint64_t from_front = min( len, front.data.size() - front.skip );
+      front.skip += from_front;
+      len -= from_front;
+      if ( front.skip == front.data.size() )
+        this->chunks_.pop_front();
+    }
+  }
+
+  if ( this->storage_ == Storage::Spill ) {
+    const uint64_t from_hot = min( len, this->hot_size_ );
+    if ( from_hot > 0 ) {
+      this->hot_head_ = ( this->hot_head_ + from_hot ) % this->ring_.size();
+      this->hot_size_ -= from_hot;
+    }
+    this->spill_.pop( len - from_hot );
+  }
 }
 
 uint64_t Reader::bytes_buffered() const
 {
-  return this->str.size();
+  return this->cumulatively_bytes_writen - this->cumulatively_bytes_popped;
 }
@@ -1,17 +1,35 @@
 #pragma once
 
+#include "spill_file.hh"
+
 #include <cstdint>
+#include <deque>
+#include <span>
 #include <string>
 #include <string_view>
 #include <sstream>
+#include <vector>
 
 class Reader;
 class Writer;
+class FileDescriptor;
 
 class ByteStream
 {
 public:
+  // How the ByteStream stores the bytes that have been pushed but not yet popped
+  enum class Storage : uint8_t
+  {
+    Ring,    // copied into a ring of exactly `capacity` bytes, allocated once at construction
+    Chunked, // pushed strings are kept as owned chunks, so a push moves the string instead of copying it
+    Spill,   // the first `hot_capacity` bytes live in a ring in memory; any backlog beyond that goes to a SpillFile
+  };
+
+  // In Storage::Spill, the default amount of the buffer that is kept in memory
+  static constexpr uint64_t DEFAULT_HOT_CAPACITY = 1 << 20;
+
   explicit ByteStream( uint64_t capacity );
+  ByteStream( uint64_t capacity, Storage storage, uint64_t hot_capacity = DEFAULT_HOT_CAPACITY );
 
   // Helper functions (provided) to access the ByteStream's Reader and Writer interfaces
   Reader& reader();
@@ -22,26 +40,66 @@ public:
   void set_error() { error_ = true; };       // Signal that the stream suffered an error.
   bool has_error() const { return error_; }; // Has the stream had an error?
   uint64_t getCapacity() const;
+  // Change the capacity (not below the bytes buffered). Storage::Ring reallocates its ring, and Storage::Spill
+  // grows or shrinks its hot ring toward `hot_capacity`.
+  void set_capacity( uint64_t capacity );
+  Storage storage() const { return storage_; }
+  uint64_t bytes_copied() const { return bytes_copied_; } // Bytes copied in by push() (moved chunks don't count)
+  uint64_t bytes_allocated() const; // Memory held for buffered bytes: the ring, or every chunk's allocation
 
 protected:
+  // Storage::Spill: the free part of the hot ring, up to `len` bytes, after its last buffered byte
+  std::vector<std::span<char>> hot_free_space( uint64_t len );
+
   // Please add any additional state to the ByteStream here, and not to the Writer and Reader interfaces.
-  std::string str{};
+  Storage storage_;
+
+  // Storage::Ring: the read and write positions are the cumulative counters below, taken modulo `capacity_`.
+  std::string ring_ {};
+
+  // Storage::Chunked: the buffered bytes are each chunk's data[skip..], in order. Popping the front of a chunk
+  // (or pushing a string whose front should be ignored) only moves its skip.
+  struct Chunk
+  {
+    std::string data;
+    uint64_t skip;
+    std::string_view view() const { return std::string_view { data }.substr( skip ); }
+  };
+  std::deque<Chunk> chunks_ {};
+
+  // Storage::Spill: the buffered bytes are the hot ring (ring_[hot_head_..], hot_size_ bytes, wrapping) followed
+  // by everything in spill_. Pushes go to the hot ring only while spill_ is empty, which keeps the order intact.
+  uint64_t hot_head_ = 0;
+  uint64_t hot_size_ = 0;
+  uint64_t hot_capacity_;
+  SpillFile spill_;
+
   bool has_closed = false;
   uint64_t cumulatively_bytes_writen = 0;
   uint64_t cumulatively_bytes_popped = 0;
   uint64_t capacity_;
   bool error_ {};
+  uint64_t bytes_copied_ = 0;
 };
 
 class Writer : public ByteStream
 {
 public:
   void push( std::string data ); // Push data to stream, but only as much as available capacity allows.
+  // Push data[skip..]. In Storage::Chunked the string is kept without copying, unless most of its allocation
+  // (the skipped prefix, any spare capacity, and whatever doesn't fit) would be dead: then the bytes that fit are
+  // copied, so the memory held stays proportional to the bytes buffered.
+  void push( std::string data, uint64_t skip );
+  uint64_t push_copy( std::string_view data ); // Copy in as much of `data` as fits; returns the bytes pushed
   void close();                  // Signal that the stream has reached its ending. Nothing more will be written.
 
   bool is_closed() const;              // Has the stream been closed?
   uint64_t available_capacity() const; // How many bytes can be pushed to the stream right now?
   uint64_t bytes_pushed() const;       // Total number of bytes cumulatively pushed to the stream
+
+  // Read from `fd` with a single readv() straight into the free space (at most available_capacity() bytes).
+  // Returns the number of bytes pushed; the caller should check fd.eof() afterwards.
+  uint64_t read_from( FileDescriptor& fd );
 };
 
 class Reader : public ByteStream
@@ -50,6 +108,15 @@ public:
   std::string_view peek() const; // Peek at the next bytes in the buffer
   void pop( uint64_t len );      // Remove `len` bytes from the buffer
 
+  // Peek at the contiguous bytes that start `offset` bytes past the front of the buffer
+  std::string_view peek( uint64_t offset ) const;
+
+  // Views that together cover every buffered byte, in order
+  std::vector<std::string_view> peek_all() const;
+
+  // Hand every buffered region to `fd` in a single writev(), and pop exactly the bytes that were written
+  uint64_t write_to( FileDescriptor& fd );
+
   bool is_finished() const;        // Is the stream finished (closed and fully popped)?
   uint64_t bytes_buffered() const; // Number of bytes currently buffered (pushed and not popped)
   uint64_t bytes_popped() const;   // Total number of bytes cumulatively popped from stream
@@ -0,0 +1,312 @@
+#include "congestion_controller.hh"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+// RFC 6928的初始窗口：min(10*MSS, max(2*MSS, 14600))
+uint64_t initial_window( uint64_t mss )
+{
+  return min( 10 * mss, max( 2 * mss, uint64_t { 14600 } ) );
+}
+
+// BBR在ProbeBW里轮流使用的pacing gain：先多发探带宽，再少发把探出来的队列排空，然后匀速
+constexpr array<double, 8> PROBE_BW_GAINS { 1.25, 0.75, 1, 1, 1, 1, 1, 1 };
+} // namespace
+
+RenoController::RenoController( uint64_t mss ) : mss_( mss ), cwnd_( initial_window( mss ) ) {}
+
+void RenoController::on_ack( uint64_t newly_acked, uint64_t now )
+{
+  (void)now;
+  if ( cwnd_ < ssthresh_ ) {
+    // 慢启动：确认多少就涨多少，但一个ACK最多算两个MSS（RFC 3465）
+    cwnd_ += min( newly_acked, 2 * mss_ );
+    return;
+  }
+
+  // 拥塞避免：每确认满一个窗口的数据，涨一个MSS
+  acked_in_avoidance_ += newly_acked;
+  if ( acked_in_avoidance_ >= cwnd_ ) {
+    acked_in_avoidance_ -= cwnd_;
+    cwnd_ += mss_;
+  }
+}
+
+void RenoController::on_timeout( uint64_t bytes_in_flight, uint64_t now )
+{
+  (void)now;
+  ssthresh_ = max( bytes_in_flight / 2, 2 * mss_ );
+  cwnd_ = mss_;
+  acked_in_avoidance_ = 0;
+}
+
+void RenoController::on_fast_retransmit( uint64_t bytes_in_flight, uint64_t now )
+{
+  (void)now;
+  // 三个重复ACK说明后面的段都到了，只丢了一个：窗口减半，再加上已经离开网络的三个段
+  ssthresh_ = max( bytes_in_flight / 2, 2 * mss_ );
+  cwnd_ = ssthresh_ + 3 * mss_;
+  acked_in_avoidance_ = 0;
+}
+
+void RenoController::on_duplicate_ack()
+{
+  // 每个重复ACK代表又有一个段离开了网络
+  cwnd_ += mss_;
+}
+
+bool RenoController::on_partial_ack( uint64_t newly_acked )
+{
+  (void)newly_acked;
+  // Reno：有新数据被确认就结束快速恢复
+  on_recovery_exit();
+  return false;
+}
+
+void RenoController::on_recovery_exit()
+{
+  cwnd_ = ssthresh_;
+}
+
+bool NewRenoController::on_partial_ack( uint64_t newly_acked )
+{
+  // 确认了多少就减掉多少，确认满一个MSS再加回一个，让重传的那个段能发出去
+  cwnd_ -= min( cwnd_, newly_acked );
+  if ( newly_acked >= mss_ )
+    cwnd_ += mss_;
+  cwnd_ = max( cwnd_, mss_ );
+  return true;
+}
+
+CubicController::CubicController( uint64_t mss )
+  : mss_( static_cast<double>( mss ) ), cwnd_( static_cast<double>( initial_window( mss ) ) )
+{}
+
+void CubicController::on_ack( uint64_t newly_acked, uint64_t now )
+{
+  const auto acked = static_cast<double>( newly_acked );
+  if ( cwnd_ < static_cast<double>( ssthresh_ ) ) {
+    cwnd_ += min( acked, 2 * mss_ );
+    return;
+  }
+
+  if ( !in_epoch_ ) {
+    // 新的增长周期：从现在的窗口出发，K秒后回到上次丢包时的窗口
+    in_epoch_ = true;
+    epoch_start_ = now;
+    w_max_ = max( w_max_, cwnd_ );
+    k_ = cbrt( ( w_max_ - cwnd_ ) / mss_ / C );
+    w_est_ = cwnd_;
+  }
+
+  // 三次函数的目标窗口（以MSS为单位计算），和同样时间里Reno能长到的窗口，取大的
+  const double t = static_cast<double>( now - epoch_start_ ) / 1000.0;
+  const double w_cubic = w_max_ + C * pow( t - k_, 3 ) * mss_;
+  w_est_ += mss_ * ( 3 * ( 1 - BETA ) / ( 1 + BETA ) ) * acked / cwnd_;
+  const double target = max( w_cubic, w_est_ );
+
+  // 每个RTT向目标靠近，目标比现在小时也只是非常缓慢地增长
+  if ( target > cwnd_ ) {
+    cwnd_ += ( target - cwnd_ ) * acked / cwnd_;
+  } else {
+    cwnd_ += 0.01 * mss_ * acked / cwnd_;
+  }
+}
+
+void CubicController::reduce()
+{
+  // 快速收敛：如果比上次丢包时还小，说明有新的流进来了，让出一些带宽
+  w_max_ = cwnd_ < w_last_max_ ? cwnd_ * ( 1 + BETA ) / 2 : cwnd_;
+  w_last_max_ = cwnd_;
+  ssthresh_ = static_cast<uint64_t>( max( cwnd_ * BETA, 2 * mss_ ) );
+  in_epoch_ = false;
+}
+
+void CubicController::on_timeout( uint64_t bytes_in_flight, uint64_t now )
+{
+  (void)bytes_in_flight;
+  (void)now;
+  reduce();
+  cwnd_ = mss_;
+}
+
+void CubicController::on_fast_retransmit( uint64_t bytes_in_flight, uint64_t now )
+{
+  (void)bytes_in_flight;
+  (void)now;
+  reduce();
+  cwnd_ = static_cast<double>( ssthresh_ ) + 3 * mss_;
+}
+
+void CubicController::on_duplicate_ack()
+{
+  cwnd_ += mss_;
+}
+
+bool CubicController::on_partial_ack( uint64_t newly_acked )
+{
+  cwnd_ = max( cwnd_ - static_cast<double>( newly_acked ) + mss_, mss_ );
+  return true;
+}
+
+void CubicController::on_recovery_exit()
+{
+  cwnd_ = static_cast<double>( ssthresh_ );
+}
+
+BBRController::BBRController( uint64_t mss ) : mss_( mss ), cwnd_( initial_window( mss ) ) {}
+
+uint64_t BBRController::bdp( double gain ) const
+{
+  // 还没有测量结果的时候就用初始窗口
+  if ( btl_bw_ == 0 || min_rtt_ == UINT64_MAX )
+    return initial_window( mss_ );
+  return static_cast<uint64_t>( gain * btl_bw_ * static_cast<double>( max( min_rtt_, uint64_t { 1 } ) ) );
+}
+
+uint64_t BBRController::pacing_rate() const
+{
+  return static_cast<uint64_t>( pacing_gain_ * btl_bw_ * 1000 );
+}
+
+void BBRController::on_rate_sample( const RateSample& sample, uint64_t now )
+{
+  // 这个段发出去之后发的东西开始被确认了，就算过了一个往返
+  round_start_ = false;
+  if ( sample.prior_delivered >= next_round_delivered_ ) {
+    next_round_delivered_ = sample.delivered;
+    ++round_count_;
+    round_start_ = true;
+  }
+
+  update_bandwidth( sample );
+  check_full_pipe();
+
+  // 最小RTT十秒没更新过，就接受一个更大的，并且去ProbeRTT重新测
+  const bool min_rtt_expired = now > min_rtt_stamp_ + MIN_RTT_WINDOW_MS;
+  if ( sample.rtt <= min_rtt_ || min_rtt_expired ) {
+    min_rtt_ = sample.rtt;
+    min_rtt_stamp_ = now;
+  }
+  if ( min_rtt_expired && mode_ != Mode::ProbeRTT ) {
+    mode_ = Mode::ProbeRTT;
+    pacing_gain_ = 1;
+    cwnd_gain_ = 1;
+    prior_cwnd_ = cwnd_;
+    probe_rtt_done_stamp_ = 0;
+  }
+
+  update_mode( sample, now );
+}
+
+void BBRController::update_bandwidth( const RateSample& sample )
+{
+  // 单调递减的队列：队首是最近BW_WINDOW_ROUNDS个往返里的最大值
+  const double rate = static_cast<double>( sample.delivery_rate ) / 1000;
+  while ( !bw_samples_.empty() && bw_samples_.back().second <= rate )
+    bw_samples_.pop_back();
+  bw_samples_.emplace_back( round_count_, rate );
+  while ( bw_samples_.front().first + BW_WINDOW_ROUNDS <= round_count_ )
+    bw_samples_.pop_front();
+  btl_bw_ = bw_samples_.front().second;
+}
+
+void BBRController::check_full_pipe()
+{
+  // 连续三个往返带宽都没涨25%，说明管道已经满了
+  if ( filled_pipe_ || !round_start_ )
+    return;
+  if ( btl_bw_ >= full_bw_ * 1.25 ) {
+    full_bw_ = btl_bw_;
+    full_bw_count_ = 0;
+    return;
+  }
+  if ( ++full_bw_count_ >= 3 )
+    filled_pipe_ = true;
+}
+
+void BBRController::enter_probe_bw( uint64_t now )
+{
+  mode_ = Mode::ProbeBW;
+  cwnd_gain_ = 2;
+  cycle_index_ = 2;
+  cycle_stamp_ = now;
+  pacing_gain_ = PROBE_BW_GAINS.at( cycle_index_ );
+}
+
+void BBRController::update_mode( const RateSample& sample, uint64_t now )
+{
+  if ( mode_ == Mode::Startup && filled_pipe_ ) {
+    mode_ = Mode::Drain;
+    pacing_gain_ = 1 / HIGH_GAIN;
+  }
+
+  if ( mode_ == Mode::Drain && sample.bytes_in_flight <= bdp( 1 ) )
+    enter_probe_bw( now );
+
+  if ( mode_ == Mode::ProbeBW && now - cycle_stamp_ > min_rtt_ ) {
+    cycle_index_ = ( cycle_index_ + 1 ) % PROBE_BW_GAINS.size();
+    cycle_stamp_ = now;
+    pacing_gain_ = PROBE_BW_GAINS.at( cycle_index_ );
+  }
+
+  if ( mode_ == Mode::ProbeRTT ) {
+    // 在途的降到4个段之后再待200ms，这段时间测到的RTT里就没有排队了
+    if ( probe_rtt_done_stamp_ == 0 && sample.bytes_in_flight <= 4 * mss_ ) {
+      probe_rtt_done_stamp_ = now + PROBE_RTT_MS;
+    } else if ( probe_rtt_done_stamp_ != 0 && now >= probe_rtt_done_stamp_ ) {
+      min_rtt_stamp_ = now;
+      cwnd_ = max( cwnd_, prior_cwnd_ );
+      if ( filled_pipe_ ) {
+        enter_probe_bw( now );
+      } else {
+        mode_ = Mode::Startup;
+        pacing_gain_ = cwnd_gain_ = HIGH_GAIN;
+      }
+    }
+  }
+}
+
+void BBRController::on_ack( uint64_t newly_acked, uint64_t now )
+{
+  (void)now;
+  // 管道满了之后cwnd只追着模型走；Startup里一直涨
+  const uint64_t target = bdp( cwnd_gain_ );
+  if ( filled_pipe_ ) {
+    cwnd_ = min( cwnd_ + newly_acked, target );
+  } else if ( cwnd_ < target || btl_bw_ == 0 ) {
+    cwnd_ += newly_acked;
+  }
+  cwnd_ = max( cwnd_, 4 * mss_ );
+  if ( mode_ == Mode::ProbeRTT )
+    cwnd_ = min( cwnd_, 4 * mss_ );
+}
+
+void BBRController::on_timeout( uint64_t bytes_in_flight, uint64_t now )
+{
+  (void)bytes_in_flight;
+  (void)now;
+  // BBR不把丢包当作拥塞信号，但超时说明在途的都没了，从最小窗口按模型重新涨上去
+  cwnd_ = 4 * mss_;
+}
+
+unique_ptr<CongestionController> make_congestion_controller( CongestionControl kind, uint64_t mss )
+{
+  switch ( kind ) {
+    case CongestionControl::Reno:
+      return make_unique<RenoController>( mss );
+    case CongestionControl::NewReno:
+      return make_unique<NewRenoController>( mss );
+    case CongestionControl::Cubic:
+      return make_unique<CubicController>( mss );
+    case CongestionControl::BBR:
+      return make_unique<BBRController>( mss );
+    case CongestionControl::None:
+      break;
+  }
+  return nullptr;
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string_view>
+#include <utility>
+
+// Which congestion controller a TCPSender consults (None: only the receiver's window limits what is in flight)
+enum class CongestionControl : uint8_t
+{
+  None,
+  Reno,
+  NewReno,
+  Cubic,
+  BBR,
+};
+
+// What the acknowledgment of one segment (that was only sent once) says about the path
+struct RateSample
+{
+  uint64_t delivery_rate;   // bytes per second delivered while the segment was in flight
+  uint64_t rtt;             // milliseconds from sending the segment to its acknowledgment
+  uint64_t prior_delivered; // bytes acknowledged when the segment was sent
+  uint64_t delivered;       // bytes acknowledged, including this acknowledgment
+  uint64_t bytes_in_flight; // outstanding after this acknowledgment
+};
+
+// A congestion controller tracks how many bytes the network can take (the congestion window, cwnd).
+// The TCPSender keeps no more than min(cwnd, receiver window) sequence numbers in flight, and reports
+// acknowledgments and losses back to the controller. All quantities are in bytes, and times in milliseconds.
+class CongestionController
+{
+public:
+  virtual ~CongestionController() = default;
+
+  virtual std::string_view name() const = 0;
+  virtual uint64_t cwnd() const = 0;
+  virtual uint64_t ssthresh() const = 0;
+
+  // `newly_acked` sequence numbers were cumulatively acknowledged at time `now`
+  virtual void on_ack( uint64_t newly_acked, uint64_t now ) = 0;
+
+  // The retransmission timer expired with `bytes_in_flight` outstanding
+  virtual void on_timeout( uint64_t bytes_in_flight, uint64_t now ) = 0;
+
+  // Fast recovery (RFC 5681 and RFC 6582). On the third duplicate ACK the sender retransmits the oldest segment and
+  // calls on_fast_retransmit(). Until everything that was in flight then is acknowledged, each further duplicate
+  // ACK calls on_duplicate_ack(), and each ACK of new data calls on_partial_ack() instead of on_ack(). That returns
+  // whether to stay in recovery and retransmit the next hole (NewReno) or to leave recovery (Reno). The ACK that
+  // acknowledges everything calls on_recovery_exit(). By default, the window is left alone.
+  virtual void on_fast_retransmit( uint64_t bytes_in_flight, uint64_t now )
+  {
+    (void)bytes_in_flight;
+    (void)now;
+  }
+  virtual void on_duplicate_ack() {}
+  virtual bool on_partial_ack( uint64_t newly_acked )
+  {
+    (void)newly_acked;
+    return true;
+  }
+  virtual void on_recovery_exit() {}
+
+  // A delivery-rate and RTT measurement, reported just before the on_ack() for the same acknowledgment
+  virtual void on_rate_sample( const RateSample& sample, uint64_t now )
+  {
+    (void)sample;
+    (void)now;
+  }
+
+  // Bytes per second to spread transmissions at, or 0 to send whatever the window allows at once
+  virtual uint64_t pacing_rate() const { return 0; }
+};
+
+// RFC 5681: slow start up to ssthresh, then one MSS per window of acknowledged data. Fast retransmit halves the
+// window (relative to the data in flight) and inflates it by one MSS per duplicate ACK while in fast recovery;
+// the first ACK of new data ends recovery. A timeout halves ssthresh and starts over from a one-segment window.
+class RenoController : public CongestionController
+{
+public:
+  explicit RenoController( uint64_t mss );
+
+  std::string_view name() const override { return "Reno"; }
+  uint64_t cwnd() const override { return cwnd_; }
+  uint64_t ssthresh() const override { return ssthresh_; }
+  void on_ack( uint64_t newly_acked, uint64_t now ) override;
+  void on_timeout( uint64_t bytes_in_flight, uint64_t now ) override;
+  void on_fast_retransmit( uint64_t bytes_in_flight, uint64_t now ) override;
+  void on_duplicate_ack() override;
+  bool on_partial_ack( uint64_t newly_acked ) override;
+  void on_recovery_exit() override;
+
+protected:
+  uint64_t mss_;
+  uint64_t cwnd_;
+  uint64_t ssthresh_ = UINT64_MAX;
+  uint64_t acked_in_avoidance_ = 0; // bytes acknowledged towards the next one-MSS increase
+};
+
+// RFC 6582: Reno, except that a partial ACK (one that doesn't cover everything that was in flight when fast
+// recovery started) means another segment was lost. NewReno stays in recovery and the sender retransmits it
+// right away, instead of waiting for three more duplicate ACKs or a timeout.
+class NewRenoController : public RenoController
+{
+public:
+  using RenoController::RenoController;
+  std::string_view name() const override { return "NewReno"; }
+  bool on_partial_ack( uint64_t newly_acked ) override;
+};
+
+// RFC 8312: after a loss, the window grows along a cubic function of the time since the loss, centred on the
+// window where the loss happened, but never slower than Reno would grow it. Fast recovery works as in NewReno,
+// from a window reduced by beta instead of halved.
+class CubicController : public CongestionController
+{
+public:
+  explicit CubicController( uint64_t mss );
+
+  std::string_view name() const override { return "CUBIC"; }
+  uint64_t cwnd() const override { return static_cast<uint64_t>( cwnd_ ); }
+  uint64_t ssthresh() const override { return ssthresh_; }
+  void on_ack( uint64_t newly_acked, uint64_t now ) override;
+  void on_timeout( uint64_t bytes_in_flight, uint64_t now ) override;
+  void on_fast_retransmit( uint64_t bytes_in_flight, uint64_t now ) override;
+  void on_duplicate_ack() override;
+  bool on_partial_ack( uint64_t newly_acked ) override;
+  void on_recovery_exit() override;
+
+private:
+  static constexpr double C = 0.4;    // window growth, in segments per second cubed
+  static constexpr double BETA = 0.7; // multiplicative decrease
+
+  // Remember the window at a loss, and start a fresh growth epoch
+  void reduce();
+
+  double mss_;
+  double cwnd_;
+  uint64_t ssthresh_ = UINT64_MAX;
+  double w_max_ = 0;      // window just before the last reduction
+  double w_last_max_ = 0; // the w_max before that, for fast convergence
+  double w_est_ = 0;      // what Reno would have grown the window to in this epoch
+  double k_ = 0;          // seconds for the cubic function to get back to w_max
+  bool in_epoch_ = false;
+  uint64_t epoch_start_ = 0;
+};
+
+// BBR (v1): instead of reacting to loss, keep a model of the path, the bottleneck bandwidth (the highest delivery
+// rate over the last ten round trips) and the round-trip propagation delay (the lowest RTT over the last ten
+// seconds). Transmissions are paced at a multiple of the bandwidth, and cwnd is a multiple of the
+// bandwidth-delay product. The pacing gain cycles above and below 1 to probe for more bandwidth and then drain
+// the queue that probing built, so the bottleneck queue stays nearly empty.
+class BBRController : public CongestionController
+{
+public:
+  explicit BBRController( uint64_t mss );
+
+  std::string_view name() const override { return "BBR"; }
+  uint64_t cwnd() const override { return cwnd_; }
+  uint64_t ssthresh() const override { return UINT64_MAX; }
+  void on_ack( uint64_t newly_acked, uint64_t now ) override;
+  void on_timeout( uint64_t bytes_in_flight, uint64_t now ) override;
+  void on_rate_sample( const RateSample& sample, uint64_t now ) override;
+  uint64_t pacing_rate() const override;
+
+private:
+  enum class Mode : uint8_t
+  {
+    Startup,  // double the sending rate every round trip until the bandwidth stops growing
+    Drain,    // drain the queue that Startup built
+    ProbeBW,  // cycle the pacing gain around 1
+    ProbeRTT, // shrink to a few segments now and then, to see the propagation delay without a queue
+  };
+
+  static constexpr double HIGH_GAIN = 2.885; // 2/ln(2)
+  static constexpr uint64_t BW_WINDOW_ROUNDS = 10;
+  static constexpr uint64_t MIN_RTT_WINDOW_MS = 10000;
+  static constexpr uint64_t PROBE_RTT_MS = 200;
+
+  uint64_t bdp( double gain ) const; // gain times the estimated bandwidth-delay product, in bytes
+  void update_bandwidth( const RateSample& sample );
+  void check_full_pipe();
+  void update_mode( const RateSample& sample, uint64_t now );
+  void enter_probe_bw( uint64_t now );
+
+  uint64_t mss_;
+  uint64_t cwnd_;
+  Mode mode_ = Mode::Startup;
+  double pacing_gain_ = HIGH_GAIN;
+  double cwnd_gain_ = HIGH_GAIN;
+
+  std::deque<std::pair<uint64_t, double>> bw_samples_ {}; // (round, bytes per ms), decreasing: a max filter
+  double btl_bw_ = 0;                                     // bytes per millisecond
+  uint64_t min_rtt_ = UINT64_MAX;
+  uint64_t min_rtt_stamp_ = 0;
+
+  uint64_t round_count_ = 0;
+  uint64_t next_round_delivered_ = 0;
+  bool round_start_ = false;
+
+  bool filled_pipe_ = false;
+  double full_bw_ = 0;
+  uint64_t full_bw_count_ = 0;
+
+  uint64_t cycle_index_ = 0;
+  uint64_t cycle_stamp_ = 0;
+  uint64_t probe_rtt_done_stamp_ = 0; // 0 until the flight has shrunk during ProbeRTT
+  uint64_t prior_cwnd_ = 0;
+};
+
+// The controller for `kind` (nullptr for CongestionControl::None), for segments of at most `mss` bytes
+std::unique_ptr<CongestionController> make_congestion_controller( CongestionControl kind, uint64_t mss );
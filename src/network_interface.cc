@@ -29,23 +29,16 @@ void NetworkInterface::send_datagram( const InternetDatagram& dgram, const Addre
 {
   EthernetFrame efram;
 
-  // 如果这个arp对应的MAC地址超过了30秒，就重新ARP
-  if (arp_table.contains(next_hop.ipv4_numeric()) &&
-       current_time - arp_table[next_hop.ipv4_numeric()].second > ARP_MAPPING_EXPIRATION)
-    arp_table.erase( next_hop.ipv4_numeric() );
-
-  // 如果对应ip找不到MAC地址，那就进行arp
+  // 如果对应ip找不到MAC地址（没学到过，或者超过30秒过期了），那就进行arp
   if (!arp_table.contains(next_hop.ipv4_numeric()))
   {
     failed_messages_mmap.emplace(next_hop.ipv4_numeric(), failed_messages(dgram, next_hop));
     // 下面决定是否需要发送arp
-    // 如果arp表没有就发，如果arp表有但是超过了时限也发
-    if (!last_arp_request_time.contains(next_hop.ipv4_numeric()))
-      last_arp_request_time[next_hop.ipv4_numeric()] = current_time;
-    else if (current_time - last_arp_request_time[next_hop.ipv4_numeric()] > ARP_REQUEST_COOL_DOWN)
-      ;
-    else
+    // 5秒内发过请求就不再发，冷却时间到了请求会从表里删掉
+    if (arp_requests.contains(next_hop.ipv4_numeric()))
       return;
+    arp_requests[next_hop.ipv4_numeric()]
+      = timers.arm(current_time + ARP_REQUEST_COOL_DOWN + 1, {next_hop.ipv4_numeric(), false});
 
     // 发送的是广播地址
     efram = NetworkInterface::make_eth_fram_head(this->ethernet_address_,
@@ -103,12 +96,12 @@ void NetworkInterface::recv_frame( const EthernetFrame& frame )
       transmit( efram );
 
       // 收到对方的arp，我们也更新arp表
-      arp_table[arp_fram_recved.sender_ip_address] = { arp_fram_recved.sender_ethernet_address, current_time };
+      learn_mapping(arp_fram_recved.sender_ip_address, arp_fram_recved.sender_ethernet_address);
     }
     else if (arp_fram_recved.opcode == ARPMessage::OPCODE_REPLY)  // 得到了对方的MAC
     {
       auto new_ip = arp_fram_recved.sender_ip_address;
-      arp_table[new_ip] = { arp_fram_recved.sender_ethernet_address, current_time };
+      learn_mapping(new_ip, arp_fram_recved.sender_ethernet_address);
       auto range = failed_messages_mmap.equal_range( new_ip );
       vector<failed_messages> message_to_resend;
       for (auto it = range.first; it != range.second; ++it)
@@ -135,6 +128,21 @@ void NetworkInterface::recv_frame( const EthernetFrame& frame )
 void NetworkInterface::tick( const size_t ms_since_last_tick )
 {
   current_time += ms_since_last_tick;
+  // 过期的映射和冷却完的请求从表里删掉
+  timers.advance_to(current_time, [&](const arp_timer& timer) {
+    if (timer.mapping)
+      arp_table.erase(timer.ip);
+    else
+      arp_requests.erase(timer.ip);
+  });
+}
+
+void NetworkInterface::learn_mapping(uint32_t ip, const EthernetAddress& ethernet_address)
+{
+  // 更新映射的话，旧的计时器作废，重新算30秒
+  if (auto it = arp_table.find(ip); it != arp_table.end())
+    timers.cancel(it->second.second);
+  arp_table[ip] = { ethernet_address, timers.arm(current_time + ARP_MAPPING_EXPIRATION + 1, {ip, true}) };
 }
 
 EthernetFrame NetworkInterface::make_eth_fram_head(EthernetAddress _src, EthernetAddress _dst, uint16_t _type)
@@ -7,6 +7,7 @@
 #include "ethernet_frame.hh"
 #include "ipv4_datagram.hh"
 #include "arp_message.hh"
+#include "timer_wheel.hh"
 
 // A "network interface" that connects IP (the internet layer, or network layer)
 // with Ethernet (the network access layer, or link layer).
@@ -73,6 +74,9 @@ private:
                                    EthernetAddress _target_ethernet_address, uint32_t _target_ip_address);
   static EthernetFrame make_eth_fram_head(EthernetAddress _src, EthernetAddress _dst, uint16_t _type);
 
+  // 学到（或者更新）一个ip对应的MAC地址
+  void learn_mapping(uint32_t ip, const EthernetAddress& ethernet_address);
+
 private:
   // Human-readable name of the interface
   std::string name_;
@@ -90,12 +94,22 @@ private:
   // Datagrams that have been received
   std::queue<InternetDatagram> datagrams_received_ {};
 
-    // 一个arp信息应该同时记录last_update_time
-  std::unordered_map<uint32_t, std::pair<EthernetAddress, size_t>> arp_table {};
-
   const uint16_t ARP_REQUEST_COOL_DOWN = 5 * 1000;
   const uint16_t ARP_MAPPING_EXPIRATION = 30 * 1000;
-  std::unordered_map<uint32_t, size_t> last_arp_request_time {};
+
+  // 映射过期和请求冷却都是时间轮上的计时器，到期时把对应的表项删掉
+  struct arp_timer
+  {
+    uint32_t ip {};
+    bool mapping {}; // true是arp_table里的映射，false是arp_requests里的请求
+  };
+  TimerWheel<arp_timer> timers {};
+
+  // 一个arp信息同时记着它过期的计时器
+  std::unordered_map<uint32_t, std::pair<EthernetAddress, TimerWheel<arp_timer>::TimerID>> arp_table {};
+
+  // 发过请求、还在冷却的ip
+  std::unordered_map<uint32_t, TimerWheel<arp_timer>::TimerID> arp_requests {};
 
   size_t current_time {};
 
@@ -1,98 +1,369 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
 #include <iostream>
+#include <stdexcept>
 #include <utility>
 
 #include "reassembler.hh"
 
 using namespace std;
 
+namespace {
+// std::map的每个节点除了存的值，还有红黑树的三个指针和颜色
+constexpr uint64_t NODE_OVERHEAD = 4 * sizeof( void* );
+constexpr uint64_t INTERVAL_MEMORY = NODE_OVERHEAD + sizeof( pair<const uint64_t, uint64_t> );
+// 这么短的string存在自己里面，没有单独分配的内存可以交给ByteStream
+constexpr uint64_t SMALL_FRAGMENT = string {}.capacity();
+
+atomic<uint64_t> global_memory_used_ { 0 };
+atomic<uint64_t> global_memory_limit_ { Reassembler::UNLIMITED };
+} // namespace
+
+Reassembler::Reassembler( ByteStream&& output, Engine engine, uint64_t memory_limit )
+  : output_( std::move( output ) )
+  , engine_( engine )
+  , ring_( engine == Engine::Bitmap ? output_.getCapacity() : 0, '\0' )
+  , present_( engine == Engine::Bitmap ? ( output_.getCapacity() + 63 ) / 64 : 0 )
+  , memory_limit_( memory_limit )
+{
+  // 位图引擎一开始就把整个环分配好了，之后不再变化，也没法淘汰
+  if ( engine_ == Engine::Bitmap )
+    add_memory( ring_.capacity() + present_.size() * sizeof( uint64_t ) );
+}
+
 void Reassembler::insert( uint64_t first_index, string data, bool is_last_substring )
 {
-  bool changed_tail = false;
+  // 只能存current_pos到current_pos + available_capacity的内容，详见check1.md配图
+  const uint64_t first_unacceptable = current_pos + this->writer().available_capacity();
+  const uint64_t last_index = first_index + data.size();
 
-  // 如果available_capacity < data.size()，map就只存substr，并且只要有空间，就读
-  if ( bytes_pending() >= this->writer().available_capacity() )
-    return;
+  // 最后一段完整地落在容量内，才知道流在哪结束
+  if ( is_last_substring && last_index <= first_unacceptable )
+    close_flag = true;
 
-  // 如果first_index >= current_pos，就正常存
-  // 如果first_index < current_pos <= first_index + data.size()的，也按current_pos插入
-
-  // first_index + data.size() <= current_pos + this->writer().available_capacity()
-  // 只能插current_pos到current_pos + this->writer().available_capacity()的内容进来
-  if (first_index >= current_pos) // cur在fir左边，存available_capacity内的内容
-  {
-    if (first_index + data.size() > current_pos + this->writer().available_capacity())
-    {
-      data = data.substr( 0, current_pos + this->writer().available_capacity() - first_index );
-      changed_tail = true;
+  const uint64_t start = max( first_index, current_pos );
+  const uint64_t end = min( last_index, first_unacceptable );
+  if ( start < end ) {
+    // 修剪data，只留[start, end)：尾巴直接resize，开头只记下要跳过几个字节，都不用拷贝
+    data.resize( end - first_index );
+    const uint64_t skip = start - first_index;
+
+    if ( start == current_pos && pending_bytes_ == 0 ) {
+      // 按顺序到达、前面也没有存着的，直接整个move进ByteStream
+      current_pos = end;
+      this->output_.writer().push( std::move( data ), skip );
+    } else if ( engine_ == Engine::Bitmap ) {
+      store_in_ring( start, string_view { data }.substr( skip ) );
+    } else {
+      store( start, std::move( data ), skip );
+      flush();
+      enforce_budget();
     }
   }
-  else // cur在fir右边，详见check1.md配图
-  {
-    if (first_index + data.size() >= current_pos) // 从current_pos开始截取data
-      data = data.substr( current_pos - first_index );
-    else
-      return;
-    if (data.size() > this->writer().available_capacity()) // 只取容量内的data
-    {
-      data = data.substr( 0, this->writer().available_capacity() );
-      changed_tail = true;
+
+  if ( close_flag && pending_bytes_ == 0 )
+    this->output_.writer().close();
+}
+
+uint64_t Reassembler::fragment_memory( const Fragment& fragment )
+{
+  return NODE_OVERHEAD + sizeof( decltype( fragments_map )::value_type ) + fragment.data.capacity();
+}
+
+void Reassembler::add_memory( uint64_t bytes )
+{
+  stats_.memory_used += bytes;
+  stats_.peak_memory_used = max( stats_.peak_memory_used, stats_.memory_used );
+  global_charge_.add( bytes );
+}
+
+void Reassembler::release_memory( uint64_t bytes )
+{
+  stats_.memory_used -= bytes;
+  global_charge_.release( bytes );
+}
+
+void Reassembler::enforce_budget()
+{
+  // 超了预算就从离current_pos最远的fragment开始扔，它们要等最久才能写进去，扔掉也最便宜（对方会重传）
+  while ( !fragments_map.empty()
+          && ( stats_.memory_used > memory_limit_ || global_memory_used_ > global_memory_limit_ ) ) {
+    const auto last = prev( fragments_map.end() );
+    const uint64_t start = last->first;
+    const uint64_t len = last->second.data.size() - last->second.skip;
+    release_memory( fragment_memory( last->second ) );
+    fragments_map.erase( last );
+
+    // 最后一个fragment一定在最后一个区间的末尾，把区间截短，截没了就删掉
+    const auto interval = prev( intervals_.end() );
+    if ( interval->first == start ) {
+      intervals_.erase( interval );
+      release_memory( INTERVAL_MEMORY );
+    } else {
+      interval->second = start;
     }
-    first_index = current_pos;
+
+    pending_bytes_ -= len;
+    ++stats_.fragments_evicted;
+    stats_.bytes_evicted += len;
+    // 流的结尾可能被扔掉了，等FIN重传的时候再关
+    close_flag = false;
   }
+}
 
-  // pending_bytes_ += data.size();
-  if (fragments_map.find(first_index) != fragments_map.end() && data.size() <= fragments_map[first_index].size())
-    return;
-  fragments_map[first_index] = std::move( data );
+void Reassembler::grow_capacity( uint64_t capacity )
+{
+  if ( engine_ == Engine::Bitmap )
+    throw runtime_error( "the bitmap engine's capacity is fixed" );
+  // 缩小的话，已经存下的、在新窗口之外的字节就写不出去了
+  if ( capacity < output_.getCapacity() )
+    throw runtime_error( "Reassembler capacity can only grow" );
+  output_.set_capacity( capacity );
+}
 
-  if ( is_last_substring && !changed_tail )
-    close_flag = true;
+void Reassembler::set_global_memory_limit( uint64_t limit )
+{
+  global_memory_limit_ = limit;
+}
+
+uint64_t Reassembler::global_memory_used()
+{
+  return global_memory_used_;
+}
+
+Reassembler::GlobalCharge::GlobalCharge( const GlobalCharge& other ) : bytes_( other.bytes_ )
+{
+  global_memory_used_ += bytes_;
+}
+
+Reassembler::GlobalCharge& Reassembler::GlobalCharge::operator=( const GlobalCharge& other )
+{
+  if ( this != &other ) {
+    global_memory_used_ += other.bytes_;
+    global_memory_used_ -= bytes_;
+    bytes_ = other.bytes_;
+  }
+  return *this;
+}
 
+Reassembler::GlobalCharge::GlobalCharge( GlobalCharge&& other ) noexcept
+  : bytes_( exchange( other.bytes_, 0 ) )
+{}
 
-  while ( !fragments_map.empty() && fragments_map.begin()->first <= current_pos) // 可以插入了，只插入在范围内的
-  {
-    auto& cur_str = fragments_map.begin()->second;
-    //  pending_bytes_ -= cur_str.size();
-    // 判断字符串是否在范围内，不在，就不算
-    if (fragments_map.begin()->first + cur_str.size() < current_pos)
-    {
-      fragments_map.erase( fragments_map.begin() );
-      continue;
+Reassembler::GlobalCharge& Reassembler::GlobalCharge::operator=( GlobalCharge&& other ) noexcept
+{
+  if ( this != &other ) {
+    global_memory_used_ -= bytes_;
+    bytes_ = exchange( other.bytes_, 0 );
+  }
+  return *this;
+}
+
+Reassembler::GlobalCharge::~GlobalCharge()
+{
+  global_memory_used_ -= bytes_;
+}
+
+void Reassembler::GlobalCharge::add( uint64_t bytes )
+{
+  bytes_ += bytes;
+  global_memory_used_ += bytes;
+}
+
+void Reassembler::GlobalCharge::release( uint64_t bytes )
+{
+  bytes_ -= bytes;
+  global_memory_used_ -= bytes;
+}
+
+void Reassembler::store( uint64_t start, string data, uint64_t skip )
+{
+  const uint64_t end = start + data.size() - skip;
+
+  // 从第一个与[start, end)重叠或相邻的区间开始
+  auto it = intervals_.upper_bound( start );
+  if ( it != intervals_.begin() && prev( it )->second >= start )
+    --it;
+
+  // 只存已有区间之间的空隙，重叠的字节不会存第二份
+  uint64_t merged_start = start;
+  uint64_t merged_end = end;
+  uint64_t cursor = start;
+  const auto store_gap = [&]( uint64_t gap_end ) {
+    pending_bytes_ += gap_end - cursor;
+    if ( cursor == start && gap_end == end ) {
+      // 整段都是新的（最多和别人相邻），直接存，不用拷贝
+      const auto stored = fragments_map.emplace( cursor, Fragment { std::move( data ), skip } );
+      add_memory( fragment_memory( stored.first->second ) );
+      return;
     }
-    // 修剪字符串
-    if (fragments_map.begin()->first != current_pos)
-      cur_str = cur_str.substr( current_pos - fragments_map.begin()->first );
+    bytes_copied_ += gap_end - cursor;
+    const auto stored
+      = fragments_map.emplace( cursor, Fragment { data.substr( skip + cursor - start, gap_end - cursor ), 0 } );
+    add_memory( fragment_memory( stored.first->second ) );
+  };
+
+  while ( it != intervals_.end() && it->first <= end ) {
+    if ( it->first > cursor )
+      store_gap( it->first );
+    cursor = max( cursor, it->second );
+    merged_start = min( merged_start, it->first );
+    merged_end = max( merged_end, it->second );
+    it = intervals_.erase( it );
+    release_memory( INTERVAL_MEMORY );
+  }
+
+  if ( cursor < end )
+    store_gap( end );
 
-    auto new_pos = current_pos + cur_str.size();
-    this->output_.writer().push( cur_str );
+  intervals_.emplace( merged_start, merged_end );
+  add_memory( INTERVAL_MEMORY );
+}
 
+void Reassembler::flush()
+{
+  // 所有fragment都在current_pos之后且互不重叠，开头那些首尾相接的都可以写进去了
+  while ( !fragments_map.empty() && fragments_map.begin()->first == current_pos ) {
+    auto& cur = fragments_map.begin()->second;
+    current_pos += cur.data.size() - cur.skip;
+    pending_bytes_ -= cur.data.size() - cur.skip;
+    release_memory( fragment_memory( cur ) );
+    // 很短的fragment（一般是拷出来的空隙）拷进去，和前后的挤在一个chunk里；否则每个字节都要占一个chunk。
+    // 长的move进去：Writer::push自己会把大部分是skip或者空闲容量的string拷一份，不会占着整个段的内存
+    if ( cur.data.size() - cur.skip <= SMALL_FRAGMENT )
+      this->output_.writer().push_copy( string_view { cur.data }.substr( cur.skip ) );
+    else
+      this->output_.writer().push( std::move( cur.data ), cur.skip );
     fragments_map.erase( fragments_map.begin() );
-    current_pos = new_pos;
   }
 
-  if ( close_flag && fragments_map.empty() )
-    this->output_.writer().close();
+  // 第一个区间要么整个写进去了，要么还没开始
+  if ( !intervals_.empty() && intervals_.begin()->second <= current_pos ) {
+    intervals_.erase( intervals_.begin() );
+    release_memory( INTERVAL_MEMORY );
+  }
 }
 
-uint64_t Reassembler::bytes_pending() const
+void Reassembler::store_in_ring( uint64_t start, string_view data )
 {
-  if (fragments_map.empty())
-    return 0;
-  uint64_t pos = fragments_map.begin()->first;
-  uint64_t result = 0;
-  for (auto &p : fragments_map)
-  {
-    if (p.first >= pos)
-      result += p.second.size();
-    else if (p.first + p.second.size() >= pos)
-      result += p.first + p.second.size() - pos;
-    else
-      continue;
-    pos = p.first + p.second.size();
+  // 直接拷到最终的位置，重复的字节覆盖成一样的内容，不用额外处理
+  const uint64_t first_slot = start % ring_.size();
+  const uint64_t first_part = min( data.size(), ring_.size() - first_slot );
+  copy_n( data.data(), first_part, ring_.begin() + static_cast<ptrdiff_t>( first_slot ) );
+  copy_n( data.data() + first_part, data.size() - first_part, ring_.begin() );
+  bytes_copied_ += data.size();
+  pending_bytes_ += mark_present( first_slot, first_slot + first_part );
+  pending_bytes_ += mark_present( 0, data.size() - first_part );
+
+  // 从current_pos开始连续到达的字节，在环的末尾可能要分两段
+  const uint64_t pos_slot = current_pos % ring_.size();
+  uint64_t run = present_run( pos_slot, ring_.size() );
+  if ( run == ring_.size() - pos_slot )
+    run += present_run( 0, pos_slot );
+  if ( run == 0 )
+    return;
+
+  const uint64_t run_first_part = min( run, ring_.size() - pos_slot );
+  string out;
+  out.reserve( run );
+  out.append( ring_, pos_slot, run_first_part );
+  out.append( ring_, 0, run - run_first_part );
+  clear_present( pos_slot, pos_slot + run_first_part );
+  clear_present( 0, run - run_first_part );
+  bytes_copied_ += run;
+
+  current_pos += run;
+  pending_bytes_ -= run;
+  this->output_.writer().push( std::move( out ) );
+}
+
+uint64_t Reassembler::mark_present( uint64_t first_slot, uint64_t last_slot )
+{
+  uint64_t newly_present = 0;
+  while ( first_slot < last_slot ) {
+    const uint64_t bit = first_slot % 64;
+    const uint64_t len = min( 64 - bit, last_slot - first_slot );
+    const uint64_t mask = ( len == 64 ? ~uint64_t {} : ( uint64_t { 1 } << len ) - 1 ) << bit;
+    auto& word = present_[first_slot / 64];
+    newly_present += popcount( mask & ~word );
+    word |= mask;
+    first_slot += len;
+  }
+  return newly_present;
+}
+
+void Reassembler::clear_present( uint64_t first_slot, uint64_t last_slot )
+{
+  while ( first_slot < last_slot ) {
+    const uint64_t bit = first_slot % 64;
+    const uint64_t len = min( 64 - bit, last_slot - first_slot );
+    const uint64_t mask = ( len == 64 ? ~uint64_t {} : ( uint64_t { 1 } << len ) - 1 ) << bit;
+    present_[first_slot / 64] &= ~mask;
+    first_slot += len;
+  }
+}
+
+uint64_t Reassembler::present_run( uint64_t first_slot, uint64_t last_slot ) const
+{
+  // 一次看64位：右移之后高位补0，countr_one不会数过这个word的末尾
+  uint64_t slot = first_slot;
+  while ( slot < last_slot ) {
+    const uint64_t bit = slot % 64;
+    const auto ones = static_cast<uint64_t>( countr_one( present_[slot / 64] >> bit ) );
+    slot += ones;
+    if ( ones < 64 - bit )
+      break;
   }
-  return result;
+  return min( slot, last_slot ) - first_slot;
 }
 
-void Reassembler::set_close_flag() {
-  this->close_flag = true;
+uint64_t Reassembler::absent_run( uint64_t first_slot, uint64_t last_slot ) const
+{
+  // 和present_run一样，取反之后数1
+  uint64_t slot = first_slot;
+  while ( slot < last_slot ) {
+    const uint64_t bit = slot % 64;
+    const auto zeros = static_cast<uint64_t>( countr_one( ~present_[slot / 64] >> bit ) );
+    slot += zeros;
+    if ( zeros < 64 - bit )
+      break;
+  }
+  return min( slot, last_slot ) - first_slot;
+}
+
+uint64_t Reassembler::bytes_pending() const
+{
+  return pending_bytes_;
+}
+
+vector<pair<uint64_t, uint64_t>> Reassembler::pending_intervals() const
+{
+  if ( engine_ == Engine::Intervals )
+    return { intervals_.begin(), intervals_.end() };
+
+  // 位图引擎：从current_pos开始扫一整圈，交替数没到的和到了的
+  vector<pair<uint64_t, uint64_t>> intervals;
+  if ( pending_bytes_ == 0 )
+    return intervals;
+  const uint64_t end = current_pos + ring_.size();
+  uint64_t index = current_pos;
+  bool present = false;
+  while ( index < end ) {
+    const uint64_t slot = index % ring_.size();
+    const uint64_t last_slot = min( ring_.size(), slot + ( end - index ) );
+    const uint64_t run = present ? present_run( slot, last_slot ) : absent_run( slot, last_slot );
+    // 在环的末尾断开的一段，接到上一段后面
+    if ( present && run > 0 ) {
+      if ( !intervals.empty() && intervals.back().second == index )
+        intervals.back().second += run;
+      else
+        intervals.emplace_back( index, index + run );
+    }
+    index += run;
+    // 在last_slot之前停下，说明换了一种；数到环的末尾就从头接着数同一种
+    if ( slot + run < last_slot )
+      present = !present;
+  }
+  return intervals;
 }
@@ -1,13 +1,36 @@
 #pragma once
 
 #include "byte_stream.hh"
+#include <cstdint>
 #include <map>
+#include <utility>
+#include <vector>
+
+// Memory held by a Reassembler for bytes that arrived ahead of a gap
+struct ReassemblyStats
+{
+  uint64_t memory_used {};       // bytes of heap: map nodes plus string capacity (or the preallocated bitmap ring)
+  uint64_t peak_memory_used {};  // the most memory_used has ever been
+  uint64_t fragments_evicted {}; // fragments dropped to get back under budget
+  uint64_t bytes_evicted {};     // payload bytes in those fragments
+};
 
 class Reassembler
 {
 public:
+  // How the Reassembler keeps bytes that arrived ahead of a gap
+  enum class Engine : uint8_t
+  {
+    Intervals, // disjoint fragments in a std::map, allocated as they arrive
+    Bitmap,    // a ring of `capacity` bytes plus a presence bitmap, allocated once at construction
+  };
+
+  static constexpr uint64_t UNLIMITED = UINT64_MAX;
+
   // Construct Reassembler to write into given ByteStream.
-  explicit Reassembler( ByteStream&& output ) : output_( std::move( output ) ) {}
+  // Engine::Intervals evicts the fragments furthest from the next needed byte whenever this Reassembler holds more
+  // than `memory_limit` bytes, or all Reassemblers together hold more than the global limit.
+  explicit Reassembler( ByteStream&& output, Engine engine = Engine::Intervals, uint64_t memory_limit = UNLIMITED );
 
   /*
    * Insert a new substring to be reassembled into a ByteStream.
@@ -31,9 +54,27 @@ public:
    */
   void insert( uint64_t first_index, std::string data, bool is_last_substring );
 
+  // Grow the output stream's capacity, so bytes further ahead are accepted (Engine::Intervals only: the bitmap
+  // engine's ring is sized once, at construction)
+  void grow_capacity( uint64_t capacity );
+
   // How many bytes are stored in the Reassembler itself?
   uint64_t bytes_pending() const;
 
+  // The bytes stored in the Reassembler, as disjoint, non-adjacent [start, end) ranges of stream indices, in order
+  std::vector<std::pair<uint64_t, uint64_t>> pending_intervals() const;
+
+  // How many bytes has the Reassembler copied (to split a fragment, or into and out of the bitmap ring)?
+  // In-order data that arrives with nothing pending is moved straight into the output, and isn't counted.
+  uint64_t bytes_copied() const { return bytes_copied_; }
+
+  // Memory usage and eviction counters for this Reassembler
+  const ReassemblyStats& stats() const { return stats_; }
+
+  // Process-wide budget shared by every Reassembler (across threads)
+  static void set_global_memory_limit( uint64_t limit );
+  static uint64_t global_memory_used();
+
   // Access output stream reader
   Reader& reader() { return output_.reader(); }
   const Reader& reader() const { return output_.reader(); }
@@ -41,11 +82,72 @@ public:
   // Access output stream writer, but const-only (can't write from outside)
   const Writer& writer() const { return output_.writer(); }
 
-  void set_close_flag();
-
 private:
+  // Store the bytes of [start, end) (which are data[skip..]) that aren't stored yet, and merge them into intervals_
+  void store( uint64_t start, std::string data, uint64_t skip );
+
+  // Push every stored fragment that now starts at current_pos
+  void flush();
+
+  // Account for memory as fragments and intervals come and go, and evict while over budget
+  void add_memory( uint64_t bytes );
+  void release_memory( uint64_t bytes );
+  void enforce_budget();
+
+  // Engine::Bitmap: copy the bytes into their ring slots, then push the run that starts at current_pos
+  void store_in_ring( uint64_t start, std::string_view data );
+  uint64_t mark_present( uint64_t first_slot, uint64_t last_slot ); // returns how many bits were clear
+  void clear_present( uint64_t first_slot, uint64_t last_slot );
+  uint64_t present_run( uint64_t first_slot, uint64_t last_slot ) const; // length of the run of set bits
+  uint64_t absent_run( uint64_t first_slot, uint64_t last_slot ) const;  // length of the run of clear bits
+
   ByteStream output_; // the Reassembler writes to this ByteStream
-  std::map<uint64_t, std::string> fragments_map{};
+  Engine engine_;
+
+  // A stored fragment's bytes are data[skip..], so trimming its front doesn't copy it
+  struct Fragment
+  {
+    std::string data;
+    uint64_t skip;
+  };
+  static uint64_t fragment_memory( const Fragment& fragment ); // map node plus string capacity
+
+  // Stored bytes, as disjoint fragments keyed by stream index (each byte is stored at most once)
+  std::map<uint64_t, Fragment> fragments_map {};
+
+  // The same bytes as a set of disjoint, non-adjacent [start, end) intervals. Overlapping and touching
+  // fragments share one interval, so an insert only visits the intervals it actually overlaps.
+  std::map<uint64_t, uint64_t> intervals_ {};
+
+  // Engine::Bitmap: stream index i lives in ring_[i % ring_.size()], and bit (i % ring_.size()) of present_
+  // says whether it has arrived. The acceptable window never exceeds the capacity, so slots never collide.
+  std::string ring_ {};
+  std::vector<uint64_t> present_ {};
+
+  uint64_t pending_bytes_ = 0; // bytes stored and not yet pushed
+  uint64_t bytes_copied_ = 0;
+
+  // This Reassembler's share of the global usage: given back on destruction, and charged again for a copy
+  class GlobalCharge
+  {
+  public:
+    GlobalCharge() = default;
+    GlobalCharge( const GlobalCharge& other );
+    GlobalCharge& operator=( const GlobalCharge& other );
+    GlobalCharge( GlobalCharge&& other ) noexcept;
+    GlobalCharge& operator=( GlobalCharge&& other ) noexcept;
+    ~GlobalCharge();
+
+    void add( uint64_t bytes );
+    void release( uint64_t bytes );
+
+  private:
+    uint64_t bytes_ = 0;
+  };
+
+  uint64_t memory_limit_;
+  ReassemblyStats stats_ {};
+  GlobalCharge global_charge_ {};
   uint64_t current_pos = 0;
   bool close_flag = false;
 };
@@ -0,0 +1,188 @@
+#include "tcp_listener.hh"
+
+#include "exception.hh"
+
+#include <algorithm>
+#include <array>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <utility>
+
+using namespace std;
+
+namespace {
+
+// the longest the loop waits (for a datagram, a bridge, or a connection's timer) before it looks at abort_
+constexpr int POLL_MS = 100;
+
+pair<LocalStreamSocket, LocalStreamSocket> stream_socket_pair()
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_STREAM, 0, fds.data() ) );
+  return { LocalStreamSocket { FileDescriptor { fds[0] } }, LocalStreamSocket { FileDescriptor { fds[1] } } };
+}
+
+} // namespace
+
+TCPListener::TCPListener( FileDescriptor&& datagram_fd,
+                          const Address& address,
+                          const TCPConfig& cfg,
+                          size_t syn_backlog,
+                          size_t accept_backlog )
+  : loop_( move( datagram_fd ), address )
+  , port_( address.port() )
+  , accept_backlog_( accept_backlog )
+  , outbound_category_( loop_.eventloop().add_category( "push bytes from the owner to a connection" ) )
+  , inbound_category_( loop_.eventloop().add_category( "write bytes from a connection to the owner" ) )
+{
+  loop_.stack().listen( port_, cfg, syn_backlog, accept_backlog );
+  thread_ = thread( &TCPListener::serve, this );
+}
+
+TCPListener::~TCPListener()
+{
+  try {
+    abort_.store( true );
+    thread_.join();
+  } catch ( const exception& e ) {
+    cerr << "Exception destructing TCPListener: " << e.what() << "\n";
+  }
+}
+
+LocalStreamSocket TCPListener::accept()
+{
+  unique_lock lock { mutex_ };
+  accepted_.wait( lock, [&] { return not sockets_.empty() or stopped_; } );
+  if ( sockets_.empty() ) {
+    throw runtime_error( "TCPListener: the listener has stopped" );
+  }
+  LocalStreamSocket ret = move( sockets_.front() );
+  sockets_.pop();
+  return ret;
+}
+
+void TCPListener::serve()
+{
+  try {
+    while ( not abort_ ) {
+      if ( loop_.wait_next_event( POLL_MS ) == EventLoop::Result::Exit ) {
+        break;
+      }
+      accept_connections();
+      finish_bridges();
+    }
+  } catch ( const exception& e ) {
+    cerr << "TCPListener: " << e.what() << "\n";
+  }
+
+  {
+    const lock_guard lock { mutex_ };
+    stopped_ = true;
+  }
+  accepted_.notify_all();
+}
+
+//! \details A connection left in the stack's accept queue holds its place there, so when the owner falls
+//! behind, the stack's backlogs (not an unbounded queue here) decide what happens to new SYNs
+void TCPListener::accept_connections()
+{
+  while ( true ) {
+    {
+      const lock_guard lock { mutex_ };
+      if ( sockets_.size() >= accept_backlog_ ) {
+        return;
+      }
+    }
+
+    const auto id = loop_.stack().accept( port_ );
+    if ( not id.has_value() ) {
+      return;
+    }
+
+    auto [owner_end, thread_end] = stream_socket_pair();
+    add_bridge( *id, move( thread_end ) );
+    {
+      const lock_guard lock { mutex_ };
+      sockets_.push( move( owner_end ) );
+    }
+    accepted_.notify_one();
+  }
+}
+
+void TCPListener::add_bridge( TCPStack::ConnectionID id, LocalStreamSocket&& socket )
+{
+  auto& b = *bridges_.emplace_back( make_unique<Bridge>( id, move( socket ) ) );
+  b.socket.set_blocking( false );
+  TCPStack& stack = loop_.stack();
+
+  // read from the owner's socket into the connection's outbound stream
+  b.rules.push_back( loop_.eventloop().add_rule(
+    outbound_category_,
+    b.socket,
+    Direction::In,
+    [&b, &stack] {
+      Writer& outbound = stack.peer( b.id ).outbound_writer();
+      outbound.read_from( b.socket );
+      if ( b.socket.eof() ) {
+        outbound.close();
+        b.outbound_shutdown = true;
+      }
+      stack.push( b.id );
+    },
+    [&b, &stack] {
+      TCPPeer& peer = stack.peer( b.id );
+      return peer.active() and not b.outbound_shutdown and peer.outbound_writer().available_capacity() > 0;
+    },
+    [&b, &stack] {
+      stack.peer( b.id ).outbound_writer().close();
+      b.outbound_shutdown = true;
+    },
+    [&b, &stack] {
+      stack.peer( b.id ).outbound_writer().set_error();
+      b.outbound_shutdown = true;
+    } ) );
+
+  // write the connection's inbound stream to the owner's socket
+  b.rules.push_back( loop_.eventloop().add_rule(
+    inbound_category_,
+    b.socket,
+    Direction::Out,
+    [&b, &stack] {
+      Reader& inbound = stack.peer( b.id ).inbound_reader();
+      inbound.write_to( b.socket );
+      if ( inbound.is_finished() or inbound.has_error() ) {
+        b.socket.shutdown( SHUT_WR );
+        b.inbound_shutdown = true;
+      }
+    },
+    [&b, &stack] {
+      const Reader& inbound = stack.peer( b.id ).inbound_reader();
+      return not b.inbound_shutdown
+             and ( inbound.bytes_buffered() or inbound.is_finished() or inbound.has_error() );
+    },
+    [&b] { b.inbound_shutdown = true; },
+    [&b, &stack] {
+      stack.peer( b.id ).inbound_reader().set_error();
+      b.inbound_shutdown = true;
+    } ) );
+}
+
+//! \details A connection the stack has aborted is done once the owner has been told (its outbound stream
+//! will never be read again). The stack forgets a closed connection only when it is no longer active, so a
+//! bridge's ConnectionID stays valid until here.
+void TCPListener::finish_bridges()
+{
+  TCPStack& stack = loop_.stack();
+  erase_if( bridges_, [&]( const unique_ptr<Bridge>& b ) {
+    if ( not b->inbound_shutdown or ( not b->outbound_shutdown and stack.peer( b->id ).active() ) ) {
+      return false;
+    }
+    for ( auto& rule : b->rules ) {
+      rule.cancel();
+    }
+    stack.close( b->id );
+    return true;
+  } );
+}
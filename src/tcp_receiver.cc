@@ -1,13 +1,70 @@
 #include "tcp_receiver.hh"
 
+#include <algorithm>
+
 using namespace std;
 
+TCPReceiver::TCPReceiver( Reassembler&& reassembler, bool window_scaling, uint64_t max_capacity )
+  : reassembler_( std::move( reassembler ) ), max_capacity_( max_capacity )
+{
+  if ( !window_scaling )
+    return;
+  // 能让整个容量（自动调整的话是最大的容量）放进16位窗口的最小位移
+  const uint64_t capacity = max( reassembler_.writer().available_capacity(), max_capacity_ );
+  uint8_t shift = 0;
+  while ( shift < TCPSenderMessage::MAX_WINDOW_SCALE && ( capacity >> shift ) > UINT16_MAX )
+    shift++;
+  window_scale_ = shift;
+}
+
+void TCPReceiver::tick( uint64_t ms_since_last_tick )
+{
+  now_ms_ += ms_since_last_tick;
+  autotune();
+}
+
+void TCPReceiver::measure_rtt()
+{
+  // 没有时间戳选项，就像Linux那样看收齐一个窗口的数据要多久；发送方没被窗口限制住时会偏大，所以取小的
+  const uint64_t pushed = reassembler_.writer().bytes_pushed();
+  if ( rtt_edge_.has_value() && pushed >= *rtt_edge_ ) {
+    const uint64_t sample = max( now_ms_ - rtt_start_, uint64_t { 1 } );
+    rtt_ = rtt_ == 0 ? sample : min( sample, ( 7 * rtt_ + sample ) / 8 );
+    rtt_edge_.reset();
+  }
+  if ( !rtt_edge_.has_value() ) {
+    rtt_edge_ = pushed + reassembler_.writer().available_capacity();
+    rtt_start_ = now_ms_;
+  }
+}
+
+void TCPReceiver::autotune()
+{
+  if ( capacity() >= max_capacity_ || rtt_ == 0 || now_ms_ - drain_start_ < rtt_ )
+    return;
+  const uint64_t popped = reassembler_.reader().bytes_popped();
+  const uint64_t drained = popped - drain_popped_;
+  drain_popped_ = popped;
+  drain_start_ = now_ms_;
+  if ( drained <= most_drained_ )
+    return;
+  // 发送方下一个RTT可能发两倍（慢启动），缓冲区要能装下
+  most_drained_ = drained;
+  const uint64_t target = min( 2 * drained, max_capacity_ );
+  if ( target > capacity() )
+    reassembler_.grow_capacity( target );
+}
+
 void TCPReceiver::receive( TCPSenderMessage message )
 {
   if ( message.RST )
     this->reassembler_.reader().set_error();
-  if ( message.SYN )
+  if ( message.SYN ) {
     ISN = message.seqno;
+    sack_permitted_ = message.SACK_permitted;
+    // 两边都提供了才缩放（RFC 7323）
+    window_shift_ = window_scale_.has_value() && message.window_scale.has_value() ? *window_scale_ : 0;
+  }
   else if (!ackno_base.has_value())
     return;
   // 应该是seqno位置-当前位置 > this->reassembler_.writer().available_capacity(), UINT16_MAX
@@ -15,27 +72,55 @@ void TCPReceiver::receive( TCPSenderMessage message )
   else if (message.seqno.unwrap(ISN, absolute_seqno) <=
             ISN.unwrap(ISN, absolute_seqno))
     return;
-  this->reassembler_.insert(
-      message.seqno.unwrap( ISN, absolute_seqno ) - 1 + message.SYN,
-      message.payload,
-      message.FIN );
-  absolute_seqno += message.sequence_length();
+  // payload会被move进reassembler，先记下长度
+  const uint64_t sequence_length = message.sequence_length();
+  const uint64_t first_index = message.seqno.unwrap( ISN, absolute_seqno ) - 1 + message.SYN;
+  if ( first_index > this->reassembler_.writer().bytes_pushed() && !message.payload.empty() )
+    latest_out_of_order_ = first_index;
+  const bool has_payload = !message.payload.empty();
+  this->reassembler_.insert( first_index, std::move( message.payload ), message.FIN );
+  absolute_seqno += sequence_length;
   ackno_base = ackno_base.value_or(ISN) + message.SYN;
-  if (message.FIN) // FIN代表当前payload是end of the stream
-    this->reassembler_.set_close_flag();
+  if ( has_payload && max_capacity_ > 0 ) {
+    measure_rtt();
+    autotune();
+  }
 }
 
 TCPReceiverMessage TCPReceiver::send() const
 {
   // 发送ackno
-  auto window_size = this->reassembler_.writer().available_capacity();
+  auto window_size = this->reassembler_.writer().available_capacity() >> window_shift_;
 
   // window: available capacity in the output ByteStream
   // ackno: reassembler_.writer().bytes_pushed()，写成功了了几个，ackno就是几，再加ISN等
   auto pushedB = reassembler_.writer().bytes_pushed();
   if (reassembler_.writer().is_closed()) // ackno加上最后的FIN
     pushedB++;
-  return { ackno_base.has_value() ? optional<Wrap32>( ackno_base.value() + pushedB) : nullopt,
-           (window_size > UINT16_MAX) ? uint16_t (UINT16_MAX) : static_cast<uint16_t>(window_size),
-           this->reassembler_.reader().has_error()};
+  TCPReceiverMessage msg { ackno_base.has_value() ? optional<Wrap32>( ackno_base.value() + pushedB) : nullopt,
+                          (window_size > UINT16_MAX) ? uint16_t (UINT16_MAX) : static_cast<uint16_t>(window_size),
+                          this->reassembler_.reader().has_error(),
+                          {} };
+  if ( !sack_permitted_ || !ackno_base.has_value() || reassembler_.bytes_pending() == 0 )
+    return msg;
+
+  // SACK：reassembler里存着的区间就是收到了的块；最近收到的段所在的块放第一个（RFC 2018），其余的按顺序
+  const auto intervals = reassembler_.pending_intervals();
+  const auto to_block = [&]( const pair<uint64_t, uint64_t>& interval ) {
+    return SACKBlock { Wrap32::wrap( interval.first, ackno_base.value() ),
+                       Wrap32::wrap( interval.second, ackno_base.value() ) };
+  };
+  const auto latest = find_if( intervals.begin(), intervals.end(), [&]( const auto& interval ) {
+    return latest_out_of_order_.has_value() && interval.first <= *latest_out_of_order_ &&
+           *latest_out_of_order_ < interval.second;
+  } );
+  if ( latest != intervals.end() )
+    msg.sack_blocks.push_back( to_block( *latest ) );
+  for ( auto it = intervals.begin();
+        it != intervals.end() && msg.sack_blocks.size() < TCPReceiverMessage::MAX_SACK_BLOCKS;
+        ++it ) {
+    if ( it != latest )
+      msg.sack_blocks.push_back( to_block( *it ) );
+  }
+  return msg;
 }
@@ -7,8 +7,12 @@
 class TCPReceiver
 {
 public:
-  // Construct with given Reassembler
-  explicit TCPReceiver( Reassembler&& reassembler ) : reassembler_( std::move( reassembler ) ) {}
+  // Construct with given Reassembler.
+  // With window scaling, our SYN offers a window scale (RFC 7323) large enough to advertise the whole capacity,
+  // and once the peer's SYN has offered one too, the advertised windows are scaled down by it.
+  // With a `max_capacity` above the stream's capacity, the capacity grows as fast as the application drains the
+  // stream (receive-buffer autotuning): toward twice what it reads in a round trip, up to `max_capacity`.
+  explicit TCPReceiver( Reassembler&& reassembler, bool window_scaling = false, uint64_t max_capacity = 0 );
 
   /*
    * The TCPReceiver receives TCPSenderMessages, inserting their payload into the Reassembler
@@ -17,10 +21,21 @@ public:
   void receive( TCPSenderMessage message );
 
   // The TCPReceiver sends TCPReceiverMessages to the peer's TCPSender.
+  // If the peer's SYN permitted SACK, they also describe up to four blocks that arrived beyond the ackno.
   TCPReceiverMessage send() const;
 
+  // The window scale to offer in our SYN (none without window scaling)
+  std::optional<uint8_t> window_scale() const { return window_scale_; }
+
+  // Time has passed (receive-buffer autotuning measures round trips and drain rates with it)
+  void tick( uint64_t ms_since_last_tick );
+
+  uint64_t capacity() const { return reassembler_.writer().getCapacity(); } // Current size of the receive buffer
+  uint64_t rtt_estimate() const { return rtt_; } // How long a window takes to arrive, in ms (0 before the first)
+
   // Access the output (only Reader is accessible non-const)
   const Reassembler& reassembler() const { return reassembler_; }
+  const ReassemblyStats& reassembly_stats() const { return reassembler_.stats(); }
   Reader& reader() { return reassembler_.reader(); }
   const Reader& reader() const { return reassembler_.reader(); }
   const Writer& writer() const { return reassembler_.writer(); }
@@ -30,4 +45,23 @@ private:
   Wrap32 ISN{0};
   std::optional<Wrap32> ackno_base {std::nullopt}; // ISN + SYN + FIN，剩下的是加写成功了几个
   uint64_t absolute_seqno {0};
+  bool sack_permitted_ {false};                       // 对方的SYN带了SACK-permitted
+  std::optional<uint64_t> latest_out_of_order_ {};    // 最近一个乱序到达的段的stream index，它所在的块放第一个
+  std::optional<uint8_t> window_scale_ {};            // 我们的SYN里提供的窗口缩放
+  uint8_t window_shift_ {0};                          // 双方的SYN都带了窗口缩放之后，通告的窗口右移这么多位
+
+  // 接收缓冲区自动调整（类似Linux的DRS）：每个RTT看应用读走了多少，缓冲区往它的两倍长
+  uint64_t max_capacity_ {0};
+  uint64_t now_ms_ {0};
+  uint64_t rtt_ {0};                     // 收齐一个窗口的数据要多久，大致是一个RTT；0是还没测过
+  std::optional<uint64_t> rtt_edge_ {};  // 正在测的窗口的右沿（stream index）
+  uint64_t rtt_start_ {0};
+  uint64_t most_drained_ {0};            // 一个RTT里读走的最多字节数
+  uint64_t drain_popped_ {0};            // 这个RTT开始时已经读走的字节数
+  uint64_t drain_start_ {0};
+
+  // 收到数据的时候：窗口右沿的数据到了，就是测完了一个RTT，再从现在的右沿开始测下一个
+  void measure_rtt();
+  // 过了一个RTT：应用读得比以前都快，就把缓冲区长到读走的两倍
+  void autotune();
 };
@@ -1,6 +1,9 @@
 #include "tcp_sender.hh"
 #include "tcp_config.hh"
 
+#include <algorithm>
+#include <cmath>
+
 using namespace std;
 
 uint64_t TCPSender::sequence_numbers_in_flight() const
@@ -13,13 +16,258 @@ uint64_t TCPSender::consecutive_retransmissions() const
   return retrans_cnt;
 }
 
+uint64_t TCPSender::retransmissions() const
+{
+  return fast_retransmissions_ + timeout_retransmissions_;
+}
+
+uint64_t TCPSender::fast_retransmissions() const
+{
+  return fast_retransmissions_;
+}
+
+uint64_t TCPSender::timeout_retransmissions() const
+{
+  return timeout_retransmissions_;
+}
+
+uint64_t TCPSender::congestion_window() const
+{
+  return congestion_ ? congestion_->cwnd() : UINT64_MAX;
+}
+
+uint64_t TCPSender::slow_start_threshold() const
+{
+  return congestion_ ? congestion_->ssthresh() : UINT64_MAX;
+}
+
+double TCPSender::srtt() const
+{
+  return srtt_;
+}
+
+double TCPSender::rttvar() const
+{
+  return rttvar_;
+}
+
+uint64_t TCPSender::rto() const
+{
+  return retrans_RTO;
+}
+
+optional<uint64_t> TCPSender::ms_until_next_timer() const
+{
+  optional<uint64_t> next;
+  // 重传计时器只在有段在途时走
+  if (!flying_segments.empty())
+    next = retrans_RTO > retrans_timer ? retrans_RTO - retrans_timer : 0;
+  // pacing：额度用完了，等补充到能发下一个段
+  if (has_SYN && paced() && pacing_credit_ <= 0) {
+    const double ms = -pacing_credit_ * 1000 / static_cast<double>( congestion_->pacing_rate() );
+    next = min( next.value_or( UINT64_MAX ), static_cast<uint64_t>( ms ) + 1 );
+  }
+  return next;
+}
+
+uint64_t TCPSender::segment_size() const
+{
+  return mss_;
+}
+
+void TCPSender::set_peer_mss( uint64_t mss )
+{
+  // 没有MSS选项就只受本地MTU的限制
+  if (mss == 0)
+    return;
+  max_mss_ = min( max_mss_, mss );
+  mss_ = min( mss_, max_mss_ );
+  probe_high_ = min( probe_high_, max_mss_ );
+}
+
+void TCPSender::set_peer_window_scale( uint8_t shift )
+{
+  // 超过14的按14算（RFC 7323）
+  window_shift_ = min( shift, TCPSenderMessage::MAX_WINDOW_SCALE );
+}
+
+uint64_t TCPSender::message_limit() const
+{
+  if (!segmentation_.offload)
+    return mss_;
+  return max( mss_, TCPConfig::MAX_GSO_PAYLOAD_SIZE / mss_ * mss_ );
+}
+
+uint64_t TCPSender::next_probe_size() const
+{
+  if (!segmentation_.probe_mtu || probe_size_ > 0 || probe_high_ < mss_ + TCPConfig::MTU_PROBE_STEP)
+    return 0;
+  // 先直接试最大的：大多数路径要么都能过，要么马上就知道不行；丢过之后再二分
+  return probe_failed_ ? ( mss_ + probe_high_ + 1 ) / 2 : probe_high_;
+}
+
+void TCPSender::probe_succeeded()
+{
+  mss_ = probe_size_;
+  probe_size_ = 0;
+}
+
+void TCPSender::probe_lost( Outstanding& segment )
+{
+  // 探测段丢了就当作它太大了，以后的探测都比它小；重传时按确认过的段大小切开
+  segment.probe = false;
+  probe_high_ = probe_size_ - 1;
+  probe_size_ = 0;
+  probe_failed_ = true;
+}
+
+void TCPSender::update_rtt( uint64_t rtt )
+{
+  const auto sample = static_cast<double>( rtt );
+  if ( !has_rtt_sample_ ) {
+    srtt_ = sample;
+    rttvar_ = sample / 2;
+    has_rtt_sample_ = true;
+  } else {
+    // 先用旧的SRTT更新RTTVAR，再更新SRTT
+    rttvar_ = 0.75 * rttvar_ + 0.25 * abs( srtt_ - sample );
+    srtt_ = 0.875 * srtt_ + 0.125 * sample;
+  }
+
+  if ( !rto_bounds_.has_value() )
+    return;
+  // 时钟粒度是1ms；向上取整，再限制在上下限之间
+  const auto rto = static_cast<uint64_t>( ceil( srtt_ + max( 1.0, 4 * rttvar_ ) ) );
+  base_RTO = clamp( rto, rto_bounds_->min_ms, rto_bounds_->max_ms );
+}
+
+string TCPSender::read_payload( uint64_t offset, uint64_t len ) const
+{
+  // 要发的字节可能跨过ByteStream环形缓冲区的末尾，所以分段拷贝
+  string payload;
+  payload.reserve( len );
+  while ( payload.size() < len ) {
+    const auto view = this->input_.reader().peek( offset + payload.size() );
+    payload += view.substr( 0, len - payload.size() );
+  }
+  return payload;
+}
+
+TCPSenderMessage TCPSender::rebuild( const Outstanding& segment ) const
+{
+  // SYN占了序号0，payload从stream index 0开始；其他段的payload从序号-1开始
+  const uint64_t first_index = unwrap_seq_num(segment.seqno) + segment.SYN - 1;
+  TCPSenderMessage msg { segment.seqno, segment.SYN, "", segment.FIN, segment.RST, segment.SYN };
+  msg.payload = read_payload( first_index - this->reader().bytes_popped(), segment.payload_length );
+  if (segment.SYN)
+    msg.MSS = static_cast<uint16_t>( min( segmentation_.mss, uint64_t { UINT16_MAX } ) );
+  // 段大小可能变小了（探测段丢了，或者路径MTU变小了），按现在的大小切
+  msg.segment_size = mss_;
+  return msg;
+}
+
+void TCPSender::update_scoreboard( const TCPReceiverMessage& msg )
+{
+  for (const auto& block : msg.sack_blocks) {
+    const uint64_t begin = unwrap_seq_num(block.begin);
+    const uint64_t end = unwrap_seq_num(block.end);
+    // 不合理的块（超出发出去的范围）不管
+    if (begin >= end || end > unwrap_seq_num(seqno_))
+      continue;
+    highest_sacked_ = max( highest_sacked_, end );
+    for (size_t i = 0; i < flying_segments.size(); i++) {
+      // offload的超级段可能只有一部分被SACK了：在块的边上切开，SACK过的部分单独标记，恢复时不会再发
+      if (segmentation_.offload && !flying_segments[i].sacked && !flying_segments[i].probe) {
+        const uint64_t payload_start = unwrap_seq_num(flying_segments[i].seqno) + flying_segments[i].SYN;
+        const uint64_t payload_end = payload_start + flying_segments[i].payload_length;
+        if (begin > payload_start && begin < payload_end)
+          split_segment( i, begin - payload_start );
+        else if (end > payload_start && end < payload_end)
+          split_segment( i, end - payload_start );
+      }
+      auto& segment = flying_segments[i];
+      const uint64_t seqno = unwrap_seq_num(segment.seqno);
+      if (seqno >= end)
+        break;
+      if (seqno >= begin && seqno + segment.sequence_length() <= end) {
+        segment.sacked = true;
+        if (segment.probe) {
+          segment.probe = false;
+          probe_succeeded();
+        }
+      }
+    }
+  }
+}
+
+void TCPSender::split_segment( size_t index, uint64_t payload )
+{
+  Outstanding rest = flying_segments[index];
+  Outstanding& first = flying_segments[index];
+  rest.seqno = first.seqno + first.SYN + payload;
+  rest.payload_length = first.payload_length - payload;
+  rest.SYN = false;
+  first.payload_length = payload;
+  first.FIN = false;
+  flying_segments.insert( flying_segments.begin() + static_cast<ptrdiff_t>( index ) + 1, rest );
+}
+
+TCPSender::Outstanding& TCPSender::split_for_retransmission( Outstanding& segment )
+{
+  if (!segmentation_.offload || segment.payload_length <= mss_)
+    return segment;
+  const auto index = static_cast<size_t>( find_if( flying_segments.begin(), flying_segments.end(),
+                                                   [&]( const Outstanding& s ) { return &s == &segment; } )
+                                          - flying_segments.begin() );
+  split_segment( index, mss_ );
+  // 在中间插入会让deque的引用都失效，返回新的引用
+  return flying_segments[index];
+}
+
+TCPSender::Outstanding* TCPSender::next_hole()
+{
+  for (auto& segment : flying_segments) {
+    const bool first = &segment == &flying_segments.front();
+    // 最后一个SACK块之后的段，还不知道丢没丢
+    if (!first && unwrap_seq_num(segment.seqno) >= highest_sacked_)
+      break;
+    if (!segment.sacked && !segment.hole_retransmitted)
+      return &segment;
+  }
+  return nullptr;
+}
+
+uint64_t TCPSender::send_window() const
+{
+  return min( uint64_t { window_size_ }, congestion_window() );
+}
+
 void TCPSender::push( const TransmitFunction& transmit )
 {
-  while (sequence_numbers_in_flight() < window_size_ || (!had_FIN && this->input_.writer().is_closed()) )
+  // 快速重传：不等超时，也不受窗口和pacing的限制
+  if (retransmit_pending_) {
+    retransmit_pending_ = false;
+    if (auto* hole = next_hole(); hole != nullptr) {
+      if (hole->probe)
+        probe_lost( *hole );
+      hole = &split_for_retransmission( *hole );
+      transmit( rebuild( *hole ) );
+      hole->sent_at = now_ms_;
+      hole->retransmitted = true;
+      hole->hole_retransmitted = true;
+      fast_retransmissions_++;
+      retrans_timer = 0;
+    }
+  }
+
+  while (sequence_numbers_in_flight() < send_window() || (!had_FIN && this->input_.writer().is_closed()) )
   {
     // FIN会是最后一个消息
     if (had_FIN)
       return;
+    // pacing：额度用完了就等tick再发
+    if (paced() && pacing_credit_ <= 0)
+      return;
     TCPSenderMessage to_trans { seqno_, false, "", false, false };
     if ( this->input_.has_error() )
       to_trans.RST = true;
@@ -27,16 +275,24 @@ void TCPSender::push( const TransmitFunction& transmit )
     {
       to_trans.seqno = isn_;
       to_trans.SYN = true;
+      to_trans.SACK_permitted = true;
+      to_trans.MSS = static_cast<uint16_t>( min( segmentation_.mss, uint64_t { UINT16_MAX } ) );
       if (window_size_ == UINT32_MAX) // 如果没被初始化，就初始化
         window_size_ = 1;
       has_SYN = true;
     }
     // 已经被关闭了，准备FIN，且有空间发FIN；如果buffer大于等于window，那就是普通情况，等一下再发FIN
     // FIN不占payload的size，但是占window
-    // 需要考虑MAX_PAYLOAD_SIZE，要不然一个10000大小的payload，分成10次发，会每次都带FIN
+    // 需要考虑一个消息的大小限制，要不然一个10000大小的payload，分成10次发，会每次都带FIN
+    // SYN占一个序号但不在ByteStream里；对方在确认SYN之前就打开窗口时（两个TCPPeer互连），要把它去掉，否则会下溢
+    const uint64_t syn_in_flight = ( !to_trans.SYN && unwrap_seq_num( ackno_ ) == 0 ) ? 1 : 0;
+    const uint64_t payload_in_flight = sequence_numbers_in_flight() - syn_in_flight;
+    const uint64_t window_left
+      = send_window() > sequence_numbers_in_flight() ? send_window() - sequence_numbers_in_flight() : 0;
+
     if ( this->input_.writer().is_closed() &&
-         this->reader().bytes_buffered() < window_size_ &&
-         this->reader().bytes_buffered() - sequence_numbers_in_flight() <= TCPConfig::MAX_PAYLOAD_SIZE )
+         this->reader().bytes_buffered() < send_window() &&
+         this->reader().bytes_buffered() - payload_in_flight <= message_limit() )
     {
       // 测试会调用close方法，就关闭了
       if ( had_FIN ) // 发过了就不发了
@@ -45,24 +301,44 @@ void TCPSender::push( const TransmitFunction& transmit )
       had_FIN = true;
     }
 
-    // start from last byte + 1，但是如果Bytestream里面只有SYN，那就提取不出来内容，需要取min得到0
-    auto push_pos = min(this->reader().bytes_buffered(), sequence_numbers_in_flight());
-    // push的数量，现在缓存了多少个减去发出还没确认的个数，bytes_buffered肯定是>=sequence_numbers_in_flight的
-    // 同时循环也确定了sequence_numbers_in_flight() < window_size_，否则不进行push操作
+    // start from last byte + 1，已发出未确认的payload之后
+    auto push_pos = payload_in_flight;
+    // push的数量，现在缓存了多少个减去发出还没确认的payload个数
     // 减to_trans.SYN的原因是可能SYN和data一起，会占一个位置
-    auto push_num = this->reader().bytes_buffered() - sequence_numbers_in_flight();
-    push_num = min( push_num, window_size_ - sequence_numbers_in_flight() - to_trans.SYN);
-    push_num = min( push_num, TCPConfig::MAX_PAYLOAD_SIZE );
+    auto push_num = this->reader().bytes_buffered() - payload_in_flight;
+    push_num = min( push_num, window_left - min( window_left, uint64_t { to_trans.SYN } ) );
+    // PLPMTUD：数据和窗口都够的时候，这个段就当作探测段，按探测的大小发
+    const uint64_t probe_size = next_probe_size();
+    const bool probe = probe_size > 0 && !to_trans.SYN && !to_trans.FIN && push_num >= probe_size;
+    push_num = min( push_num, probe ? probe_size : message_limit() );
+    to_trans.segment_size = probe ? probe_size : mss_;
+    if (probe)
+      probe_size_ = probe_size;
 
     if ( push_num + to_trans.SYN + to_trans.FIN == 0) // 如果所有内容全空，规格错误，就不发送
       return;
 
-    to_trans.payload = string( this->input_.reader().peek().substr( push_pos, push_num ) );
+    to_trans.payload = read_payload( push_pos, push_num );
 
     seqno_ = seqno_ + to_trans.payload.size() + to_trans.SYN + to_trans.FIN;
 
     transmit( to_trans );
-    flying_segments.push( to_trans );
+    if (flying_segments.empty()) // 空闲之后重新开始算投递速率，不把空闲的时间算进去
+      delivered_time_ = now_ms_;
+    flying_segments.push_back( { to_trans.seqno,
+                                 to_trans.payload.size(),
+                                 to_trans.SYN,
+                                 to_trans.FIN,
+                                 to_trans.RST,
+                                 now_ms_,
+                                 delivered_,
+                                 delivered_time_,
+                                 false,
+                                 false,
+                                 false,
+                                 probe } );
+    if (paced())
+      pacing_credit_ -= static_cast<double>( to_trans.sequence_length() );
   }
 }
 
@@ -71,7 +347,7 @@ TCPSenderMessage TCPSender::make_empty_message() const
   return { seqno_, false, "", false, this->input_.has_error()};
 }
 
-void TCPSender::receive( const TCPReceiverMessage& msg )
+void TCPSender::receive( const TCPReceiverMessage& msg, bool occupies_seqno )
 {
   // receive后，测试的调用会自动触发push
   if (msg.RST)
@@ -79,7 +355,37 @@ void TCPSender::receive( const TCPReceiverMessage& msg )
   if (msg.ackno.has_value() && has_SYN) {
 
     auto &new_ackno = msg.ackno.value();
+    const uint64_t previously_acked = unwrap_seq_num(ackno_);
     auto &first_fly_ele = flying_segments.front();
+    update_scoreboard( msg );
+    // 重复ACK：还有没确认的数据，ackno和窗口都没变。第三个说明后面的段到了，最早的那个丢了
+    // 快速重传属于拥塞控制（RFC 5681），没有拥塞控制时还是只靠超时重传
+    // （和上一个ACK的窗口比：ackno没变的ACK不会更新window_size_）
+    // 带数据、SYN或FIN的段不算（RFC 5681）：双向传输时对方的数据段ackno也常常不变
+    const bool same_window = msg.window_size == last_ack_window_;
+    last_ack_window_ = msg.window_size;
+    if (congestion_ && !occupies_seqno && !flying_segments.empty() &&
+        unwrap_seq_num(new_ackno) == previously_acked && same_window) {
+      dup_acks_++;
+      if (in_recovery_) {
+        congestion_->on_duplicate_ack();
+        // 有SACK的话，每个重复ACK都说明又有一个段离开了网络，可以补一个空洞
+        if (highest_sacked_ > previously_acked)
+          retransmit_pending_ = true;
+      } else if (dup_acks_ == TCPConfig::DUP_ACK_THRESHOLD && first_fly_ele.probe) {
+        // 丢的是探测段：多半是太大了过不去，不是拥塞，不减窗口，切成原来的段大小重传（RFC 4821）
+        probe_lost( first_fly_ele );
+        retransmit_pending_ = true;
+      } else if (dup_acks_ == TCPConfig::DUP_ACK_THRESHOLD && previously_acked >= recover_) {
+        // 上次恢复（或者超时）时已经发出去的数据还没确认完，就不再进入恢复，免得一次丢包减两次窗口
+        in_recovery_ = true;
+        recover_ = unwrap_seq_num(seqno_);
+        retransmit_pending_ = true;
+        for (auto& segment : flying_segments)
+          segment.hole_retransmitted = false;
+        congestion_->on_fast_retransmit(sequence_numbers_in_flight(), now_ms_);
+      }
+    }
     // ackno不能大于seqno
     if (unwrap_seq_num(new_ackno) > unwrap_seq_num(seqno_))
       return;
@@ -91,7 +397,8 @@ void TCPSender::receive( const TCPReceiverMessage& msg )
          !this->writer().is_closed())
       return;
     // 如果接收的ack不够弹出fly的第一个块，那么ack不算数
-    if (!flying_segments.empty() &&
+    // （offload时除外：超级段在IP层切成了好几个数据报，接收方每个都会ACK，见下面）
+    if (!segmentation_.offload && !flying_segments.empty() &&
          unwrap_seq_num(new_ackno) > unwrap_seq_num(ackno_) &&
          unwrap_seq_num(new_ackno) - unwrap_seq_num(ackno_) < first_fly_ele.sequence_length())
       return;
@@ -107,15 +414,75 @@ void TCPSender::receive( const TCPReceiverMessage& msg )
     ackno_ = msg.ackno.value();
 
     // 当前ackno已经超过了之前的
-    while (!flying_segments.empty() && unwrap_seq_num(ackno_) > unwrap_seq_num(flying_segments.front().seqno))
-      flying_segments.pop();
+    optional<Outstanding> newest_acked;
+    bool acked_retransmission = false;
+    while (!flying_segments.empty() &&
+           unwrap_seq_num(ackno_) >= unwrap_seq_num(flying_segments.front().seqno) +
+                                       flying_segments.front().sequence_length()) {
+      acked_retransmission |= flying_segments.front().retransmitted;
+      if (flying_segments.front().probe)
+        probe_succeeded();
+      newest_acked = std::move( flying_segments.front() );
+      flying_segments.pop_front();
+    }
+    // offload时只确认了第一个段的前几个数据报：把确认了的部分剪掉，后面丢了数据报时，重复ACK的ackno才对得上
+    if (!flying_segments.empty() && unwrap_seq_num(ackno_) > unwrap_seq_num(flying_segments.front().seqno)) {
+      auto& front = flying_segments.front();
+      const uint64_t acked = unwrap_seq_num(ackno_) - unwrap_seq_num(front.seqno);
+      acked_retransmission |= front.retransmitted;
+      newest_acked = front;
+      front.payload_length -= acked - front.SYN;
+      front.seqno = ackno_;
+      front.SYN = false;
+    }
+
+    if (unwrap_seq_num(ackno_) > previously_acked) {
+      const uint64_t newly_acked = unwrap_seq_num(ackno_) - previously_acked;
+      dup_acks_ = 0;
+      // 快速恢复中确认了新数据：全部确认就结束恢复；只确认了一部分，说明下一个段也丢了，NewReno马上重传它
+      bool ended_recovery = false;
+      if (in_recovery_) {
+        if (unwrap_seq_num(ackno_) >= recover_) {
+          in_recovery_ = false;
+          ended_recovery = true;
+          congestion_->on_recovery_exit();
+        } else if (congestion_->on_partial_ack(newly_acked)) {
+          retransmit_pending_ = true;
+        } else {
+          in_recovery_ = false;
+          ended_recovery = true;
+        }
+      }
+      delivered_ += newly_acked;
+      delivered_time_ = now_ms_;
+      // Karn：确认里只要有重传过的段就不能测，不知道确认的是哪一次发送；
+      // 补上空洞的ACK同时确认了后面早就到了的段，用它们的发送时间算也会偏大
+      const bool can_measure = newest_acked.has_value() && !acked_retransmission;
+      if (can_measure)
+        update_rtt( now_ms_ - newest_acked->sent_at );
+      if (congestion_) {
+        if (can_measure) {
+          const uint64_t interval = max( now_ms_ - newest_acked->delivered_at, uint64_t { 1 } );
+          congestion_->on_rate_sample( { ( delivered_ - newest_acked->delivered ) * 1000 / interval,
+                                         now_ms_ - newest_acked->sent_at,
+                                         newest_acked->delivered,
+                                         delivered_,
+                                         sequence_numbers_in_flight() },
+                                       now_ms_ );
+        }
+        // 恢复期间以及结束恢复的那个ACK不涨窗口，窗口已经由恢复过程决定了
+        if (!in_recovery_ && !ended_recovery)
+          congestion_->on_ack(newly_acked, now_ms_);
+      }
+      // 确认了新数据才重启计时器、清掉退避（RFC 6298 5.3）；重复ACK和旧的ACK不能推迟超时
+      retrans_cnt = 0;
+      retrans_timer = 0;
+      retrans_RTO = base_RTO;
+    }
   }
   if (msg.window_size != 0)
   {
-    window_size_ = msg.window_size;
-    retrans_cnt = 0;
-    retrans_timer = 0;
-    retrans_RTO = initial_RTO_ms_;
+    window_size_ = uint32_t { msg.window_size } << window_shift_;
     zero_window = false;
   }
   else // window_size = 0，特判
@@ -127,6 +494,17 @@ void TCPSender::receive( const TCPReceiverMessage& msg )
 
 void TCPSender::tick( uint64_t ms_since_last_tick, const TransmitFunction& transmit )
 {
+  now_ms_ += ms_since_last_tick;
+
+  // pacing：按速率补充额度，最多攒下这次tick的量（至少两个段），再把能发的发出去
+  if (paced()) {
+    const double earned = static_cast<double>( congestion_->pacing_rate() * ms_since_last_tick ) / 1000;
+    const double burst = max( earned, 2.0 * static_cast<double>( mss_ ) );
+    pacing_credit_ = min( pacing_credit_ + earned, burst );
+    if (has_SYN)
+      push( transmit );
+  }
+
   // retransmit ackno_ to seqno_ - 1
   if (flying_segments.empty())
     return;
@@ -136,18 +514,45 @@ void TCPSender::tick( uint64_t ms_since_last_tick, const TransmitFunction& trans
     if (window_size_ != 0 && !zero_window) // 重传时间翻倍
     {
       retrans_RTO <<= 1;
+      if (rto_bounds_.has_value())
+        retrans_RTO = min( retrans_RTO, rto_bounds_->max_ms );
       retrans_cnt++;
+      // 超时说明网络拥塞了（零窗口探测不算）
+      if (congestion_)
+        congestion_->on_timeout(sequence_numbers_in_flight(), now_ms_);
+      // 超时后结束快速恢复；已经发出去的数据引起的重复ACK不再触发快速重传
+      in_recovery_ = false;
+      dup_acks_ = 0;
+      recover_ = unwrap_seq_num(seqno_);
+      // 接收方可能已经把SACK过的数据丢掉了（RFC 2018），记分板重新来过
+      highest_sacked_ = 0;
+      for (auto& segment : flying_segments)
+        segment.sacked = false;
+      // PLPMTUD：大段连着超时，可能是路径的MTU变小了（黑洞），退回基础大小重新探测
+      const auto& front = flying_segments.front();
+      if (segmentation_.probe_mtu && retrans_cnt >= 2 && !front.probe && mss_ > TCPConfig::MAX_PAYLOAD_SIZE &&
+          front.payload_length > TCPConfig::MAX_PAYLOAD_SIZE) {
+        mss_ = min( TCPConfig::MAX_PAYLOAD_SIZE, max_mss_ );
+        probe_high_ = max_mss_;
+        probe_failed_ = false;
+      }
     }
     retrans_timer = 0;
 
     if (!flying_segments.empty())
     {
-      transmit( flying_segments.front() ); // 重传第一段
+      if (flying_segments.front().probe)
+        probe_lost( flying_segments.front() );
+      split_for_retransmission( flying_segments.front() );
+      transmit( rebuild( flying_segments.front() ) ); // 重传第一段
+      flying_segments.front().sent_at = now_ms_;
+      flying_segments.front().retransmitted = true;
+      timeout_retransmissions_++;
     }
     else
     {
       retrans_cnt = 0;
-      retrans_RTO = initial_RTO_ms_;
+      retrans_RTO = base_RTO;
     }
   }
 }
@@ -1,34 +1,80 @@
 #pragma once
 
 #include "byte_stream.hh"
+#include "congestion_controller.hh"
 #include "tcp_receiver_message.hh"
 #include "tcp_sender_message.hh"
 #include "tcp_config.hh"
 
+#include <algorithm>
 #include <cstdint>
+#include <deque>
 #include <functional>
 #include <list>
 #include <memory>
 #include <optional>
-#include <queue>
 
 class TCPSender
 {
 public:
-  /* Construct TCP sender with given default Retransmission Timeout and possible ISN */
-  TCPSender( ByteStream&& input, Wrap32 isn, uint64_t initial_RTO_ms )
-    : input_( std::move( input ) ), isn_( isn ), initial_RTO_ms_( initial_RTO_ms )
+  /* Floor and ceiling for an RTO computed from measured round-trip times */
+  struct RTOBounds
+  {
+    uint64_t min_ms;
+    uint64_t max_ms;
+  };
+
+  /* How large the segments are. Each carries at most `mss` bytes of payload, or less if the peer's SYN
+   * advertises a smaller MSS. With `offload`, a message carries several segments for the datagram adapter to
+   * split; ACKs for some of them are taken as they come, and a retransmission resends one segment. With
+   * `probe_mtu`, segments start at TCPConfig::MAX_PAYLOAD_SIZE and grow as larger probe segments get through
+   * (packetization-layer path MTU discovery, RFC 4821). */
+  struct Segmentation
+  {
+    uint64_t mss;
+    bool offload;
+    bool probe_mtu;
+  };
+
+  /* Construct TCP sender with given default Retransmission Timeout and possible ISN.
+   * With a congestion controller, no more than its congestion window is kept in flight, and a segment is
+   * retransmitted after three duplicate ACKs (fast retransmit) instead of only when the timer expires.
+   * If the receiver sends selective acknowledgments, fast recovery retransmits only the segments it is missing.
+   * With RTO bounds, the RTO follows the measured RTT (RFC 6298) instead of staying at its initial value. */
+  TCPSender( ByteStream&& input,
+             Wrap32 isn,
+             uint64_t initial_RTO_ms,
+             std::unique_ptr<CongestionController> congestion = nullptr,
+             std::optional<RTOBounds> rto_bounds = std::nullopt,
+             Segmentation segmentation = { TCPConfig::MAX_PAYLOAD_SIZE, false, false } )
+    : input_( std::move( input ) )
+    , isn_( isn )
+    , congestion_( std::move( congestion ) )
+    , rto_bounds_( rto_bounds )
+    , segmentation_( segmentation )
+    , max_mss_( segmentation.mss )
+    , mss_( segmentation.probe_mtu ? std::min( segmentation.mss, TCPConfig::MAX_PAYLOAD_SIZE ) : segmentation.mss )
+    , probe_high_( segmentation.mss )
   {
     seqno_ = isn;
     ackno_ = isn;
     retrans_RTO = initial_RTO_ms;
+    base_RTO = initial_RTO_ms;
   }
 
   /* Generate an empty TCPSenderMessage */
   TCPSenderMessage make_empty_message() const;
 
-  /* Receive and process a TCPReceiverMessage from the peer's receiver */
-  void receive( const TCPReceiverMessage& msg );
+  /* Receive and process a TCPReceiverMessage from the peer's receiver. `occupies_seqno` says the segment that
+   * carried it also carried data, a SYN or a FIN: such a segment is never counted as a duplicate ACK. */
+  void receive( const TCPReceiverMessage& msg, bool occupies_seqno = false );
+
+  /* The peer's SYN advertised an MSS of `mss` bytes (0 if it had no MSS option) */
+  void set_peer_mss( uint64_t mss );
+
+  /* The peer's SYN offered a window scale of `shift`, and ours did too (RFC 7323): the windows in its later
+   * messages are shifted left by that many bits */
+  void set_peer_window_scale( uint8_t shift );
 
   /* Type of the `transmit` function that the push and tick methods can use to send messages */
   using TransmitFunction = std::function<void( const TCPSenderMessage& )>;
@@ -36,7 +82,8 @@ public:
   /* Push bytes from the outbound stream */
   void push( const TransmitFunction& transmit );
 
-  /* Time has passed by the given # of milliseconds since the last time the tick() method was called */
+  /* Time has passed by the given # of milliseconds since the last time the tick() method was called.
+   * When the congestion controller paces transmissions, this is also when the paced segments go out. */
   void tick( uint64_t ms_since_last_tick, const TransmitFunction& transmit );
 
   /* unwarp here with isn_ and total bytes */
@@ -45,6 +92,16 @@ public:
   // Accessors
   uint64_t sequence_numbers_in_flight() const;  // How many sequence numbers are outstanding?
   uint64_t consecutive_retransmissions() const; // How many consecutive *re*transmissions have happened?
+  uint64_t retransmissions() const;             // How many segments have been sent again, in total?
+  uint64_t fast_retransmissions() const;        // ... of those, after duplicate or partial ACKs
+  uint64_t timeout_retransmissions() const;     // ... of those, when the retransmission timer expired
+  uint64_t congestion_window() const;           // UINT64_MAX without a congestion controller
+  uint64_t slow_start_threshold() const;        // UINT64_MAX without a congestion controller
+  double srtt() const;                          // Smoothed RTT in ms (0 before the first measurement)
+  double rttvar() const;                        // RTT variation in ms (0 before the first measurement)
+  uint64_t segment_size() const;                // Payload per segment, grown by path MTU discovery
+  uint64_t rto() const;                         // Current retransmission timeout in ms, including backoff
+  std::optional<uint64_t> ms_until_next_timer() const; // When tick() next has work to do (nothing: no timer runs)
   Writer& writer() { return input_.writer(); }
   const Writer& writer() const { return input_.writer(); }
 
@@ -55,15 +112,96 @@ private:
   // Variables initialized in constructor
   ByteStream input_;
   Wrap32 isn_;
-  uint64_t initial_RTO_ms_;
-  uint32_t window_size_ = UINT32_MAX; // 实际上只能有uint16，但是这样就可以判断是否被初始化了
+  std::unique_ptr<CongestionController> congestion_;
+  std::optional<RTOBounds> rto_bounds_;
+  Segmentation segmentation_;
+  uint64_t max_mss_; // 本地的MSS和对方SYN里的MSS取小的
+  uint64_t mss_;     // 现在的段大小；PLPMTUD时是确认过能通过的最大的段
+  // PLPMTUD（RFC 4821）：在mss_和probe_high_之间找路径能通过的最大段
+  uint64_t probe_high_;       // 还没发现过不了的最大段
+  uint64_t probe_size_ = 0;   // 在途的探测段的payload大小，0是没有探测在途
+  bool probe_failed_ = false; // 丢过探测段之后改成二分查找
+  uint32_t window_size_ = UINT32_MAX; // 缩放之后最多UINT16_MAX<<14，UINT32_MAX就表示还没被初始化
+  uint8_t window_shift_ = 0;          // 对方通告的窗口要左移的位数
   bool has_SYN = false;
   Wrap32 seqno_{0};
   Wrap32 ackno_{0};
   uint64_t retrans_cnt = 0;
   uint64_t retrans_timer = 0;
   uint64_t retrans_RTO = 0;
-  std::queue<TCPSenderMessage> flying_segments{};
+  uint64_t base_RTO = 0; // 没有退避时的RTO：固定为初始值，或者按RTT算出来的
+  // 发出去还没确认的段，以及发送时的状态（用来测RTT和投递速率）。
+  // 只记序号、长度和标志：payload还在没pop的ByteStream里，重传时再从那里取出来
+  struct Outstanding
+  {
+    Wrap32 seqno;
+    uint64_t payload_length;
+    bool SYN;
+    bool FIN;
+    bool RST;
+    uint64_t sent_at;      // 最近一次发送的时间
+    uint64_t delivered;    // 发送时已经确认了多少
+    uint64_t delivered_at; // 那次确认的时间
+    bool retransmitted;
+    bool sacked;             // 接收方用SACK确认过了，不用重传
+    bool hole_retransmitted; // 这次快速恢复里已经当作空洞重传过了
+    bool probe;              // PLPMTUD的探测段，还不知道能不能通过
+
+    uint64_t sequence_length() const { return SYN + payload_length + FIN; }
+  };
+  std::deque<Outstanding> flying_segments{};
   bool had_FIN = false;
   bool zero_window = false;
+  uint64_t now_ms_ = 0; // 所有tick加起来的时间，给拥塞控制用
+  uint64_t fast_retransmissions_ = 0;
+  uint64_t timeout_retransmissions_ = 0;
+  // 快速重传和快速恢复（RFC 5681、RFC 6582）
+  uint64_t dup_acks_ = 0;            // 连续收到的重复ACK个数
+  uint16_t last_ack_window_ = 0;     // 上一个ACK里的窗口
+  bool in_recovery_ = false;         // 在快速恢复中
+  uint64_t recover_ = 0;             // 进入快速恢复（或者超时）时发到了哪里，确认到这里才算恢复完
+  bool retransmit_pending_ = false;  // 下次push时先重传下一个空洞（receive没有transmit可用）
+  uint64_t highest_sacked_ = 0;      // SACK块的最大右边界（绝对序号），它前面没确认的段就是空洞
+  uint64_t delivered_ = 0;      // 一共确认了多少序号
+  uint64_t delivered_time_ = 0; // 最近一次确认新数据的时间
+  double pacing_credit_ = 0;    // pacing时还能发多少字节，tick时按pacing rate补充
+  double srtt_ = 0;
+  double rttvar_ = 0;
+  bool has_rtt_sample_ = false;
+
+  // RFC 6298：用一个RTT样本更新SRTT、RTTVAR和RTO
+  void update_rtt( uint64_t rtt );
+
+  // 从ByteStream里第一个没pop的字节往后offset处，拷出len个字节（可能跨过环形缓冲区的末尾）
+  std::string read_payload( uint64_t offset, uint64_t len ) const;
+
+  // 重传时按记录重新拼出整个段
+  TCPSenderMessage rebuild( const Outstanding& segment ) const;
+
+  // SACK记分板：标记被SACK块完整覆盖的段
+  void update_scoreboard( const TCPReceiverMessage& msg );
+
+  // 把第index个段切成两个记录，前面的带payload个字节
+  void split_segment( size_t index, uint64_t payload );
+
+  // offload的超级段重传时只重传第一个段：把记录切成两个，后面的部分等SACK或者下一次重传。返回前面那个
+  Outstanding& split_for_retransmission( Outstanding& segment );
+
+  // 快速恢复要重传的下一个段：最早的段，或者有SACK时后面有段到了的空洞；没有就返回nullptr
+  Outstanding* next_hole();
+
+  // 一个消息最多带多少payload：一个段，或者segmentation offload时整数个段
+  uint64_t message_limit() const;
+
+  // PLPMTUD：下一个探测段的大小，不用探测就是0
+  uint64_t next_probe_size() const;
+
+  // 探测段被确认（或者SACK）了，这么大的段能通过；丢了，说明太大
+  void probe_succeeded();
+  void probe_lost( Outstanding& segment );
+
+  bool paced() const { return congestion_ && congestion_->pacing_rate() > 0; }
+
+  // 能发的序号数：接收方的窗口和拥塞窗口取小的
+  uint64_t send_window() const;
 };
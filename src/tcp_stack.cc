@@ -0,0 +1,439 @@
+#include "tcp_stack.hh"
+
+#include "ipv4_header.hh"
+#include "parser.hh"
+#include "random.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_segment.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+namespace {
+
+uint64_t timestamp_ms()
+{
+  return chrono::duration_cast<chrono::milliseconds>( chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+} // namespace
+
+TCPStack::TCPStack( shared_ptr<OutputPort> port, const Address& ip_address )
+  : port_( move( port ) )
+  , ip_address_( ip_address.ipv4_numeric() )
+  , rd_( get_random_engine() )
+  , table_( uniform_int_distribution<uint64_t> {}( rd_ ) )
+  , cookies_( { uniform_int_distribution<uint64_t> {}( rd_ ), uniform_int_distribution<uint64_t> {}( rd_ ) } )
+{}
+
+TCPStack::Connection& TCPStack::connection( ConnectionID id )
+{
+  if ( not contains( id ) ) {
+    throw runtime_error( "TCPStack: no connection " + to_string( id ) );
+  }
+  return *connections_[id];
+}
+
+const TCPStack::Connection& TCPStack::connection( ConnectionID id ) const
+{
+  if ( not contains( id ) ) {
+    throw runtime_error( "TCPStack: no connection " + to_string( id ) );
+  }
+  return *connections_[id];
+}
+
+TCPStack::Listener& TCPStack::listener( uint16_t port )
+{
+  const auto it = listeners_.find( port );
+  if ( it == listeners_.end() ) {
+    throw runtime_error( "TCPStack: not listening on port " + to_string( port ) );
+  }
+  return it->second;
+}
+
+const TCPStack::Listener& TCPStack::listener( uint16_t port ) const
+{
+  const auto it = listeners_.find( port );
+  if ( it == listeners_.end() ) {
+    throw runtime_error( "TCPStack: not listening on port " + to_string( port ) );
+  }
+  return it->second;
+}
+
+TCPPeer::TransmitFunction TCPStack::transmit_for( const FourTuple& tuple )
+{
+  return [this, tuple]( const TCPMessage& msg ) {
+    for ( const auto& dgram : TCPOverIPv4Adapter::wrap_tcp_in_ip( msg, tuple ) ) {
+      port_->transmit( *this, dgram );
+    }
+  };
+}
+
+TCPStack::ConnectionID TCPStack::add( const FourTuple& tuple, TCPConfig cfg, Wrap32 isn )
+{
+  cfg.isn = isn;
+
+  ConnectionID id {};
+  if ( free_ids_.empty() ) {
+    id = static_cast<ConnectionID>( connections_.size() );
+    connections_.emplace_back();
+  } else {
+    id = free_ids_.back();
+    free_ids_.pop_back();
+  }
+  connections_[id] = make_unique<Connection>( Connection { tuple, TCPPeer { cfg } } );
+  connections_[id]->ticked_at = now_ms_;
+  table_.insert( tuple, id );
+  return id;
+}
+
+//! \details The search for a free port starts at a random one, and takes the first whose 4-tuple is unused
+TCPStack::ConnectionID TCPStack::connect( const Address& remote, const TCPConfig& cfg )
+{
+  constexpr uint32_t port_count = EPHEMERAL_PORT_MAX - EPHEMERAL_PORT_MIN + 1;
+  const uint32_t start = uniform_int_distribution<uint32_t> { 0, port_count - 1 }( rd_ );
+
+  FourTuple tuple { .local_ip = ip_address_, .remote_ip = remote.ipv4_numeric(), .remote_port = remote.port() };
+  for ( uint32_t i = 0; i < port_count; ++i ) {
+    tuple.local_port = static_cast<uint16_t>( EPHEMERAL_PORT_MIN + ( start + i ) % port_count );
+    if ( table_.find( tuple ) == nullptr ) {
+      const ConnectionID id = add( tuple, cfg, random_isn() );
+      push( id );
+      return id;
+    }
+  }
+
+  throw runtime_error( "TCPStack: no free port to connect to " + remote.to_string() );
+}
+
+void TCPStack::listen( uint16_t port, const TCPConfig& cfg, size_t syn_backlog, size_t accept_backlog )
+{
+  if ( listeners_.contains( port ) ) {
+    throw runtime_error( "TCPStack: already listening on port " + to_string( port ) );
+  }
+  listeners_.emplace( port, Listener { cfg, syn_backlog, accept_backlog } );
+}
+
+optional<TCPStack::ConnectionID> TCPStack::accept( uint16_t port )
+{
+  Listener& l = listener( port );
+  if ( l.accept_queue.empty() ) {
+    return {};
+  }
+  const ConnectionID id = l.accept_queue.front();
+  l.accept_queue.pop();
+  connections_[id]->listener.reset();
+  connections_[id]->queued = false;
+  return id;
+}
+
+void TCPStack::receive( const InternetDatagram& dgram )
+{
+  TCPSegment seg;
+  if ( dgram.header.dst != ip_address_ or dgram.header.proto != IPv4Header::PROTO_TCP
+       or not parse( seg, dgram.payload, dgram.header.pseudo_checksum() ) ) {
+    ++stats_.bad_datagrams;
+    return;
+  }
+
+  const FourTuple tuple {
+    .local_ip = dgram.header.dst,
+    .remote_ip = dgram.header.src,
+    .local_port = seg.udinfo.dst_port,
+    .remote_port = seg.udinfo.src_port,
+  };
+
+  ConnectionID id {};
+  if ( const ConnectionID* found = table_.find( tuple ) ) {
+    id = *found;
+    catch_up( *connections_[id] );
+  } else if ( const auto it = listeners_.find( tuple.local_port ); it != listeners_.end() ) {
+    const auto opened = open_passive( tuple, it->second, seg.message );
+    if ( not opened.has_value() ) {
+      return;
+    }
+    id = *opened;
+  } else {
+    ++stats_.unmatched_segments;
+    return;
+  }
+
+  Connection& c = *connections_[id];
+  c.peer.receive( move( seg.message ), transmit_for( c.tuple ) );
+  settle( id );
+}
+
+optional<TCPStack::ConnectionID> TCPStack::open_passive( const FourTuple& tuple,
+                                                         Listener& l,
+                                                         const TCPMessage& msg )
+{
+  if ( msg.sender.RST ) {
+    ++stats_.unmatched_segments;
+    return {};
+  }
+
+  if ( not msg.sender.SYN ) {
+    if ( l.cfg.syn_cookies and msg.receiver.ackno.has_value() ) {
+      return open_from_cookie( tuple, l, msg );
+    }
+    ++stats_.unmatched_segments;
+    return {};
+  }
+
+  if ( msg.receiver.ackno.has_value() ) {
+    ++stats_.unmatched_segments;
+    return {};
+  }
+
+  if ( l.half_open >= l.syn_backlog ) {
+    if ( l.cfg.syn_cookies ) {
+      send_cookie( tuple, l.cfg, msg.sender );
+    } else {
+      ++stats_.syn_drops;
+    }
+    return {};
+  }
+
+  const ConnectionID id = add( tuple, l.cfg, random_isn() );
+  connections_[id]->listener = tuple.local_port;
+  ++l.half_open;
+  return id;
+}
+
+void TCPStack::send_cookie( const FourTuple& tuple, const TCPConfig& cfg, const TCPSenderMessage& syn )
+{
+  const auto cookie = cookies_.make( tuple, syn.seqno, syn.MSS, now_ms_ );
+  if ( not cookie.has_value() ) {
+    ++stats_.syn_drops;
+    return;
+  }
+  TCPMessage syn_ack;
+  syn_ack.sender.seqno = *cookie;
+  syn_ack.sender.SYN = true;
+  syn_ack.sender.MSS = static_cast<uint16_t>( min( cfg.mss(), static_cast<size_t>( UINT16_MAX ) ) );
+  syn_ack.receiver.ackno = syn.seqno + 1;
+  syn_ack.receiver.window_size
+    = static_cast<uint16_t>( min( cfg.initial_recv_capacity(), static_cast<size_t>( UINT16_MAX ) ) );
+  transmit_for( tuple )( syn_ack );
+  ++stats_.syn_cookies_sent;
+}
+
+//! \details The connection's TCPPeer receives the SYN that the cookie answered (recovered from the ACK) and
+//! sends its SYN-ACK nowhere, since the peer already has one. Then the ACK itself arrives, as usual.
+optional<TCPStack::ConnectionID> TCPStack::open_from_cookie( const FourTuple& tuple,
+                                                             Listener& l,
+                                                             const TCPMessage& ack )
+{
+  const Wrap32 peer_isn = ack.sender.seqno + UINT32_MAX; // one before
+  const Wrap32 cookie = ack.receiver.ackno.value() + UINT32_MAX;
+  const auto mss = cookies_.check( tuple, peer_isn, cookie, now_ms_ );
+  if ( not mss.has_value() ) {
+    ++stats_.unmatched_segments;
+    return {};
+  }
+  if ( l.accept_queue.size() >= l.accept_backlog ) {
+    ++stats_.syn_drops;
+    return {};
+  }
+  ++stats_.syn_cookies_valid;
+
+  const ConnectionID id = add( tuple, l.cfg, cookie );
+  Connection& c = *connections_[id];
+  c.listener = tuple.local_port;
+  ++l.half_open; // until the ACK completes the handshake, just after this
+
+  TCPMessage syn;
+  syn.sender.seqno = peer_isn;
+  syn.sender.SYN = true;
+  syn.sender.MSS = *mss;
+  c.peer.receive( move( syn ), []( const TCPMessage& ) {} );
+  return id;
+}
+
+void TCPStack::push( ConnectionID id )
+{
+  Connection& c = connection( id );
+  catch_up( c );
+  c.peer.push( transmit_for( c.tuple ) );
+  schedule( id );
+}
+
+void TCPStack::close( ConnectionID id )
+{
+  Connection& c = connection( id );
+  catch_up( c );
+  if ( not c.peer.outbound_writer().is_closed() ) {
+    c.peer.outbound_writer().close();
+  }
+  c.closed = true;
+  c.peer.push( transmit_for( c.tuple ) );
+  settle( id );
+}
+
+//! \details A connection whose timer expires catches up on all the time that has passed, so the time its
+//! peer sees is the same as if it had been ticked all along
+void TCPStack::tick( uint64_t ms_since_last_tick )
+{
+  now_ms_ += ms_since_last_tick;
+  timers_.advance_to( now_ms_, [&]( const ConnectionID id ) {
+    Connection& c = *connections_[id];
+    c.deadline = NEVER;
+    catch_up( c );
+    settle( id );
+  } );
+
+  // handshakes that finished while an accept queue was full move into it once accept() has made room
+  for ( auto& [port, l] : listeners_ ) {
+    while ( l.accept_queue.size() < l.accept_backlog and not l.waiting.empty() ) {
+      const ConnectionID id = l.waiting.front();
+      l.waiting.pop();
+      if ( contains( id ) and connections_[id]->waiting ) {
+        connections_[id]->waiting = false;
+        advance_handshake( id );
+      }
+    }
+  }
+}
+
+optional<uint64_t> TCPStack::ms_until_next_timer() const
+{
+  const auto next = timers_.next_deadline();
+  if ( not next.has_value() ) {
+    return {};
+  }
+  return *next - now_ms_;
+}
+
+void TCPStack::catch_up( Connection& c )
+{
+  if ( c.ticked_at == now_ms_ ) {
+    return;
+  }
+  c.peer.tick( now_ms_ - c.ticked_at, transmit_for( c.tuple ) );
+  c.ticked_at = now_ms_;
+  if ( c.peer.sender().consecutive_retransmissions() > TCPConfig::MAX_RETX_ATTEMPTS ) {
+    // the peer is gone: abort the connection
+    c.peer.outbound_writer().set_error();
+    c.peer.inbound_reader().set_error();
+  }
+}
+
+void TCPStack::settle( ConnectionID id )
+{
+  const Connection& c = *connections_[id];
+  if ( c.listener.has_value() and not c.queued ) {
+    advance_handshake( id );
+  } else {
+    reap( id );
+  }
+  if ( contains( id ) ) {
+    schedule( id );
+  }
+}
+
+//! \details Rearming is skipped when the deadline hasn't moved (as it often doesn't, for a segment that
+//! acknowledges nothing new)
+void TCPStack::schedule( ConnectionID id )
+{
+  Connection& c = *connections_[id];
+  const auto ms = c.peer.ms_until_next_timer();
+  const uint64_t deadline = ms.has_value() ? now_ms_ + *ms : NEVER;
+  if ( deadline == c.deadline ) {
+    return;
+  }
+  timers_.cancel( c.timer );
+  if ( ms.has_value() ) {
+    c.timer = timers_.arm( deadline, id );
+  }
+  c.deadline = deadline;
+}
+
+//! \details The handshake is done once the peer has acknowledged our SYN (nothing else can be in flight before
+//! the application has the connection)
+void TCPStack::advance_handshake( ConnectionID id )
+{
+  Connection& c = *connections_[id];
+  Listener& l = listener( c.listener.value() );
+  if ( not c.peer.active() ) {
+    --l.half_open;
+    forget( id );
+  } else if ( c.peer.sender().sequence_numbers_in_flight() == 0 ) {
+    if ( l.accept_queue.size() < l.accept_backlog ) {
+      --l.half_open;
+      c.queued = true;
+      c.waiting = false;
+      l.accept_queue.push( id );
+    } else if ( not c.waiting ) {
+      c.waiting = true;
+      l.waiting.push( id );
+    }
+  }
+}
+
+void TCPStack::reap( ConnectionID id )
+{
+  const Connection& c = *connections_[id];
+  if ( c.closed and not c.peer.active() ) {
+    forget( id );
+  }
+}
+
+void TCPStack::forget( ConnectionID id )
+{
+  table_.erase( connections_[id]->tuple );
+  timers_.cancel( connections_[id]->timer );
+  connections_[id].reset();
+  free_ids_.push_back( id );
+}
+
+void TCPStackLoop::FdOutputPort::transmit( const TCPStack& sender [[maybe_unused]], const InternetDatagram& dgram )
+{
+  fd_.write( serialize( dgram ) );
+}
+
+TCPStackLoop::TCPStackLoop( FileDescriptor&& fd, const Address& ip_address )
+  : fd_( move( fd ) )
+  , stack_( make_shared<FdOutputPort>( fd_.duplicate() ), ip_address )
+  , last_tick_ms_( timestamp_ms() )
+{
+  fd_.set_blocking( false );
+  eventloop_.add_rule( "receive datagrams for the TCPStack", fd_, Direction::In, [&] { read_datagrams(); } );
+}
+
+//! \details The file descriptor is non-blocking, so every datagram waiting is read at once
+void TCPStackLoop::read_datagrams()
+{
+  while ( true ) {
+    vector<string> strs( 2 );
+    strs.front().resize( IPv4Header::LENGTH );
+    fd_.read( strs );
+    if ( strs.empty() ) {
+      return;
+    }
+
+    InternetDatagram dgram;
+    if ( parse( dgram, strs ) ) {
+      stack_.receive( dgram );
+    }
+  }
+}
+
+EventLoop::Result TCPStackLoop::wait_next_event( int timeout_ms )
+{
+  int timeout = timeout_ms;
+  if ( const auto next = stack_.ms_until_next_timer() ) {
+    const int until_timer = static_cast<int>( min( *next, static_cast<uint64_t>( INT_MAX ) ) );
+    timeout = timeout < 0 ? until_timer : min( timeout, until_timer );
+  }
+  const auto result = eventloop_.wait_next_event( timeout );
+  const uint64_t now = timestamp_ms();
+  stack_.tick( now - last_tick_ms_ );
+  last_tick_ms_ = now;
+  return result;
+}
@@ -0,0 +1,182 @@
+#include "byte_stream.hh"
+#include "byte_stream_test_harness.hh"
+#include "file_descriptor.hh"
+
+#include <array>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+
+using namespace std;
+
+int main()
+{
+  try {
+    {
+      ByteStreamTestHarness test { "chunked push keeps each string", 15, ByteStream::Storage::Chunked };
+
+      test.execute( Push { "cat" } );
+      test.execute( Push { "dog" } );
+      test.execute( BytesPushed { 6 } );
+      test.execute( BytesBuffered { 6 } );
+      test.execute( AvailableCapacity { 9 } );
+      test.execute( PeekOnce { "cat" } );
+      test.execute( PeekAll { { "cat", "dog" } } );
+      test.execute( Peek { "catdog" } );
+    }
+
+    {
+      ByteStreamTestHarness test { "chunked pop within and across chunks", 15, ByteStream::Storage::Chunked };
+
+      test.execute( Push { "hello" } );
+      test.execute( Push { "world" } );
+      test.execute( Pop { 2 } );
+      test.execute( PeekOnce { "llo" } );
+      test.execute( PeekAll { { "llo", "world" } } );
+      test.execute( Pop { 4 } );
+      test.execute( PeekOnce { "orld" } );
+      test.execute( PeekAll { { "orld" } } );
+      test.execute( BytesPopped { 6 } );
+      test.execute( BytesBuffered { 4 } );
+      test.execute( AvailableCapacity { 11 } );
+      test.execute( Pop { 4 } );
+      test.execute( PeekAll { {} } );
+      test.execute( BufferEmpty { true } );
+    }
+
+    {
+      ByteStreamTestHarness test { "chunked trims only the last chunk", 5, ByteStream::Storage::Chunked };
+
+      test.execute( Push { "abc" } );
+      test.execute( Push { "defgh" } );
+      test.execute( BytesPushed { 5 } );
+      test.execute( AvailableCapacity { 0 } );
+      test.execute( PeekAll { { "abc", "de" } } );
+      test.execute( Push { "x" } );
+      test.execute( BytesPushed { 5 } );
+      test.execute( Pop { 3 } );
+      test.execute( Push { "xyzw" } );
+      test.execute( PeekAll { { "de", "xyz" } } );
+      test.execute( Close {} );
+      test.execute( ReadAll { "dexyz" } );
+      test.execute( IsFinished { true } );
+    }
+
+    {
+      ByteStreamTestHarness test { "ring peek_all across the wrap", 4, ByteStream::Storage::Ring };
+
+      test.execute( Push { "abc" } );
+      test.execute( Pop { 2 } );
+      test.execute( Push { "def" } );
+      test.execute( PeekOnce { "cd" } );
+      test.execute( PeekAll { { "cd", "ef" } } );
+      test.execute( Peek { "cdef" } );
+    }
+
+    {
+      // push( data, skip ) keeps the string and only remembers where its useful bytes start
+      for ( const auto storage : { ByteStream::Storage::Chunked, ByteStream::Storage::Ring } ) {
+        ByteStream bs { 6, storage };
+        bs.writer().push( "xxabc", 2 );
+        bs.writer().push( "yyyydefgh", 4 );
+        bs.writer().push( "z", 1 );
+        if ( bs.reader().bytes_buffered() != 6 or bs.reader().peek( 0 ).substr( 0, 3 ) != "abc"
+             or bs.reader().peek( 3 ) != "def" ) {
+          throw runtime_error( "push( data, skip ) stored the wrong bytes" );
+        }
+        if ( bs.bytes_copied() != ( storage == ByteStream::Storage::Chunked ? 0 : 6 ) ) {
+          throw runtime_error( "push( data, skip ) miscounted the bytes it copied" );
+        }
+      }
+    }
+
+    {
+      // a string that is mostly skipped prefix, spare room or overflow is copied, not kept whole
+      constexpr uint64_t capacity = 4096;
+      ByteStream bs { capacity, ByteStream::Storage::Chunked };
+      string expected;
+      for ( size_t i = 0; i < 2 * capacity; ++i ) {
+        string data( 1460, static_cast<char>( 'a' + i % 26 ) );
+        expected += data.back();
+        bs.writer().push( move( data ), 1459 );
+      }
+      string big;
+      big.reserve( 100000 );
+      big = "x";
+      bs.writer().push( move( big ) );
+      if ( bs.reader().bytes_buffered() != capacity or bs.bytes_allocated() > 2 * capacity ) {
+        throw runtime_error( "pushes of one new byte each hold " + to_string( bs.bytes_allocated() )
+                             + " bytes of memory for " + to_string( bs.reader().bytes_buffered() ) );
+      }
+      string all;
+      for ( const auto view : bs.reader().peek_all() ) {
+        all += view;
+      }
+      if ( all != expected.substr( 0, capacity ) ) {
+        throw runtime_error( "copying pushes stored the wrong bytes" );
+      }
+
+      // ... but a string that is mostly live bytes is still kept without copying
+      bs.reader().pop( capacity );
+      const uint64_t copied = bs.bytes_copied();
+      bs.writer().push( string( 1460, 'z' ), 100 );
+      if ( bs.bytes_copied() != copied or bs.reader().bytes_buffered() != 1360 ) {
+        throw runtime_error( "a mostly-live string was copied" );
+      }
+    }
+
+    {
+      // push_copy() copies from a view, as much as fits, in every storage
+      for ( const auto storage :
+            { ByteStream::Storage::Chunked, ByteStream::Storage::Ring, ByteStream::Storage::Spill } ) {
+        ByteStream bs { 6, storage, 2 };
+        const string source = "abcdefgh";
+        if ( bs.writer().push_copy( string_view { source }.substr( 0, 4 ) ) != 4
+             or bs.writer().push_copy( string_view { source }.substr( 4 ) ) != 2 ) {
+          throw runtime_error( "push_copy() pushed the wrong number of bytes" );
+        }
+        string all;
+        for ( const auto view : bs.reader().peek_all() ) {
+          all += view;
+        }
+        if ( all != "abcdef" or bs.bytes_copied() != 6 ) {
+          throw runtime_error( "push_copy() stored \"" + all + "\"" );
+        }
+      }
+    }
+
+    {
+      // many short reads keep only what they read, not a 64 KiB buffer each
+      array<int, 2> fds {};
+      if ( pipe( fds.data() ) != 0 ) {
+        throw runtime_error( "pipe" );
+      }
+      FileDescriptor read_end { fds[0] };
+      FileDescriptor write_end { fds[1] };
+
+      constexpr uint64_t capacity = 65536;
+      ByteStream bs { capacity, ByteStream::Storage::Chunked };
+      for ( size_t i = 0; i < 1000; ++i ) {
+        write_end.write( "0123456789" );
+        if ( bs.writer().read_from( read_end ) != 10 ) {
+          throw runtime_error( "read_from() didn't read a short write" );
+        }
+      }
+      if ( bs.bytes_allocated() > capacity ) {
+        throw runtime_error( "1000 short reads hold " + to_string( bs.bytes_allocated() )
+                             + " bytes of memory, more than the capacity" );
+      }
+      if ( bs.reader().peek( 0 ) != "0123456789" or bs.reader().bytes_buffered() != 10000 ) {
+        throw runtime_error( "read_from() lost bytes" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
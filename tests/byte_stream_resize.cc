@@ -0,0 +1,90 @@
+#include "byte_stream.hh"
+#include "byte_stream_test_harness.hh"
+
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+
+int main()
+{
+  try {
+    {
+      ByteStreamTestHarness test { "growing a ring that has wrapped around", 6 };
+
+      test.execute( Push { "abcdef" } );
+      test.execute( Pop { 4 } );
+      test.execute( Push { "ghi" } );
+      test.execute( PeekAll { { "ef", "ghi" } } );
+      test.execute( SetCapacity { 10 } );
+      test.execute( AvailableCapacity { 5 } );
+      test.execute( PeekOnce { "efghi" } );
+      test.execute( Push { "jklmnop" } );
+      test.execute( BytesPushed { 14 } );
+      test.execute( PeekAll { { "efghij", "klmn" } } );
+      test.execute( Pop { 7 } );
+      test.execute( Push { "pqrstuv" } );
+      test.execute( Close {} );
+      test.execute( ReadAll { "lmnpqrstuv" } );
+      test.execute( IsFinished { true } );
+    }
+
+    {
+      ByteStreamTestHarness test { "shrinking a ring down to what's buffered", 8 };
+
+      test.execute( Push { "abcdefgh" } );
+      test.execute( Pop { 5 } );
+      test.execute( SetCapacity { 3 } );
+      test.execute( AvailableCapacity { 0 } );
+      test.execute( Pop { 1 } );
+      test.execute( Push { "ijk" } );
+      test.execute( BytesPushed { 9 } );
+      test.execute( ReadAll { "ghi" } );
+    }
+
+    {
+      ByteStreamTestHarness test { "growing a chunked stream", 4, ByteStream::Storage::Chunked };
+
+      test.execute( Push { "abcdef" } );
+      test.execute( BytesPushed { 4 } );
+      test.execute( SetCapacity { 8 } );
+      test.execute( Push { "efghij" } );
+      test.execute( PeekAll { { "abcd", "efgh" } } );
+      test.execute( ReadAll { "abcdefgh" } );
+    }
+
+    {
+      ByteStreamTestHarness test { "growing a spill stream grows its hot ring", 4, ByteStream::Storage::Spill, 8 };
+
+      test.execute( Push { "abcd" } );
+      test.execute( Pop { 3 } );
+      test.execute( Push { "efg" } );
+      test.execute( PeekAll { { "d", "efg" } } );
+      test.execute( SetCapacity { 16 } );
+      test.execute( PeekOnce { "defg" } );
+      test.execute( Push { "hijklmnopqrstuvwxyz" } );
+      test.execute( BytesPushed { 19 } );
+      test.execute( PeekAll { { "defghijk", "lmnopqrs" } } );
+      test.execute( ReadAll { "defghijklmnopqrs" } );
+    }
+
+    {
+      ByteStream stream { 8 };
+      stream.writer().push( "abcdef" );
+      try {
+        stream.set_capacity( 5 );
+        throw runtime_error( "set_capacity() dropped buffered bytes" );
+      } catch ( const runtime_error& e ) {
+        if ( string { e.what() }.find( "bytes buffered" ) == string::npos ) {
+          throw;
+        }
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
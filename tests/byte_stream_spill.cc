@@ -0,0 +1,112 @@
+#include "byte_stream.hh"
+#include "byte_stream_test_harness.hh"
+#include "file_descriptor.hh"
+
+#include <array>
+#include <exception>
+#include <iostream>
+#include <unistd.h>
+
+using namespace std;
+
+int main()
+{
+  try {
+    {
+      ByteStreamTestHarness test { "spill keeps order across hot ring and file", 15, ByteStream::Storage::Spill, 4 };
+
+      test.execute( Push { "abcdef" } );
+      test.execute( BytesBuffered { 6 } );
+      test.execute( AvailableCapacity { 9 } );
+      test.execute( PeekOnce { "abcd" } );
+      test.execute( PeekAll { { "abcd", "ef" } } );
+      test.execute( Pop { 3 } );
+      test.execute( PeekOnce { "d" } );
+      test.execute( Push { "gh" } ); // the hot ring has room, but "ef" is already in the file
+      test.execute( PeekAll { { "d", "efgh" } } );
+      test.execute( Pop { 1 } );
+      test.execute( PeekOnce { "efgh" } );
+      test.execute( Pop { 4 } );
+      test.execute( BufferEmpty { true } );
+      test.execute( Push { "ijklm" } );
+      test.execute( PeekAll { { "ijkl", "m" } } );
+      test.execute( Close {} );
+      test.execute( ReadAll { "ijklm" } );
+      test.execute( IsFinished { true } );
+    }
+
+    {
+      ByteStreamTestHarness test { "spill respects capacity", 6, ByteStream::Storage::Spill, 2 };
+
+      test.execute( Push { "abcdefgh" } );
+      test.execute( BytesPushed { 6 } );
+      test.execute( AvailableCapacity { 0 } );
+      test.execute( Push { "x" } );
+      test.execute( BytesPushed { 6 } );
+      test.execute( PeekAll { { "ab", "cdef" } } );
+      test.execute( Pop { 5 } );
+      test.execute( Push { "xyz" } );
+      test.execute( Peek { "fxyz" } );
+    }
+
+    {
+      ByteStreamTestHarness test { "spill with no hot ring", 8, ByteStream::Storage::Spill, 0 };
+
+      test.execute( Push { "hello" } );
+      test.execute( PeekOnce { "hello" } );
+      test.execute( Pop { 2 } );
+      test.execute( Push { "!!!" } );
+      test.execute( Peek { "llo!!!" } );
+    }
+
+    {
+      // enough to grow the file several times while the backlog wraps around inside it
+      const uint64_t capacity = 3 << 20;
+      ByteStreamTestHarness test { "spill grows a wrapped file", capacity, ByteStream::Storage::Spill, 4096 };
+
+      string expected;
+      for ( uint64_t i = 0; i < capacity; ++i ) {
+        expected.push_back( static_cast<char>( 'a' + i % 23 ) );
+      }
+
+      test.execute( Push { expected.substr( 0, 1 << 20 ) } );
+      test.execute( Pop { 700000 } );
+      test.execute( Push { expected.substr( 1 << 20, 1 << 20 ) } );
+      test.execute( Pop { 300000 } );
+      test.execute( Push { expected.substr( 2 << 20 ) } );
+      test.execute( BytesBuffered { capacity - 1000000 } );
+      test.execute( Peek { expected.substr( 1000000 ) } );
+      test.execute( Close {} );
+      test.execute( ReadAll { expected.substr( 1000000 ) } );
+      test.execute( IsFinished { true } );
+    }
+
+    {
+      // read_from() fills the hot ring, then reads into the spill file
+      array<int, 2> fds {};
+      if ( pipe( fds.data() ) != 0 ) {
+        throw runtime_error( "pipe" );
+      }
+      FileDescriptor read_end { fds[0] };
+      FileDescriptor write_end { fds[1] };
+
+      ByteStream bs { 12, ByteStream::Storage::Spill, 4 };
+      write_end.write( "0123456789abcdef" );
+      if ( bs.writer().read_from( read_end ) != 4 or bs.writer().read_from( read_end ) != 8 ) {
+        throw runtime_error( "read_from() did not fill the hot ring and then the spill file" );
+      }
+      if ( bs.reader().peek( 0 ) != "0123" or bs.reader().peek( 4 ) != "456789ab" ) {
+        throw runtime_error( "read_from() put the bytes in the wrong place" );
+      }
+      if ( bs.writer().read_from( read_end ) != 0 ) {
+        throw runtime_error( "read_from() read past capacity" );
+      }
+    }
+
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
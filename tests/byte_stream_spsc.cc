@@ -0,0 +1,114 @@
+#include "spsc_byte_stream.hh"
+
+#include <exception>
+#include <iostream>
+#include <poll.h>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+// Block until `event` is signalled (or a short timeout passes), then reset it.
+static void wait_for( FileDescriptor& event )
+{
+  pollfd pfd { event.fd_num(), POLLIN, 0 };
+  if ( ::poll( &pfd, 1, 10 ) > 0 ) {
+    SPSCByteStream::clear_event( event );
+  }
+}
+
+void single_thread_basics()
+{
+  SPSCByteStream stream { 4 };
+
+  if ( stream.push( "abcdef" ) != 4 or stream.available_capacity() != 0 ) {
+    throw runtime_error( "push should accept exactly the capacity" );
+  }
+  if ( stream.peek() != "abcd" ) {
+    throw runtime_error( "unexpected peek: " + string( stream.peek() ) );
+  }
+  stream.pop( 3 );
+  if ( stream.push( "xyz" ) != 3 ) {
+    throw runtime_error( "push after pop should wrap around the ring" );
+  }
+
+  const auto views = stream.peek_all();
+  if ( views.size() != 2 or views[0] != "d" or views[1] != "xyz" ) {
+    throw runtime_error( "peek_all should return both halves of the wrapped ring" );
+  }
+
+  stream.close();
+  if ( stream.is_finished() ) {
+    throw runtime_error( "stream should not be finished while bytes are buffered" );
+  }
+  stream.pop( 4 );
+  if ( not stream.is_finished() or stream.bytes_popped() != 7 ) {
+    throw runtime_error( "stream should be finished after popping everything" );
+  }
+}
+
+void two_threads( const size_t input_len, const size_t capacity, const size_t random_seed )
+{
+  const string data = [&] {
+    default_random_engine rd { random_seed };
+    uniform_int_distribution<char> ud;
+    string ret;
+    for ( size_t i = 0; i < input_len; ++i ) {
+      ret += ud( rd );
+    }
+    return ret;
+  }();
+
+  SPSCByteStream stream { capacity };
+
+  thread producer { [&] {
+    default_random_engine rd { random_seed + 1 };
+    uniform_int_distribution<size_t> chunk_size { 1, 3 * capacity / 2 };
+    size_t pushed = 0;
+    while ( pushed < data.size() ) {
+      if ( stream.available_capacity() == 0 ) {
+        wait_for( stream.space_event() );
+        continue;
+      }
+      pushed += stream.push( string_view { data }.substr( pushed, chunk_size( rd ) ) );
+    }
+    stream.close();
+  } };
+
+  string output;
+  default_random_engine rd { random_seed + 2 };
+  while ( not stream.is_finished() ) {
+    if ( stream.bytes_buffered() == 0 ) {
+      wait_for( stream.data_event() );
+      continue;
+    }
+    const auto view = stream.peek();
+    const auto len = uniform_int_distribution<size_t> { 1, view.size() }( rd );
+    output += view.substr( 0, len );
+    stream.pop( len );
+  }
+
+  producer.join();
+
+  if ( output != data ) {
+    throw runtime_error( "Mismatch between data pushed by producer and popped by consumer (capacity="
+                         + to_string( capacity ) + ")" );
+  }
+}
+
+int main()
+{
+  try {
+    single_thread_basics();
+    two_threads( 100'000, 17, 1234 );
+    two_threads( 1'000'000, 4096, 5678 );
+    two_threads( 1'000'000, 65536, 9012 );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -6,6 +6,7 @@
 #include <concepts>
 #include <optional>
 #include <utility>
+#include <vector>
 
 static_assert( sizeof( Reader ) == sizeof( ByteStream ),
                "Please add member variables to the ByteStream base, not the ByteStream Reader." );
@@ -20,6 +21,19 @@ public:
     : TestHarness( move( test_name ), "capacity=" + std::to_string( capacity ), ByteStream { capacity } )
   {}
 
+  ByteStreamTestHarness( std::string test_name,
+                         uint64_t capacity,
+                         ByteStream::Storage storage,
+                         uint64_t hot_capacity = ByteStream::DEFAULT_HOT_CAPACITY )
+    : TestHarness( move( test_name ),
+                   "capacity=" + std::to_string( capacity )
+                     + ( storage == ByteStream::Storage::Chunked ? ", chunked"
+                         : storage == ByteStream::Storage::Spill
+                           ? ", spill with hot_capacity=" + std::to_string( hot_capacity )
+                           : ", ring" ),
+                   ByteStream { capacity, storage, hot_capacity } )
+  {}
+
   size_t peek_size() { return object().reader().peek().size(); }
 };
 
@@ -55,6 +69,15 @@ struct Pop : public Action<ByteStream>
   void execute( ByteStream& bs ) const override { bs.reader().pop( len_ ); }
 };
 
+struct SetCapacity : public Action<ByteStream>
+{
+  uint64_t capacity_;
+
+  explicit SetCapacity( uint64_t capacity ) : capacity_( capacity ) {}
+  std::string description() const override { return "set_capacity( " + std::to_string( capacity_ ) + " )"; }
+  void execute( ByteStream& bs ) const override { bs.set_capacity( capacity_ ); }
+};
+
 /* expectations */
 
 struct Peek : public Expectation<ByteStream>
@@ -107,6 +130,38 @@ struct PeekOnce : public Peek
   }
 };
 
+struct PeekAll : public Expectation<ByteStream>
+{
+  std::vector<std::string> output_;
+
+  explicit PeekAll( std::vector<std::string> output ) : output_( move( output ) ) {}
+
+  std::string description() const override
+  {
+    std::string desc = "peek_all() gives";
+    for ( const auto& x : output_ ) {
+      desc += " \"" + Printer::prettify( x ) + "\"";
+    }
+    return desc;
+  }
+
+  void execute( ByteStream& bs ) const override
+  {
+    const auto views = bs.reader().peek_all();
+    if ( views.size() != output_.size() ) {
+      throw ExpectationViolation { "Expected peek_all() to return " + std::to_string( output_.size() )
+                                   + " views, but it returned " + std::to_string( views.size() ) };
+    }
+    for ( size_t i = 0; i < views.size(); ++i ) {
+      if ( views[i] != output_[i] ) {
+        throw ExpectationViolation { "Expected view " + std::to_string( i ) + " to be \""
+                                     + Printer::prettify( output_[i] ) + "\", but found \""
+                                     + Printer::prettify( views[i] ) + "\"" };
+      }
+    }
+  }
+};
+
 struct IsClosed : public ConstExpectBool<ByteStream>
 {
   using ConstExpectBool::ConstExpectBool;
@@ -0,0 +1,95 @@
+#include "connection_table.hh"
+#include "random.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+void expect( const bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( what );
+  }
+}
+
+uint64_t flatten( const FourTuple& t )
+{
+  return ( static_cast<uint64_t>( t.remote_ip & 0xffff ) << 32 ) | ( static_cast<uint64_t>( t.local_port ) << 16 )
+         | t.remote_port;
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      ConnectionTable<int> table;
+      const FourTuple a { .local_ip = 1, .remote_ip = 2, .local_port = 3, .remote_port = 4 };
+      FourTuple b = a;
+      b.remote_port = 5;
+      expect( table.find( a ) == nullptr and table.empty(), "an empty table found something" );
+      expect( table.insert( a, 10 ), "insert failed" );
+      expect( not table.insert( a, 11 ), "inserted the same key twice" );
+      expect( table.find( a ) != nullptr and *table.find( a ) == 10, "wrong value" );
+      expect( table.find( b ) == nullptr, "found a key that differs in one port" );
+      *table.find( a ) = 12;
+      expect( *table.find( a ) == 12, "the value didn't change" );
+      expect( table.erase( a ) and not table.erase( a ) and table.empty(), "erase" );
+    }
+
+    // random inserts and erases, checked against std::unordered_map, with few enough distinct keys that the
+    // table fills up, empties, and keys come back
+    for ( const uint64_t secret : { uint64_t { 0 }, uint64_t { rd() } } ) {
+      ConnectionTable<uint64_t> table { secret };
+      unordered_map<uint64_t, uint64_t> reference;
+      uniform_int_distribution<uint16_t> port { 0, 63 };
+      for ( size_t i = 0; i < 100000; ++i ) {
+        const FourTuple key {
+          .local_ip = 0x0a000001, .remote_ip = port( rd ), .local_port = port( rd ), .remote_port = port( rd ) };
+        const uint64_t flat = flatten( key );
+        const bool present = reference.contains( flat );
+        expect( ( table.find( key ) != nullptr ) == present, "disagrees about a key at step " + to_string( i ) );
+        if ( present ) {
+          expect( *table.find( key ) == reference.at( flat ), "wrong value at step " + to_string( i ) );
+        }
+
+        // insert more often than erase while the table is small, and the other way round once it's large
+        if ( uniform_int_distribution<size_t> { 0, 75000 }( rd ) >= reference.size() ) {
+          expect( table.insert( key, i ) != present, "insert at step " + to_string( i ) );
+          reference.try_emplace( flat, i );
+        } else {
+          expect( table.erase( key ) == present, "erase at step " + to_string( i ) );
+          reference.erase( flat );
+        }
+        expect( table.size() == reference.size(), "wrong size at step " + to_string( i ) );
+        expect( 2 * table.size() <= table.capacity(), "more than half full" );
+      }
+
+      for ( const auto& [flat, value] : reference ) {
+        const FourTuple key { .local_ip = 0x0a000001,
+                              .remote_ip = static_cast<uint32_t>( flat >> 32 ),
+                              .local_port = static_cast<uint16_t>( flat >> 16 ),
+                              .remote_port = static_cast<uint16_t>( flat ) };
+        expect( table.erase( key ), "lost a key" );
+      }
+      expect( table.empty(), "keys left over" );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <vector>
+
+// A one-way link simulated in-process: a drop-tail queue of `queue_limit` bytes drained at `bytes_per_ms`,
+// followed by `delay_ms` of propagation delay. Each message is also lost at random with probability
+// `loss_rate`, before it is queued, and dropped if it's larger than the path's `mtu` (no ICMP comes back).
+// Time is whatever the caller says it is (in milliseconds).
+template<typename Message>
+class EmulatedLink
+{
+public:
+  struct Config
+  {
+    double bytes_per_ms;
+    uint64_t delay_ms;
+    uint64_t queue_limit;
+    double loss_rate = 0;
+    uint64_t mtu = UINT64_MAX;
+  };
+
+  struct Stats
+  {
+    uint64_t messages_sent {};
+    uint64_t random_losses {};
+    uint64_t queue_drops {};
+    uint64_t oversize_drops {};
+    double total_queueing_delay_ms {}; // summed over messages that got through
+  };
+
+  EmulatedLink( const Config& config, unsigned random_seed ) : config_( config ), rd_( random_seed ) {}
+
+  // Offer a message of `size` bytes to the link at time `now`
+  void send( const Message& message, uint64_t size, uint64_t now )
+  {
+    ++stats_.messages_sent;
+    if ( size > config_.mtu ) {
+      ++stats_.oversize_drops;
+      return;
+    }
+    if ( config_.loss_rate > 0 and loss_( rd_ ) < config_.loss_rate ) {
+      ++stats_.random_losses;
+      return;
+    }
+
+    const double start = std::max( static_cast<double>( now ), link_free_at_ );
+    // (an unlimited queue skips counting its backlog, which takes a walk over it)
+    if ( config_.queue_limit != UINT64_MAX and backlog_bytes( now ) + size > config_.queue_limit ) {
+      ++stats_.queue_drops;
+      return;
+    }
+
+    link_free_at_ = start + static_cast<double>( size ) / config_.bytes_per_ms;
+    stats_.total_queueing_delay_ms += start - static_cast<double>( now );
+    const double arrival = link_free_at_ + static_cast<double>( config_.delay_ms );
+    in_flight_.push_back( { link_free_at_, arrival, size, message } );
+  }
+
+  // Every message that has arrived at the far end by time `now`, in order
+  std::vector<Message> deliver( uint64_t now )
+  {
+    std::vector<Message> arrived;
+    while ( not in_flight_.empty() and in_flight_.front().arrival <= static_cast<double>( now ) ) {
+      arrived.push_back( std::move( in_flight_.front().message ) );
+      in_flight_.pop_front();
+    }
+    return arrived;
+  }
+
+  bool empty() const { return in_flight_.empty(); }
+  const Stats& stats() const { return stats_; }
+
+private:
+  struct Entry
+  {
+    double departure; // when the last bit leaves the queue
+    double arrival;
+    uint64_t size;
+    Message message;
+  };
+
+  // Bytes still waiting to be serialized onto the link at time `now`
+  uint64_t backlog_bytes( uint64_t now ) const
+  {
+    uint64_t backlog = 0;
+    for ( auto it = in_flight_.rbegin(); it != in_flight_.rend() and it->departure > static_cast<double>( now );
+          ++it ) {
+      backlog += it->size;
+    }
+    return backlog;
+  }
+
+  Config config_;
+  std::default_random_engine rd_;
+  std::uniform_real_distribution<double> loss_ { 0, 1 };
+  double link_free_at_ = 0;
+  std::deque<Entry> in_flight_ {};
+  Stats stats_ {};
+};
@@ -0,0 +1,111 @@
+#include "reassembler_test_harness.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main()
+{
+  try {
+    const auto bitmap = Reassembler::Engine::Bitmap;
+
+    {
+      ReassemblerTestHarness test { "bitmap in order", 65, bitmap };
+
+      test.execute( Insert { "abcd", 0 } );
+      test.execute( BytesPushed( 4 ) );
+      test.execute( Insert { "efgh", 4 } );
+      test.execute( ReadAll( "abcdefgh" ) );
+      test.execute( BytesPending( 0 ) );
+    }
+
+    {
+      ReassemblerTestHarness test { "bitmap holes and overlaps", 1000, bitmap };
+
+      test.execute( Insert { "b", 1 } );
+      test.execute( Insert { "d", 3 } );
+      test.execute( BytesPending( 2 ) );
+      test.execute( Insert { "bcd", 1 } );
+      test.execute( BytesPending( 3 ) );
+      test.execute( ReadAll( "" ) );
+      test.execute( Insert { "abc", 0 } );
+      test.execute( BytesPending( 0 ) );
+      test.execute( ReadAll( "abcd" ) );
+    }
+
+    {
+      ReassemblerTestHarness test { "bitmap duplicates are free", 1000, bitmap };
+
+      test.execute( Insert { "cdef", 2 } );
+      test.execute( Insert { "cdef", 2 } );
+      test.execute( Insert { "de", 3 } );
+      test.execute( BytesPending( 4 ) );
+      test.execute( Insert { "ab", 0 } );
+      test.execute( ReadAll( "abcdef" ) );
+      test.execute( Insert { "abcdef", 0 } );
+      test.execute( BytesPushed( 6 ) );
+      test.execute( BytesPending( 0 ) );
+    }
+
+    {
+      ReassemblerTestHarness test { "bitmap discards beyond capacity", 4, bitmap };
+
+      test.execute( Insert { "bcdefg", 1 } );
+      test.execute( BytesPending( 3 ) );
+      test.execute( Insert { "a", 0 } );
+      test.execute( ReadAll( "abcd" ) );
+      test.execute( Insert { "efgh", 4 } );
+      test.execute( ReadAll( "efgh" ) );
+    }
+
+    {
+      // runs that wrap around the end of the ring, and words of the bitmap that fill completely
+      ReassemblerTestHarness test { "bitmap wraps around the ring", 70, bitmap };
+
+      test.execute( Insert { string( 60, 'x' ), 0 } );
+      test.execute( ReadAll( string( 60, 'x' ) ) );
+      test.execute( Insert { string( 40, 'z' ), 70 } );
+      test.execute( BytesPending( 40 ) );
+      test.execute( Insert { string( 10, 'y' ), 60 } );
+      test.execute( BytesPending( 0 ) );
+      test.execute( ReadAll( string( 10, 'y' ) + string( 40, 'z' ) ) );
+      test.execute( Insert { string( 70, 'z' ), 70 } );
+      test.execute( ReadAll( string( 30, 'z' ) ) );
+      test.execute( BytesPushed( 140 ) );
+    }
+
+    {
+      // the same intervals the Intervals engine would report, including ones that wrap around the ring
+      ReassemblerTestHarness test { "bitmap pending intervals", 70, bitmap };
+
+      test.execute( Insert { string( 60, 'x' ), 0 } );
+      test.execute( ReadAll( string( 60, 'x' ) ) );
+      test.execute( PendingIntervals { {} } );
+      test.execute( Insert { "bc", 61 } );
+      test.execute( Insert { string( 20, 'z' ), 65 } );
+      test.execute( Insert { "q", 100 } );
+      test.execute( Insert { "r", 129 } );
+      test.execute( PendingIntervals { { { 61, 63 }, { 65, 85 }, { 100, 101 }, { 129, 130 } } } );
+      test.execute( Insert { "cde", 62 } );
+      test.execute( PendingIntervals { { { 61, 85 }, { 100, 101 }, { 129, 130 } } } );
+      test.execute( Insert { "a", 60 } );
+      test.execute( PendingIntervals { { { 100, 101 }, { 129, 130 } } } );
+    }
+
+    {
+      ReassemblerTestHarness test { "bitmap closes after the last byte", 8, bitmap };
+
+      test.execute( Insert { "fgh", 5 }.is_last() );
+      test.execute( IsFinished { false } );
+      test.execute( Insert { "abcde", 0 } );
+      test.execute( ReadAll( "abcdefgh" ) );
+      test.execute( IsFinished { true } );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,140 @@
+#include "reassembler_test_harness.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    const auto intervals = Reassembler::Engine::Intervals;
+
+    // what two separate four-byte fragments cost on this platform
+    uint64_t two_fragments = 0;
+    {
+      Reassembler probe { ByteStream { 1000 } };
+      probe.insert( 10, "kkkk", false );
+      probe.insert( 20, "uuuu", false );
+      two_fragments = probe.stats().memory_used;
+    }
+
+    {
+      ReassemblerTestHarness test { "evicts the furthest fragment first", 1000, intervals, two_fragments };
+
+      test.execute( Insert { "kkkk", 10 } );
+      test.execute( Insert { "uuuu", 20 } );
+      test.execute( MemoryUsed( two_fragments ) );
+      test.execute( FragmentsEvicted( 0 ) );
+
+      test.execute( Insert { "zzzz", 30 } );
+      test.execute( BytesPending( 8 ) );
+      test.execute( FragmentsEvicted( 1 ) );
+      test.execute( BytesEvicted( 4 ) );
+
+      // adjacent to "kkkk", so it only adds a fragment, and "uuuu" goes
+      test.execute( Insert { "ffff", 6 } );
+      test.execute( BytesPending( 8 ) );
+      test.execute( FragmentsEvicted( 2 ) );
+      test.execute( BytesEvicted( 8 ) );
+
+      test.execute( Insert { "abcdef", 0 } );
+      test.execute( ReadAll( "abcdefffffkkkk" ) );
+      test.execute( BytesPending( 0 ) );
+      test.execute( MemoryUsed( 0 ) );
+
+      test.execute( Insert { "opqrst", 14 } );
+      test.execute( Insert { "uuuu", 20 } );
+      test.execute( ReadAll( "opqrstuuuu" ) );
+      test.execute( FragmentsEvicted( 2 ) );
+    }
+
+    {
+      ReassemblerTestHarness test { "eviction forgets the end of the stream", 1000, intervals, 0 };
+
+      test.execute( Insert { "xyz", 3 }.is_last() );
+      test.execute( BytesPending( 0 ) );
+      test.execute( Insert { "abc", 0 } );
+      test.execute( ReadAll( "abc" ) );
+      test.execute( IsClosed( false ) );
+      test.execute( Insert { "xyz", 3 }.is_last() );
+      test.execute( ReadAll( "xyz" ) );
+      test.execute( IsFinished( true ) );
+    }
+
+    {
+      ReassemblerTestHarness test { "a partial last substring doesn't close the stream", 4 };
+
+      test.execute( Insert { "cdef", 2 }.is_last() );
+      test.execute( Insert { "ab", 0 } );
+      test.execute( ReadAll( "abcd" ) );
+      test.execute( IsClosed( false ) );
+      test.execute( Insert { "ef", 4 }.is_last() );
+      test.execute( ReadAll( "ef" ) );
+      test.execute( IsFinished( true ) );
+    }
+
+    {
+      // the global budget is shared: usage is given back when a Reassembler goes away
+      const uint64_t baseline = Reassembler::global_memory_used();
+      Reassembler::set_global_memory_limit( baseline + two_fragments );
+
+      Reassembler first { ByteStream { 1000 } };
+      Reassembler second { ByteStream { 1000 } };
+      first.insert( 10, "kkkk", false );
+      first.insert( 20, "uuuu", false );
+      second.insert( 10, "kkkk", false );
+      if ( second.bytes_pending() != 0 or second.stats().fragments_evicted != 1 ) {
+        throw runtime_error( "Reassembler did not respect the global memory limit" );
+      }
+      if ( Reassembler::global_memory_used() != baseline + two_fragments ) {
+        throw runtime_error( "global memory usage does not match the Reassemblers' own" );
+      }
+
+      {
+        const Reassembler copy { first };
+        if ( Reassembler::global_memory_used() != baseline + 2 * two_fragments ) {
+          throw runtime_error( "a copied Reassembler was not charged to the global budget" );
+        }
+      }
+      first.insert( 0, string( 30, 'a' ), false );
+      if ( Reassembler::global_memory_used() != baseline or first.stats().peak_memory_used < two_fragments ) {
+        throw runtime_error( "global memory usage was not given back" );
+      }
+
+      Reassembler::set_global_memory_limit( Reassembler::UNLIMITED );
+    }
+
+    {
+      // overlapping segments that each add one new byte, in order or flushed after a hole is filled, don't pin a
+      // whole segment's allocation per buffered byte in a chunked stream
+      constexpr uint64_t capacity = 4096;
+      constexpr uint64_t segment = 1460;
+      for ( const bool hole : { false, true } ) {
+        Reassembler reassembler { ByteStream { capacity, ByteStream::Storage::Chunked } };
+        for ( uint64_t end = 2; end <= capacity; ++end ) {
+          const uint64_t first = max( end > segment ? end - segment : 0, uint64_t { hole } );
+          reassembler.insert( first, string( end - first, 'x' ), false );
+        }
+        if ( hole ) {
+          reassembler.insert( 0, "x", false );
+        }
+        const Reader& output = reassembler.reader();
+        if ( output.bytes_buffered() != capacity or output.bytes_allocated() > 2 * capacity ) {
+          throw runtime_error( to_string( output.bytes_buffered() ) + " bytes from one-new-byte segments"
+                               + ( hole ? " (after a hole)" : "" ) + " hold " + to_string( output.bytes_allocated() )
+                               + " bytes of memory" );
+        }
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -129,6 +129,20 @@ int main()
       test.execute( ReadAll( "" ) );
       test.execute( IsFinished { true } );
     }
+
+    {
+      ReassemblerTestHarness test { "pending intervals", 65000 };
+
+      test.execute( PendingIntervals { {} } );
+      test.execute( Insert { "cd", 2 } );
+      test.execute( Insert { "gh", 6 } );
+      test.execute( Insert { "ef", 4 } );
+      test.execute( Insert { "k", 10 } );
+      test.execute( PendingIntervals { { { 2, 8 }, { 10, 11 } } } );
+      test.execute( Insert { "ab", 0 } );
+      test.execute( PendingIntervals { { { 10, 11 } } } );
+      test.execute( ReadAll( "abcdefgh" ) );
+    }
   } catch ( const exception& e ) {
     cerr << "Exception: " << e.what() << endl;
     return EXIT_FAILURE;
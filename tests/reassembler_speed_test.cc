@@ -13,30 +13,28 @@
 using namespace std;
 using namespace std::chrono;
 
-void speed_test( const size_t num_chunks,   // NOLINT(bugprone-easily-swappable-parameters)
-                 const size_t capacity,     // NOLINT(bugprone-easily-swappable-parameters)
-                 const size_t random_seed ) // NOLINT(bugprone-easily-swappable-parameters)
-{
-  // Generate the data to be written
-  const string data = [&] {
-    default_random_engine rd { random_seed };
-    uniform_int_distribution<char> ud;
-    string ret;
-    for ( size_t i = 0; i < num_chunks * capacity; ++i ) {
-      ret += ud( rd );
-    }
-    return ret;
-  }();
+using Segments = queue<tuple<uint64_t, string, bool>>;
 
-  // Split the data into segments before writing
-  queue<tuple<uint64_t, string, bool>> split_data;
-  for ( size_t i = 0; i < data.size(); i += capacity ) {
-    split_data.emplace( i + 2, data.substr( i + 2, capacity * 2 ), i + 2 + capacity * 2 >= data.size() );
-    split_data.emplace( i, data.substr( i, capacity * 2 ), i + capacity * 2 >= data.size() );
-    split_data.emplace( i + 1, data.substr( i + 1, capacity * 2 ), i + 1 + capacity * 2 >= data.size() );
+string generate_data( const size_t len, const size_t random_seed )
+{
+  default_random_engine rd { random_seed };
+  uniform_int_distribution<char> ud;
+  string ret;
+  for ( size_t i = 0; i < len; ++i ) {
+    ret += ud( rd );
   }
+  return ret;
+}
 
-  Reassembler reassembler { ByteStream { capacity } };
+// Insert every segment (reading whatever gets assembled along the way), check the output, and report throughput
+double speed_test( const string& workload,
+                   const Reassembler::Engine engine,
+                   const size_t capacity,
+                   const string& data,
+                   Segments split_data,
+                   const ByteStream::Storage storage = ByteStream::Storage::Ring )
+{
+  Reassembler reassembler { ByteStream { capacity, storage }, engine };
 
   string output_data;
   output_data.reserve( data.size() );
@@ -64,27 +62,108 @@ void speed_test( const size_t num_chunks,   // NOLINT(bugprone-easily-swappable-
   }
 
   auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
-  auto bytes_per_second = static_cast<double>( num_chunks * capacity ) / test_duration.count();
+  auto bytes_per_second = static_cast<double>( data.size() ) / test_duration.count();
   auto bits_per_second = 8 * bytes_per_second;
   auto gigabits_per_second = bits_per_second / 1e9;
 
   fstream debug_output;
   debug_output.open( "/dev/tty" );
 
-  cout << "Reassembler to ByteStream with capacity=" << capacity << " reached " << fixed << setprecision( 2 )
-       << gigabits_per_second << " Gbit/s.\n";
+  const string engine_name = engine == Reassembler::Engine::Bitmap ? "bitmap" : "intervals";
+  cout << "Reassembler (" << engine_name << ") with capacity=" << capacity
+       << ( storage == ByteStream::Storage::Chunked ? " (chunked)" : "" ) << " on " << workload << " reached "
+       << fixed << setprecision( 2 ) << gigabits_per_second << " Gbit/s, copying "
+       << reassembler.bytes_copied() * 100 / data.size() << "% in the Reassembler and "
+       << reassembler.reader().bytes_copied() * 100 / data.size() << "% into the ByteStream.\n";
+
+  // in-order segments are moved from the caller into a chunked ByteStream without a single copy
+  if ( workload == "in-order traffic" and storage == ByteStream::Storage::Chunked
+       and reassembler.bytes_copied() + reassembler.reader().bytes_copied() != 0 ) {
+    throw runtime_error( "In-order data was copied on its way into a chunked ByteStream." );
+  }
 
-  debug_output << "             Reassembler throughput: " << fixed << setprecision( 2 ) << gigabits_per_second
-               << " Gbit/s\n";
+  debug_output << "             Reassembler (" << engine_name << ") " << workload
+               << " throughput: " << fixed << setprecision( 2 ) << gigabits_per_second << " Gbit/s\n";
 
   if ( gigabits_per_second < 0.1 ) {
     throw runtime_error( "Reassembler did not meet minimum speed of 0.1 Gbit/s." );
   }
+
+  return gigabits_per_second;
+}
+
+// Segments of `segment_size` bytes, each sent once and in order
+Segments in_order( const string& data, const size_t segment_size )
+{
+  Segments split_data;
+  for ( size_t i = 0; i < data.size(); i += segment_size ) {
+    split_data.emplace( i, data.substr( i, segment_size ), i + segment_size >= data.size() );
+  }
+  return split_data;
+}
+
+// The same segments, shuffled within each group of `group` segments
+Segments reordered( const string& data, const size_t segment_size, const size_t group, const size_t random_seed )
+{
+  default_random_engine rd { random_seed };
+  vector<size_t> order;
+  Segments split_data;
+  for ( size_t i = 0; i < data.size(); i += segment_size * group ) {
+    order.clear();
+    for ( size_t j = i; j < min( data.size(), i + segment_size * group ); j += segment_size ) {
+      order.push_back( j );
+    }
+    shuffle( order.begin(), order.end(), rd );
+    for ( const auto j : order ) {
+      split_data.emplace( j, data.substr( j, segment_size ), j + segment_size >= data.size() );
+    }
+  }
+  return split_data;
+}
+
+// Three overlapping, out-of-order copies of every stretch, each twice the window long
+Segments duplicated( const string& data, const size_t capacity )
+{
+  Segments split_data;
+  for ( size_t i = 0; i < data.size(); i += capacity ) {
+    split_data.emplace( i + 2, data.substr( i + 2, capacity * 2 ), i + 2 + capacity * 2 >= data.size() );
+    split_data.emplace( i, data.substr( i, capacity * 2 ), i + capacity * 2 >= data.size() );
+    split_data.emplace( i + 1, data.substr( i + 1, capacity * 2 ), i + 1 + capacity * 2 >= data.size() );
+  }
+  return split_data;
+}
+
+// Adversarial reordering: every other segment arrives first, leaving one hole per pair, and then the holes are
+// filled from the last one back to the first by retransmissions that also overlap both neighbours.
+Segments holes( const string& data, const size_t segment_size )
+{
+  const size_t num_segments = data.size() / segment_size;
+  Segments split_data;
+  for ( size_t i = 1; i < num_segments; i += 2 ) {
+    split_data.emplace( i * segment_size, data.substr( i * segment_size, segment_size ), i + 1 == num_segments );
+  }
+  for ( size_t i = num_segments; i > 0; i -= 2 ) {
+    const size_t first = ( i - 2 ) * segment_size - ( i > 2 ? segment_size : 0 );
+    const size_t last = min( data.size(), ( i + 1 ) * segment_size );
+    split_data.emplace( first, data.substr( first, last - first ), last == data.size() );
+  }
+  return split_data;
 }
 
 void program_body()
 {
-  speed_test( 10000, 1500, 1370 );
+  for ( const auto engine : { Reassembler::Engine::Intervals, Reassembler::Engine::Bitmap } ) {
+    const string window_data = generate_data( 10000 * 1500, 1370 );
+    speed_test( "in-order traffic", engine, 64000, window_data, in_order( window_data, 1000 ) );
+    speed_test(
+      "in-order traffic", engine, 64000, window_data, in_order( window_data, 1000 ), ByteStream::Storage::Chunked );
+    speed_test( "reordered traffic", engine, 64000, window_data, reordered( window_data, 1000, 32, 1370 ) );
+    speed_test( "duplicated traffic", engine, 1500, window_data, duplicated( window_data, 1500 ) );
+
+    const size_t num_holes = 10000;
+    const string hole_data = generate_data( 2 * num_holes * 1000, 1370 );
+    speed_test( to_string( num_holes ) + " holes", engine, hole_data.size(), hole_data, holes( hole_data, 1000 ) );
+  }
 }
 
 int main()
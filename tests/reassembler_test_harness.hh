@@ -7,6 +7,7 @@
 #include <optional>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 template<std::derived_from<TestStep<ByteStream>> T>
 struct ReassemblerTestStep : public TestStep<Reassembler>
@@ -27,10 +28,17 @@ struct ReassemblerTestStep : public TestStep<Reassembler>
 class ReassemblerTestHarness : public TestHarness<Reassembler>
 {
 public:
-  ReassemblerTestHarness( std::string test_name, uint64_t capacity )
+  ReassemblerTestHarness( std::string test_name,
+                          uint64_t capacity,
+                          Reassembler::Engine engine = Reassembler::Engine::Intervals,
+                          uint64_t memory_limit = Reassembler::UNLIMITED )
     : TestHarness( move( test_name ),
-                   "capacity=" + std::to_string( capacity ),
-                   { Reassembler { ByteStream { capacity } } } )
+                   "capacity=" + std::to_string( capacity )
+                     + ( engine == Reassembler::Engine::Bitmap ? ", bitmap engine" : "" )
+                     + ( memory_limit == Reassembler::UNLIMITED
+                           ? ""
+                           : ", memory_limit=" + std::to_string( memory_limit ) ),
+                   { Reassembler { ByteStream { capacity }, engine, memory_limit } } )
   {}
 
   template<std::derived_from<TestStep<ByteStream>> T>
@@ -49,6 +57,57 @@ struct BytesPending : public ConstExpectNumber<Reassembler, uint64_t>
   uint64_t value( const Reassembler& r ) const override { return r.bytes_pending(); }
 };
 
+struct MemoryUsed : public ConstExpectNumber<Reassembler, uint64_t>
+{
+  using ConstExpectNumber::ConstExpectNumber;
+  std::string name() const override { return "stats().memory_used"; }
+  uint64_t value( const Reassembler& r ) const override { return r.stats().memory_used; }
+};
+
+struct FragmentsEvicted : public ConstExpectNumber<Reassembler, uint64_t>
+{
+  using ConstExpectNumber::ConstExpectNumber;
+  std::string name() const override { return "stats().fragments_evicted"; }
+  uint64_t value( const Reassembler& r ) const override { return r.stats().fragments_evicted; }
+};
+
+struct BytesEvicted : public ConstExpectNumber<Reassembler, uint64_t>
+{
+  using ConstExpectNumber::ConstExpectNumber;
+  std::string name() const override { return "stats().bytes_evicted"; }
+  uint64_t value( const Reassembler& r ) const override { return r.stats().bytes_evicted; }
+};
+
+struct PendingIntervals : public Expectation<Reassembler>
+{
+  std::vector<std::pair<uint64_t, uint64_t>> intervals_;
+
+  explicit PendingIntervals( std::vector<std::pair<uint64_t, uint64_t>> intervals )
+    : intervals_( std::move( intervals ) )
+  {}
+
+  static std::string describe( const std::vector<std::pair<uint64_t, uint64_t>>& intervals )
+  {
+    std::ostringstream ss;
+    ss << "pending_intervals = {";
+    for ( const auto& [start, end] : intervals ) {
+      ss << " [" << start << ", " << end << ")";
+    }
+    ss << " }";
+    return ss.str();
+  }
+
+  std::string description() const override { return describe( intervals_ ); }
+
+  void execute( Reassembler& r ) const override
+  {
+    const auto actual = r.pending_intervals();
+    if ( actual != intervals_ ) {
+      throw ExpectationViolation( "Expected " + describe( intervals_ ) + ", but it was " + describe( actual ) );
+    }
+  }
+};
+
 struct Insert : public Action<Reassembler>
 {
   std::string data_;
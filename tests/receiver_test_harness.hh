@@ -8,6 +8,7 @@
 #include <optional>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 template<std::derived_from<TestStep<Reassembler>> T>
 struct DirectReassemblerTest : public TestStep<TCPReceiver>
@@ -40,10 +41,14 @@ struct DirectByteStreamTest : public TestStep<TCPReceiver>
 class TCPReceiverTestHarness : public TestHarness<TCPReceiver>
 {
 public:
-  TCPReceiverTestHarness( std::string test_name, uint64_t capacity )
+  TCPReceiverTestHarness( std::string test_name,
+                          uint64_t capacity,
+                          bool window_scaling = false,
+                          uint64_t max_capacity = 0 )
     : TestHarness( move( test_name ),
-                   "capacity=" + std::to_string( capacity ),
-                   { TCPReceiver { Reassembler { ByteStream { capacity } } } } )
+                   "capacity=" + std::to_string( capacity ) + ( window_scaling ? ", window scaling" : "" )
+                     + ( max_capacity ? ", autotuning up to " + std::to_string( max_capacity ) : "" ),
+                   { TCPReceiver { Reassembler { ByteStream { capacity } }, window_scaling, max_capacity } } )
   {}
 
   template<std::derived_from<TestStep<Reassembler>> T>
@@ -68,6 +73,27 @@ struct ExpectWindow : public ExpectNumber<TCPReceiver, uint16_t>
   uint16_t value( TCPReceiver& rs ) const override { return rs.send().window_size; }
 };
 
+struct ExpectWindowScale : public ExpectNumber<TCPReceiver, std::optional<uint8_t>>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "window_scale"; }
+  std::optional<uint8_t> value( TCPReceiver& rs ) const override { return rs.window_scale(); }
+};
+
+struct ExpectCapacity : public ExpectNumber<TCPReceiver, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "capacity"; }
+  uint64_t value( TCPReceiver& rs ) const override { return rs.capacity(); }
+};
+
+struct ExpectRTTEstimate : public ExpectNumber<TCPReceiver, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "rtt_estimate"; }
+  uint64_t value( TCPReceiver& rs ) const override { return rs.rtt_estimate(); }
+};
+
 struct ExpectAckno : public ExpectNumber<TCPReceiver, std::optional<Wrap32>>
 {
   using ExpectNumber::ExpectNumber;
@@ -111,6 +137,40 @@ struct ExpectAcknoBetween : public Expectation<TCPReceiver>
   }
 };
 
+struct ExpectSACKBlocks : public Expectation<TCPReceiver>
+{
+  std::vector<std::pair<Wrap32, Wrap32>> blocks_;
+
+  explicit ExpectSACKBlocks( std::vector<std::pair<Wrap32, Wrap32>> blocks ) : blocks_( std::move( blocks ) ) {}
+
+  static std::string describe( const std::vector<std::pair<Wrap32, Wrap32>>& blocks )
+  {
+    if ( blocks.empty() ) {
+      return "no SACK blocks";
+    }
+    std::ostringstream ss;
+    ss << "SACK blocks";
+    for ( const auto& [begin, end] : blocks ) {
+      ss << " [" << begin << ", " << end << ")";
+    }
+    return ss.str();
+  }
+
+  std::string description() const override { return describe( blocks_ ); }
+
+  void execute( TCPReceiver& rs ) const override
+  {
+    std::vector<std::pair<Wrap32, Wrap32>> actual;
+    for ( const auto& block : rs.send().sack_blocks ) {
+      actual.emplace_back( block.begin, block.end );
+    }
+    if ( actual != blocks_ ) {
+      throw ExpectationViolation( "TCPReceiver advertised " + describe( actual ) + ", but expected "
+                                  + describe( blocks_ ) );
+    }
+  }
+};
+
 struct HasAckno : public ExpectBool<TCPReceiver>
 {
   using ExpectBool::ExpectBool;
@@ -118,6 +178,15 @@ struct HasAckno : public ExpectBool<TCPReceiver>
   bool value( TCPReceiver& rs ) const override { return rs.send().ackno.has_value(); }
 };
 
+struct Tick : public Action<TCPReceiver>
+{
+  uint64_t ms_;
+
+  explicit Tick( uint64_t ms ) : ms_( ms ) {}
+  std::string description() const override { return std::to_string( ms_ ) + " ms pass"; }
+  void execute( TCPReceiver& rs ) const override { rs.tick( ms_ ); }
+};
+
 struct SegmentArrives : public Action<TCPReceiver>
 {
   TCPSenderMessage msg_ {};
@@ -141,6 +210,18 @@ struct SegmentArrives : public Action<TCPReceiver>
     return *this;
   }
 
+  SegmentArrives& with_sack_permitted()
+  {
+    msg_.SACK_permitted = true;
+    return *this;
+  }
+
+  SegmentArrives& with_window_scale( uint8_t shift )
+  {
+    msg_.window_scale = shift;
+    return *this;
+  }
+
   SegmentArrives& with_seqno( Wrap32 seqno_ )
   {
     msg_.seqno = seqno_;
@@ -175,6 +256,12 @@ struct SegmentArrives : public Action<TCPReceiver>
     if ( msg_.SYN ) {
       ss << " +SYN";
     }
+    if ( msg_.SACK_permitted ) {
+      ss << " +SACK-permitted";
+    }
+    if ( msg_.window_scale.has_value() ) {
+      ss << " +window-scale=" << static_cast<int>( msg_.window_scale.value() );
+    }
     if ( not msg_.payload.empty() ) {
       ss << " payload=\"" << Printer::prettify( msg_.payload ) << "\"";
     }
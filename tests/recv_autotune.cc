@@ -0,0 +1,82 @@
+#include "random.hh"
+#include "receiver_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "An idle connection keeps its small buffer", 4000, false, 1 << 20 };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "hello" ) );
+      test.execute( ReadAll { "hello" } );
+      for ( int i = 0; i < 100; ++i ) {
+        test.execute( Tick { 100 } );
+      }
+      test.execute( ExpectCapacity { 4000 } );
+      test.execute( ExpectWindow { 4000 } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "A fast reader grows the buffer", 4000, false, 8000 };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( string( 1000, 'a' ) ) );
+      test.execute( ReadAll { string( 1000, 'a' ) } );
+      test.execute( ExpectRTTEstimate { 0 } );
+
+      // the rest of the window arrives 10 ms later: that's the round trip
+      test.execute( Tick { 10 } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1001 ).with_data( string( 3000, 'b' ) ) );
+      test.execute( ExpectRTTEstimate { 10 } );
+      test.execute( ExpectCapacity { 4000 } );
+
+      // the application reads 3000 bytes in that round trip, so the sender may soon send 6000
+      test.execute( ReadAll { string( 3000, 'b' ) } );
+      test.execute( Tick { 10 } );
+      test.execute( ExpectCapacity { 6000 } );
+      test.execute( ExpectWindow { 6000 } );
+
+      // but not beyond the maximum
+      test.execute( SegmentArrives {}.with_seqno( isn + 4001 ).with_data( string( 6000, 'c' ) ) );
+      test.execute( ReadAll { string( 6000, 'c' ) } );
+      test.execute( Tick { 10 } );
+      test.execute( ExpectCapacity { 8000 } );
+      test.execute( ExpectWindow { 8000 } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "A reader that doesn't keep up doesn't grow the buffer", 4000, false, 1 << 20 };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( string( 1000, 'a' ) ) );
+      test.execute( Tick { 10 } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1001 ).with_data( string( 3000, 'b' ) ) );
+      for ( int i = 0; i < 10; ++i ) {
+        test.execute( Tick { 10 } );
+      }
+      test.execute( ExpectCapacity { 4000 } );
+      test.execute( ExpectWindow { 0 } );
+    }
+
+    {
+      TCPReceiverTestHarness test { "The window scale is chosen for the largest buffer", 4000, true, 16 << 20 };
+      test.execute( ExpectWindowScale { 9 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
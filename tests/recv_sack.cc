@@ -0,0 +1,70 @@
+#include "random.hh"
+#include "receiver_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      const Wrap32 zero { isn };
+      TCPReceiverTestHarness test { "SACK blocks follow the holes", 4000 };
+      test.execute( SegmentArrives {}.with_syn().with_sack_permitted().with_seqno( isn ) );
+      test.execute( ExpectSACKBlocks { {} } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "efgh" ) );
+      test.execute( ExpectAckno { zero + 1 } );
+      test.execute( ExpectSACKBlocks { { { zero + 5, zero + 9 } } } );
+
+      // the block with the most recent segment comes first
+      test.execute( SegmentArrives {}.with_seqno( isn + 13 ).with_data( "mnop" ) );
+      test.execute( ExpectSACKBlocks { { { zero + 13, zero + 17 }, { zero + 5, zero + 9 } } } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 6 ).with_data( "fg" ) );
+      test.execute( ExpectSACKBlocks { { { zero + 5, zero + 9 }, { zero + 13, zero + 17 } } } );
+
+      test.execute( SegmentArrives {}.with_seqno( isn + 9 ).with_data( "ijkl" ) );
+      test.execute( ExpectSACKBlocks { { { zero + 5, zero + 17 } } } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ) );
+      test.execute( ExpectAckno { zero + 17 } );
+      test.execute( ExpectSACKBlocks { {} } );
+      test.execute( ReadAll { "abcdefghijklmnop" } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      const Wrap32 zero { isn };
+      TCPReceiverTestHarness test { "At most four SACK blocks", 4000 };
+      test.execute( SegmentArrives {}.with_syn().with_sack_permitted().with_seqno( isn ) );
+      for ( const uint32_t i : { 3, 5, 7, 9, 11 } ) {
+        test.execute( SegmentArrives {}.with_seqno( isn + i ).with_data( "x" ) );
+      }
+      test.execute( ExpectSACKBlocks {
+        { { zero + 11, zero + 12 }, { zero + 3, zero + 4 }, { zero + 5, zero + 6 }, { zero + 7, zero + 8 } } } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "x" ) );
+      test.execute( ExpectSACKBlocks {
+        { { zero + 5, zero + 6 }, { zero + 3, zero + 4 }, { zero + 7, zero + 8 }, { zero + 9, zero + 10 } } } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "No SACK blocks unless the SYN permitted them", 4000 };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "efgh" ) );
+      test.execute( BytesPending { 4 } );
+      test.execute( ExpectSACKBlocks { {} } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
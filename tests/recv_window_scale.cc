@@ -0,0 +1,62 @@
+#include "random.hh"
+#include "receiver_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPReceiverTestHarness test { "The window scale covers the capacity", 16 << 20, true };
+      test.execute( ExpectWindowScale { 9 } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "Scaled windows once both SYNs offered a scale", 1 << 20, true };
+      test.execute( ExpectWindow { UINT16_MAX } );
+      test.execute( SegmentArrives {}.with_syn().with_window_scale( 7 ).with_seqno( isn ) );
+      test.execute( ExpectWindow { ( 1 << 20 ) >> 5 } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( string( 100, 'x' ) ) );
+      test.execute( ExpectWindow { ( ( 1 << 20 ) - 100 ) >> 5 } );
+      test.execute( ReadAll { string( 100, 'x' ) } );
+      test.execute( ExpectWindow { ( 1 << 20 ) >> 5 } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "No scaling if the peer's SYN didn't offer it", 1 << 20, true };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( ExpectWindow { UINT16_MAX } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "No scaling unless we offered it", 1 << 20 };
+      test.execute( ExpectWindowScale { nullopt } );
+      test.execute( SegmentArrives {}.with_syn().with_window_scale( 7 ).with_seqno( isn ) );
+      test.execute( ExpectWindow { UINT16_MAX } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "A small capacity needs no scale", 4000, true };
+      test.execute( ExpectWindowScale { 0 } );
+      test.execute( SegmentArrives {}.with_syn().with_window_scale( 7 ).with_seqno( isn ) );
+      test.execute( ExpectWindow { 4000 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
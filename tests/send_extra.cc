@@ -325,6 +325,75 @@ int main()
       test.execute( ExpectSeqnosInFlight { 0 } );
     }
 
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.send_capacity = 100000;
+      cfg.segmentation_offload = true;
+
+      const string nicechars = "abcdefghijklmnopqrstuvwxyz";
+      string bigstring;
+      for ( unsigned int i = 0; i < cfg.send_capacity; i++ ) {
+        bigstring.push_back( nicechars.at( rd() % nicechars.size() ) );
+      }
+
+      constexpr uint32_t gso = TCPConfig::MAX_GSO_PAYLOAD_SIZE;
+      TCPSenderTestHarness test { "Segmentation offload sends super-segments", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( Push { string( bigstring ) }.with_close() );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( UINT16_MAX ) );
+      test.execute( ExpectMessage {}.with_data( bigstring.substr( 0, gso ) ).with_seqno( isn + 1 ) );
+      test.execute( ExpectMessage {}
+                      .with_data( bigstring.substr( gso, UINT16_MAX - gso ) )
+                      .with_seqno( isn + 1 + gso )
+                      .with_fin( false ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { Wrap32 { isn + 1 + UINT16_MAX } }.with_win( UINT16_MAX ) );
+      test.execute( ExpectMessage {}
+                      .with_data( bigstring.substr( UINT16_MAX ) )
+                      .with_seqno( isn + 1 + UINT16_MAX )
+                      .with_fin( true ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.segmentation_offload = true;
+      cfg.congestion_control = CongestionControl::Reno;
+
+      const string data = string( 3000, 'a' ) + string( 1000, 'b' ) + string( 6000, 'c' );
+      constexpr uint64_t mss = TCPConfig::MAX_PAYLOAD_SIZE;
+      TCPSenderTestHarness test { "Segmentation offload: a lost middle datagram is retransmitted fast, alone",
+                                  cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( UINT16_MAX ) );
+      test.execute( Push { data } );
+      test.execute( ExpectMessage {}.with_data( data ).with_seqno( isn + 1 ) );
+
+      // the super-segment goes out as ten datagrams, and the receiver acknowledges each one: the fourth is lost
+      for ( uint32_t acked = 1; acked <= 3; ++acked ) {
+        test.execute( AckReceived { Wrap32 { isn + 1 + acked * mss } }.with_win( UINT16_MAX ) );
+        test.execute( ExpectSeqnosInFlight( data.size() - acked * mss ) );
+      }
+      test.execute( AckReceived { Wrap32 { isn + 1 + 3 * mss } }.with_win( UINT16_MAX ) );
+      test.execute( AckReceived { Wrap32 { isn + 1 + 3 * mss } }.with_win( UINT16_MAX ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { Wrap32 { isn + 1 + 3 * mss } }.with_win( UINT16_MAX ) );
+      test.execute( ExpectMessage {}.with_data( string( 1000, 'b' ) ).with_seqno( isn + 1 + 3 * mss ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectFastRetransmissions( 1 ) );
+      test.execute( ExpectTimeoutRetransmissions( 0 ) );
+
+      test.execute( AckReceived { Wrap32 { isn + 1 + data.size() } }.with_win( UINT16_MAX ) );
+      test.execute( ExpectSeqnosInFlight( 0 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
     {
       TCPConfig cfg;
       const Wrap32 isn( rd() );
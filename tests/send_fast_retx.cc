@@ -0,0 +1,185 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+
+// Connect, then send "a" through "e" as one-byte segments
+void send_five_segments( TCPSenderTestHarness& test, const Wrap32 isn )
+{
+  test.execute( Push {} );
+  test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+  test.execute( AckReceived { isn + 1 } );
+  for ( const auto* data : { "a", "b", "c", "d", "e" } ) {
+    test.execute( Push { data } );
+    test.execute( ExpectMessage {}.with_data( data ) );
+  }
+  test.execute( ExpectSeqnosInFlight( 5 ) );
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.congestion_control = CongestionControl::Reno;
+
+      TCPSenderTestHarness test { "Three duplicate ACKs retransmit the oldest segment", cfg };
+      send_five_segments( test, isn );
+
+      // "a" is lost, and "b" and "c" each produce a duplicate ACK
+      test.execute( AckReceived { isn + 1 } );
+      test.execute( AckReceived { isn + 1 } );
+      test.execute( ExpectNoSegment {} );
+      // a window update is not a duplicate ACK
+      test.execute( AckReceived { isn + 1 }.with_win( DEFAULT_TEST_WINDOW + 1 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 1 }.with_win( DEFAULT_TEST_WINDOW + 1 ) );
+      test.execute( ExpectMessage {}.with_data( "a" ).with_seqno( isn + 1 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectFastRetransmissions( 1 ) );
+      test.execute( ExpectTimeoutRetransmissions( 0 ) );
+      test.execute( ExpectConsecutiveRetransmissions( 0 ) );
+
+      // half the flight (but at least two segments), plus the three that left the network
+      test.execute( ExpectCongestionWindow( 2 * TCPConfig::MAX_PAYLOAD_SIZE + 3 * TCPConfig::MAX_PAYLOAD_SIZE ) );
+      test.execute( AckReceived { isn + 1 }.with_win( DEFAULT_TEST_WINDOW + 1 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectCongestionWindow( 6 * TCPConfig::MAX_PAYLOAD_SIZE ) );
+
+      // the retransmission fills the hole, and recovery ends
+      test.execute( AckReceived { isn + 6 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight( 0 ) );
+      test.execute( ExpectCongestionWindow( 2 * TCPConfig::MAX_PAYLOAD_SIZE ) );
+      test.execute( ExpectFastRetransmissions( 1 ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.congestion_control = CongestionControl::NewReno;
+
+      TCPSenderTestHarness test { "NewReno retransmits the next hole on a partial ACK", cfg };
+      send_five_segments( test, isn );
+
+      // "a" and "c" are lost
+      test.execute( AckReceived { isn + 1 } );
+      test.execute( AckReceived { isn + 1 } );
+      test.execute( AckReceived { isn + 1 } );
+      test.execute( ExpectMessage {}.with_data( "a" ) );
+      test.execute( AckReceived { isn + 2 } );
+      test.execute( ExpectMessage {}.with_data( "b" ).with_seqno( isn + 2 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectFastRetransmissions( 2 ) );
+
+      test.execute( AckReceived { isn + 6 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight( 0 ) );
+      test.execute( ExpectCongestionWindow( 2 * TCPConfig::MAX_PAYLOAD_SIZE ) );
+      test.execute( ExpectTimeoutRetransmissions( 0 ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.congestion_control = CongestionControl::Reno;
+
+      TCPSenderTestHarness test { "Reno leaves recovery on a partial ACK, and waits for the timer", cfg };
+      send_five_segments( test, isn );
+
+      test.execute( AckReceived { isn + 1 } );
+      test.execute( AckReceived { isn + 1 } );
+      test.execute( AckReceived { isn + 1 } );
+      test.execute( ExpectMessage {}.with_data( "a" ) );
+      test.execute( AckReceived { isn + 2 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectCongestionWindow( 2 * TCPConfig::MAX_PAYLOAD_SIZE ) );
+
+      // these duplicate ACKs are for data sent before recovery started, so the window isn't cut again
+      test.execute( AckReceived { isn + 2 } );
+      test.execute( AckReceived { isn + 2 } );
+      test.execute( AckReceived { isn + 2 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { TCPConfig::TIMEOUT_DFLT - 1 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectMessage {}.with_data( "b" ) );
+      test.execute( ExpectFastRetransmissions( 1 ) );
+      test.execute( ExpectTimeoutRetransmissions( 1 ) );
+      test.execute( ExpectCongestionWindow( TCPConfig::MAX_PAYLOAD_SIZE ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.congestion_control = CongestionControl::Cubic;
+
+      TCPSenderTestHarness test { "A new loss after recovery is repaired fast again", cfg };
+      send_five_segments( test, isn );
+
+      test.execute( AckReceived { isn + 1 } );
+      test.execute( AckReceived { isn + 1 } );
+      test.execute( AckReceived { isn + 1 } );
+      test.execute( ExpectMessage {}.with_data( "a" ) );
+      test.execute( AckReceived { isn + 6 } );
+      test.execute( ExpectNoSegment {} );
+
+      for ( const auto* data : { "f", "g", "h", "i" } ) {
+        test.execute( Push { data } );
+        test.execute( ExpectMessage {}.with_data( data ) );
+      }
+      test.execute( AckReceived { isn + 6 } );
+      test.execute( AckReceived { isn + 6 } );
+      test.execute( AckReceived { isn + 6 } );
+      test.execute( ExpectMessage {}.with_data( "f" ) );
+      test.execute( ExpectFastRetransmissions( 2 ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.congestion_control = CongestionControl::Reno;
+
+      TCPSenderTestHarness test { "Data segments from the peer are not duplicate ACKs", cfg };
+      send_five_segments( test, isn );
+
+      // in a two-way transfer, the peer's own data keeps acknowledging what it has seen so far
+      for ( int i = 0; i < 5; ++i ) {
+        test.execute( AckReceived { isn + 1 }.on_data_segment() );
+      }
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectFastRetransmissions( 0 ) );
+      test.execute( ExpectCongestionWindow( 10 * TCPConfig::MAX_PAYLOAD_SIZE + 1 ) ); // (slow start for the SYN)
+
+      // ... and they don't count towards the three that a real loss produces
+      test.execute( AckReceived { isn + 1 } );
+      test.execute( AckReceived { isn + 1 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 1 } );
+      test.execute( ExpectMessage {}.with_data( "a" ) );
+      test.execute( ExpectFastRetransmissions( 1 ) );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
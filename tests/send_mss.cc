@@ -0,0 +1,190 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+constexpr uint64_t JUMBO_MTU = 9000;
+constexpr uint64_t JUMBO_MSS = JUMBO_MTU - TCPConfig::HEADERS_SIZE;
+constexpr uint64_t BASE_MSS = TCPConfig::MAX_PAYLOAD_SIZE;
+constexpr uint16_t WINDOW = UINT16_MAX;
+
+// A sender on a jumbo-frame interface, with or without path MTU discovery
+TCPConfig jumbo_config( const Wrap32 isn, const bool path_mtu_discovery )
+{
+  TCPConfig cfg;
+  cfg.isn = isn;
+  cfg.mtu = JUMBO_MTU;
+  cfg.path_mtu_discovery = path_mtu_discovery;
+  return cfg;
+}
+
+// Send the SYN, with `data` waiting to be sent once it's acknowledged
+void connect( TCPSenderTestHarness& test, const Wrap32 isn, const string& data )
+{
+  test.execute( Push {} );
+  test.execute( ExpectMessage {}.with_syn( true ).with_mss( JUMBO_MSS ).with_seqno( isn ) );
+  test.execute( Push { data } );
+  test.execute( ExpectNoSegment {} );
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+    string data;
+    for ( size_t i = 0; i < 3 * JUMBO_MSS; ++i ) {
+      data.push_back( static_cast<char>( 'a' + rd() % 26 ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "The SYN advertises the MSS, and segments are that large", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_mss( BASE_MSS ).with_segment_size( BASE_MSS ) );
+      test.execute( AckReceived { isn + 1 }.with_win( WINDOW ) );
+      test.execute( Push { data.substr( 0, 2500 ) } );
+      test.execute( ExpectMessage {}.with_payload_size( BASE_MSS ).with_segment_size( BASE_MSS ) );
+      test.execute( ExpectMessage {}.with_payload_size( BASE_MSS ) );
+      test.execute( ExpectMessage {}.with_payload_size( 500 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "A jumbo-frame MTU makes jumbo segments", jumbo_config( isn, false ) };
+      connect( test, isn, data.substr( 0, 2 * JUMBO_MSS + 7 ) );
+      test.execute( AckReceived { isn + 1 }.with_win( WINDOW ) );
+      test.execute( ExpectMessage {}.with_data( data.substr( 0, JUMBO_MSS ) ).with_segment_size( JUMBO_MSS ) );
+      test.execute( ExpectMessage {}.with_data( data.substr( JUMBO_MSS, JUMBO_MSS ) ) );
+      test.execute( ExpectMessage {}.with_data( data.substr( 2 * JUMBO_MSS, 7 ) ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "The peer's MSS limits the segments", jumbo_config( isn, false ) };
+      test.execute( PeerAdvertisesMSS { 1460 } );
+      connect( test, isn, data.substr( 0, 2000 ) );
+      test.execute( AckReceived { isn + 1 }.with_win( WINDOW ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1460 ).with_segment_size( 1460 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 540 ) );
+      test.execute( ExpectSegmentSize { 1460 } );
+
+      // a SYN without the option doesn't change anything
+      test.execute( PeerAdvertisesMSS { 0 } );
+      test.execute( ExpectSegmentSize { 1460 } );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "PLPMTUD: a probe that gets through raises the segment size",
+                                  jumbo_config( isn, true ) };
+      connect( test, isn, data.substr( 0, JUMBO_MSS + 2500 ) );
+      test.execute( ExpectSegmentSize { BASE_MSS } );
+      test.execute( AckReceived { isn + 1 }.with_win( WINDOW ) );
+      // the first segment probes the largest size; the rest go out at the base size meanwhile
+      test.execute( ExpectMessage {}.with_payload_size( JUMBO_MSS ).with_segment_size( JUMBO_MSS ) );
+      test.execute( ExpectMessage {}.with_payload_size( BASE_MSS ).with_segment_size( BASE_MSS ) );
+      test.execute( ExpectMessage {}.with_payload_size( BASE_MSS ) );
+      test.execute( ExpectMessage {}.with_payload_size( 500 ) );
+      test.execute( ExpectSegmentSize { BASE_MSS } );
+      test.execute( AckReceived { isn + 1 + JUMBO_MSS }.with_win( WINDOW ) );
+      test.execute( ExpectSegmentSize { JUMBO_MSS } );
+      test.execute( ExpectNoSegment {} );
+
+      // nothing left to probe for
+      test.execute( AckReceived { isn + 1 + JUMBO_MSS + 2500 }.with_win( WINDOW ) );
+      test.execute( Push { data.substr( 0, 2 * JUMBO_MSS ) } );
+      test.execute( ExpectMessage {}.with_payload_size( JUMBO_MSS ).with_segment_size( JUMBO_MSS ) );
+      test.execute( ExpectMessage {}.with_payload_size( JUMBO_MSS ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "PLPMTUD: a lost probe is resent in base-size segments, then halved",
+                                  jumbo_config( isn, true ) };
+      connect( test, isn, data.substr( 0, JUMBO_MSS ) );
+      test.execute( AckReceived { isn + 1 }.with_win( WINDOW ) );
+      test.execute( ExpectMessage {}.with_payload_size( JUMBO_MSS ).with_segment_size( JUMBO_MSS ) );
+      test.execute( Tick { TCPConfig::TIMEOUT_DFLT } );
+      test.execute( ExpectMessage {}
+                      .with_data( data.substr( 0, JUMBO_MSS ) )
+                      .with_seqno( isn + 1 )
+                      .with_segment_size( BASE_MSS ) );
+      test.execute( AckReceived { isn + 1 + JUMBO_MSS }.with_win( WINDOW ) );
+      test.execute( ExpectSegmentSize { BASE_MSS } );
+
+      // the next probe is halfway between what got through and what didn't
+      const uint64_t probe = ( BASE_MSS + JUMBO_MSS ) / 2;
+      test.execute( Push { data.substr( 0, 2 * JUMBO_MSS ) } );
+      test.execute( ExpectMessage {}.with_payload_size( probe ).with_segment_size( probe ) );
+      test.execute( ExpectMessage {}.with_payload_size( BASE_MSS ) );
+    }
+
+    {
+      TCPConfig cfg = jumbo_config( Wrap32 { static_cast<uint32_t>( rd() ) }, true );
+      const Wrap32 isn = cfg.isn;
+      cfg.congestion_control = CongestionControl::NewReno;
+
+      TCPSenderTestHarness test { "PLPMTUD: losing a probe is not congestion", cfg };
+      connect( test, isn, data.substr( 0, JUMBO_MSS + 3 * BASE_MSS ) );
+      test.execute( AckReceived { isn + 1 }.with_win( WINDOW ) );
+      test.execute( ExpectMessage {}.with_payload_size( JUMBO_MSS ) );
+      for ( int i = 0; i < 3; ++i ) {
+        test.execute( ExpectMessage {}.with_payload_size( BASE_MSS ) );
+      }
+      const uint64_t cwnd = 2 * JUMBO_MSS + 1; // the initial window (with the interface's MSS), grown by the SYN
+      test.execute( ExpectCongestionWindow( cwnd ) );
+
+      // the three segments after the probe arrive
+      for ( int i = 0; i < 3; ++i ) {
+        test.execute( AckReceived { isn + 1 }.with_win( WINDOW ) );
+      }
+      test.execute(
+        ExpectMessage {}.with_seqno( isn + 1 ).with_payload_size( JUMBO_MSS ).with_segment_size( BASE_MSS ) );
+      test.execute( ExpectFastRetransmissions( 1 ) );
+      test.execute( ExpectCongestionWindow( cwnd ) );
+      test.execute( AckReceived { isn + 1 + JUMBO_MSS + 3 * BASE_MSS }.with_win( WINDOW ) );
+      test.execute( ExpectSegmentSize { BASE_MSS } );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderTestHarness test { "PLPMTUD: repeated timeouts of large segments fall back to the base size",
+                                  jumbo_config( isn, true ) };
+      connect( test, isn, data.substr( 0, JUMBO_MSS ) );
+      test.execute( AckReceived { isn + 1 }.with_win( WINDOW ) );
+      test.execute( ExpectMessage {}.with_payload_size( JUMBO_MSS ) );
+      test.execute( AckReceived { isn + 1 + JUMBO_MSS }.with_win( WINDOW ) );
+      test.execute( ExpectSegmentSize { JUMBO_MSS } );
+
+      // the path's MTU shrinks
+      test.execute( Push { data.substr( 0, JUMBO_MSS ) } );
+      test.execute( ExpectMessage {}.with_payload_size( JUMBO_MSS ) );
+      test.execute( Tick { TCPConfig::TIMEOUT_DFLT } );
+      test.execute( ExpectMessage {}.with_payload_size( JUMBO_MSS ).with_segment_size( JUMBO_MSS ) );
+      test.execute( Tick { 2 * TCPConfig::TIMEOUT_DFLT } );
+      test.execute( ExpectMessage {}.with_payload_size( JUMBO_MSS ).with_segment_size( BASE_MSS ) );
+      test.execute( ExpectSegmentSize { BASE_MSS } );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -200,6 +200,31 @@ int main()
       test.execute( ExpectSeqnosInFlight { 0 } );
       test.execute( HasError { false } );
     }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.send_capacity = 10;
+
+      // the retransmission is rebuilt from the outbound stream, where it now wraps around the end of the buffer
+      TCPSenderTestHarness test { "retransmission of bytes that wrap in the outbound stream", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 1000 ) );
+      test.execute( Push { "abcdefgh" } );
+      test.execute( ExpectMessage {}.with_data( "abcdefgh" ) );
+      test.execute( AckReceived { isn + 9 }.with_win( 1000 ) );
+      test.execute( Push { "ijkl" } );
+      test.execute( ExpectMessage {}.with_data( "ijkl" ) );
+      test.execute( Tick { cfg.rt_timeout } );
+      test.execute( ExpectMessage {}.with_data( "ijkl" ).with_seqno( isn + 9 ) );
+      test.execute( Push { "mnopqr" } );
+      test.execute( ExpectMessage {}.with_data( "mnopqr" ) );
+      test.execute( AckReceived { isn + 13 }.with_win( 1000 ) );
+      test.execute( Tick { cfg.rt_timeout } );
+      test.execute( ExpectMessage {}.with_data( "mnopqr" ).with_seqno( isn + 13 ) );
+    }
   } catch ( const exception& e ) {
     cerr << e.what() << endl;
     return 1;
@@ -0,0 +1,207 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "RTO tracks a 2 ms path, so tail loss is repaired in ms", cfg, { { 1, 60000 } } };
+      test.execute( ExpectRTO( TCPConfig::TIMEOUT_DFLT ) );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( Tick { 2 } );
+      test.execute( AckReceived { Wrap32 { isn + 1 } } );
+      test.execute( ExpectSRTT( 2 ) );
+      test.execute( ExpectRTTVar( 1 ) );
+      test.execute( ExpectRTO( 6 ) );
+
+      test.execute( Push { "abc" } );
+      test.execute( ExpectMessage {}.with_data( "abc" ) );
+      test.execute( Tick { 4 } );
+      test.execute( AckReceived { Wrap32 { isn + 4 } } );
+      test.execute( ExpectSRTT( 2.25 ) );
+      test.execute( ExpectRTTVar( 1.25 ) );
+      test.execute( ExpectRTO( 8 ) );
+
+      // the last segment is lost, and nothing after it will trigger a duplicate ACK
+      test.execute( Push { "def" } );
+      test.execute( ExpectMessage {}.with_data( "def" ) );
+      test.execute( Tick { 7 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectMessage {}.with_data( "def" ) );
+      test.execute( ExpectRTO( 16 ) );
+
+      // Karn: the ACK of a retransmitted segment is ambiguous, so it is not a sample (but ends the backoff)
+      test.execute( Tick { 5 } );
+      test.execute( AckReceived { Wrap32 { isn + 7 } } );
+      test.execute( ExpectSRTT( 2.25 ) );
+      test.execute( ExpectRTO( 8 ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      const uint64_t rtt = uniform_int_distribution<uint64_t> { 50, 500 }( rd );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "Tail-loss recovery takes three RTTs on a steady path", cfg, { { 1, 60000 } } };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( Tick { rtt } );
+      test.execute( AckReceived { Wrap32 { isn + 1 } } );
+      test.execute( ExpectRTO( 3 * rtt ) );
+
+      test.execute( Push { "x" } );
+      test.execute( ExpectMessage {}.with_data( "x" ) );
+      test.execute( Tick { 3 * rtt - 1 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectMessage {}.with_data( "x" ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "RTO floor", cfg, { { TCPConfig::RTO_MIN_DFLT, TCPConfig::RTO_MAX_DFLT } } };
+      test.execute( Push {} );
+      test.execute( Tick { 2 } );
+      test.execute( AckReceived { Wrap32 { isn + 1 } } );
+      test.execute( ExpectSRTT( 2 ) );
+      test.execute( ExpectRTO( TCPConfig::RTO_MIN_DFLT ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "RTO ceiling caps the backoff", cfg, { { 200, 3000 } } };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( Tick { 1000 } );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( ExpectRTO( 2000 ) );
+      test.execute( Tick { 2000 } );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( ExpectRTO( 3000 ) );
+      test.execute( Tick { 2999 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( ExpectRTO( 3000 ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.rt_timeout = 100;
+
+      TCPSenderTestHarness test { "No sample from a retransmitted SYN", cfg, { { 1, 60000 } } };
+      test.execute( Push {} );
+      test.execute( Tick { 100 } );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( Tick { 30 } );
+      test.execute( AckReceived { Wrap32 { isn + 1 } } );
+      test.execute( ExpectSRTT( 0 ) );
+      test.execute( ExpectRTO( 100 ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.rt_timeout = 100;
+
+      TCPSenderTestHarness test { "No sample from an ACK that also covers a retransmission", cfg, { { 1, 60000 } } };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( Tick { 10 } );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 1000 ) );
+      test.execute( ExpectSRTT( 10 ) );
+      test.execute( ExpectRTO( 30 ) );
+      test.execute( Push { "abc" } );
+      test.execute( Push { "def" } );
+      test.execute( ExpectMessage {}.with_data( "abc" ) );
+      test.execute( ExpectMessage {}.with_data( "def" ) );
+      test.execute( Tick { 30 } );
+      test.execute( ExpectMessage {}.with_data( "abc" ) );
+      test.execute( Tick { 10 } );
+      test.execute( AckReceived { Wrap32 { isn + 7 } }.with_win( 1000 ) );
+      test.execute( ExpectSRTT( 10 ) );
+      test.execute( ExpectRTO( 30 ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.rt_timeout = 100;
+
+      TCPSenderTestHarness test { "Duplicate ACKs neither restart the timer nor clear the backoff", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 1000 ) );
+      test.execute( Push { "abc" } );
+      test.execute( ExpectMessage {}.with_data( "abc" ) );
+      for ( int i = 0; i < 9; ++i ) {
+        test.execute( Tick { 10 } );
+        test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 1000 ) );
+      }
+      test.execute( Tick { 9 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectMessage {}.with_data( "abc" ) );
+      test.execute( ExpectRTO( 200 ) );
+      test.execute( ExpectConsecutiveRetransmissions( 1 ) );
+
+      test.execute( Tick { 150 } );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 1000 ) );
+      test.execute( ExpectRTO( 200 ) );
+      test.execute( ExpectConsecutiveRetransmissions( 1 ) );
+      test.execute( Tick { 50 } );
+      test.execute( ExpectMessage {}.with_data( "abc" ) );
+      test.execute( ExpectRTO( 400 ) );
+
+      // an ACK of new data does both
+      test.execute( AckReceived { Wrap32 { isn + 4 } }.with_win( 1000 ) );
+      test.execute( ExpectRTO( 100 ) );
+      test.execute( ExpectConsecutiveRetransmissions( 0 ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "Without RTO bounds the RTT is measured, but the RTO stays put", cfg };
+      test.execute( Push {} );
+      test.execute( Tick { 2 } );
+      test.execute( AckReceived { Wrap32 { isn + 1 } } );
+      test.execute( ExpectSRTT( 2 ) );
+      test.execute( ExpectRTO( TCPConfig::TIMEOUT_DFLT ) );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
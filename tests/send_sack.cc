@@ -0,0 +1,144 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.congestion_control = CongestionControl::NewReno;
+
+      TCPSenderTestHarness test { "SACK recovery retransmits every hole in one round trip", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_sack_permitted( true ) );
+      test.execute( AckReceived { isn + 1 } );
+      for ( const auto* data : { "a", "b", "c", "d", "e", "f", "g", "h" } ) {
+        test.execute( Push { data } );
+        test.execute( ExpectMessage {}.with_data( data ) );
+      }
+
+      // "a", "c" and "e" are lost
+      test.execute( AckReceived { isn + 1 }.with_sack( isn + 2, isn + 3 ) );
+      test.execute( AckReceived { isn + 1 }.with_sack( isn + 4, isn + 5 ).with_sack( isn + 2, isn + 3 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute(
+        AckReceived { isn + 1 }.with_sack( isn + 6, isn + 7 ).with_sack( isn + 2, isn + 3 ).with_sack( isn + 4,
+                                                                                                      isn + 5 ) );
+      test.execute( ExpectMessage {}.with_data( "a" ) );
+      test.execute( ExpectNoSegment {} );
+
+      // each further duplicate ACK repairs the next hole, skipping what the receiver already has
+      test.execute(
+        AckReceived { isn + 1 }.with_sack( isn + 6, isn + 8 ).with_sack( isn + 2, isn + 3 ).with_sack( isn + 4,
+                                                                                                      isn + 5 ) );
+      test.execute( ExpectMessage {}.with_data( "c" ) );
+      test.execute(
+        AckReceived { isn + 1 }.with_sack( isn + 6, isn + 9 ).with_sack( isn + 2, isn + 3 ).with_sack( isn + 4,
+                                                                                                      isn + 5 ) );
+      test.execute( ExpectMessage {}.with_data( "e" ) );
+      test.execute( ExpectNoSegment {} );
+
+      // the partial ACK for "a" finds no hole that hasn't been repaired already
+      test.execute( AckReceived { isn + 3 }.with_sack( isn + 4, isn + 5 ).with_sack( isn + 6, isn + 9 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 9 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight( 0 ) );
+      test.execute( ExpectFastRetransmissions( 3 ) );
+      test.execute( ExpectTimeoutRetransmissions( 0 ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.congestion_control = CongestionControl::NewReno;
+
+      TCPSenderTestHarness test { "Nothing beyond the highest SACK block counts as lost", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { isn + 1 } );
+      for ( const auto* data : { "a", "b", "c", "d", "e", "f" } ) {
+        test.execute( Push { data } );
+        test.execute( ExpectMessage {}.with_data( data ) );
+      }
+
+      // "a" is lost, and "e" and "f" are still on their way
+      test.execute( AckReceived { isn + 1 }.with_sack( isn + 2, isn + 3 ) );
+      test.execute( AckReceived { isn + 1 }.with_sack( isn + 2, isn + 4 ) );
+      test.execute( AckReceived { isn + 1 }.with_sack( isn + 2, isn + 5 ) );
+      test.execute( ExpectMessage {}.with_data( "a" ) );
+      test.execute( AckReceived { isn + 1 }.with_sack( isn + 2, isn + 5 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 7 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectFastRetransmissions( 1 ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+      cfg.segmentation_offload = true;
+      cfg.congestion_control = CongestionControl::NewReno;
+
+      // one super-segment of ten datagrams, "a" to "j"
+      constexpr uint32_t mss = TCPConfig::MAX_PAYLOAD_SIZE;
+      string data;
+      for ( char c = 'a'; c <= 'j'; ++c ) {
+        data += string( mss, c );
+      }
+      const auto at = [&]( uint32_t datagram ) { return isn + 1 + datagram * mss; };
+
+      TCPSenderTestHarness test { "SACK blocks split an offloaded super-segment", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { isn + 1 }.with_win( UINT16_MAX ) );
+      test.execute( Push { data } );
+      test.execute( ExpectMessage {}.with_data( data ) );
+
+      // "c" and "f" are lost
+      test.execute( AckReceived { at( 2 ) }.with_win( UINT16_MAX ) );
+      test.execute( AckReceived { at( 2 ) }.with_win( UINT16_MAX ).with_sack( at( 3 ), at( 4 ) ) );
+      test.execute( AckReceived { at( 2 ) }.with_win( UINT16_MAX ).with_sack( at( 3 ), at( 5 ) ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { at( 2 ) }
+                      .with_win( UINT16_MAX )
+                      .with_sack( at( 6 ), at( 7 ) )
+                      .with_sack( at( 3 ), at( 5 ) ) );
+      test.execute( ExpectMessage {}.with_data( string( mss, 'c' ) ).with_seqno( at( 2 ) ) );
+      test.execute( ExpectNoSegment {} );
+
+      // the next hole is "f": "d" and "e", in the middle of the record, were SACKed
+      test.execute( AckReceived { at( 2 ) }
+                      .with_win( UINT16_MAX )
+                      .with_sack( at( 6 ), at( 8 ) )
+                      .with_sack( at( 3 ), at( 5 ) ) );
+      test.execute( ExpectMessage {}.with_data( string( mss, 'f' ) ).with_seqno( at( 5 ) ) );
+      test.execute( ExpectNoSegment {} );
+
+      test.execute( AckReceived { at( 10 ) }.with_win( UINT16_MAX ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight( 0 ) );
+      test.execute( ExpectFastRetransmissions( 2 ) );
+      test.execute( ExpectTimeoutRetransmissions( 0 ) );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
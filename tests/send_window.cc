@@ -140,6 +140,23 @@ int main()
       test.execute( ExpectMessage {}.with_fin( true ).with_data( "4567" ) );
       test.execute( ExpectNoSegment {} );
     }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.isn = isn;
+
+      TCPSenderTestHarness test { "Scaled window", cfg };
+      test.execute( PeerAdvertisesWindowScale { 4 } );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_no_flags().with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 100 ) );
+      test.execute( Push { string( 2000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ) );
+      test.execute( ExpectMessage {}.with_payload_size( 600 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 1600 } );
+    }
   } catch ( const exception& e ) {
     cerr << e.what() << endl;
     return 1;
@@ -18,6 +18,7 @@ struct SenderAndOutput
 {
   TCPSender sender;
   std::queue<TCPSenderMessage> output {};
+  size_t max_payload_size = TCPConfig::MAX_PAYLOAD_SIZE;
 
   auto make_transmit()
   {
@@ -33,6 +34,12 @@ inline std::string to_string( const TCPSenderMessage& msg )
   if ( msg.SYN ) {
     o << " +SYN";
   }
+  if ( msg.SACK_permitted ) {
+    o << " +SACK-permitted";
+  }
+  if ( msg.MSS ) {
+    o << " MSS=" << msg.MSS;
+  }
   if ( not msg.payload.empty() ) {
     o << " payload=\"" << Printer::prettify( msg.payload ) << "\"";
   }
@@ -80,6 +87,55 @@ struct ExpectConsecutiveRetransmissions : public ExpectNumber<SenderAndOutput, u
   uint64_t value( SenderAndOutput& ss ) const override { return ss.sender.consecutive_retransmissions(); }
 };
 
+struct ExpectFastRetransmissions : public ExpectNumber<SenderAndOutput, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "fast_retransmissions"; }
+  uint64_t value( SenderAndOutput& ss ) const override { return ss.sender.fast_retransmissions(); }
+};
+
+struct ExpectTimeoutRetransmissions : public ExpectNumber<SenderAndOutput, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "timeout_retransmissions"; }
+  uint64_t value( SenderAndOutput& ss ) const override { return ss.sender.timeout_retransmissions(); }
+};
+
+struct ExpectCongestionWindow : public ExpectNumber<SenderAndOutput, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "congestion_window"; }
+  uint64_t value( SenderAndOutput& ss ) const override { return ss.sender.congestion_window(); }
+};
+
+struct ExpectSegmentSize : public ExpectNumber<SenderAndOutput, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "segment_size"; }
+  uint64_t value( SenderAndOutput& ss ) const override { return ss.sender.segment_size(); }
+};
+
+struct ExpectRTO : public ExpectNumber<SenderAndOutput, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "rto"; }
+  uint64_t value( SenderAndOutput& ss ) const override { return ss.sender.rto(); }
+};
+
+struct ExpectSRTT : public ExpectNumber<SenderAndOutput, double>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "srtt"; }
+  double value( SenderAndOutput& ss ) const override { return ss.sender.srtt(); }
+};
+
+struct ExpectRTTVar : public ExpectNumber<SenderAndOutput, double>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "rttvar"; }
+  double value( SenderAndOutput& ss ) const override { return ss.sender.rttvar(); }
+};
+
 struct ExpectNoSegment : public Expectation<SenderAndOutput>
 {
   std::string description() const override { return "nothing to send"; }
@@ -187,12 +243,20 @@ struct Receive : public Action<SenderAndOutput>
 {
   TCPReceiverMessage msg_;
   bool push_ = true;
+  bool occupies_seqno_ = false;
 
   explicit Receive( TCPReceiverMessage msg ) : msg_( msg ) {}
   std::string description() const override
   {
     std::ostringstream desc;
-    desc << "receive(ack=" << to_string( msg_.ackno ) << ", win=" << msg_.window_size << ")";
+    desc << "receive(ack=" << to_string( msg_.ackno ) << ", win=" << msg_.window_size;
+    for ( const auto& block : msg_.sack_blocks ) {
+      desc << ", sack=[" << block.begin << ", " << block.end << ")";
+    }
+    desc << ")";
+    if ( occupies_seqno_ ) {
+      desc << " on a segment carrying data";
+    }
     if ( push_ ) {
       desc << ", then push stream to TCPSender";
     }
@@ -205,9 +269,21 @@ struct Receive : public Action<SenderAndOutput>
     return *this;
   }
 
+  Receive& with_sack( Wrap32 begin, Wrap32 end )
+  {
+    msg_.sack_blocks.push_back( { begin, end } );
+    return *this;
+  }
+
+  Receive& on_data_segment()
+  {
+    occupies_seqno_ = true;
+    return *this;
+  }
+
   void execute( SenderAndOutput& ss ) const override
   {
-    ss.sender.receive( msg_ );
+    ss.sender.receive( msg_, occupies_seqno_ );
     if ( push_ ) {
       ss.sender.push( ss.make_transmit() );
     }
@@ -220,6 +296,27 @@ struct Receive : public Action<SenderAndOutput>
   }
 };
 
+struct PeerAdvertisesMSS : public Action<SenderAndOutput>
+{
+  uint64_t mss_;
+
+  explicit PeerAdvertisesMSS( uint64_t mss ) : mss_( mss ) {}
+  std::string description() const override { return "peer's SYN advertises MSS " + std::to_string( mss_ ); }
+  void execute( SenderAndOutput& ss ) const override { ss.sender.set_peer_mss( mss_ ); }
+};
+
+struct PeerAdvertisesWindowScale : public Action<SenderAndOutput>
+{
+  uint8_t shift_;
+
+  explicit PeerAdvertisesWindowScale( uint8_t shift ) : shift_( shift ) {}
+  std::string description() const override
+  {
+    return "peer's SYN advertises window scale " + std::to_string( shift_ );
+  }
+  void execute( SenderAndOutput& ss ) const override { ss.sender.set_peer_window_scale( shift_ ); }
+};
+
 struct AckReceived : public Receive
 {
   explicit AckReceived( Wrap32 ackno ) : Receive( { ackno, DEFAULT_TEST_WINDOW } ) {}
@@ -235,6 +332,9 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
   std::optional<bool> syn {};
   std::optional<bool> fin {};
   std::optional<bool> rst {};
+  std::optional<bool> sack_permitted {};
+  std::optional<uint16_t> mss {};
+  std::optional<uint64_t> segment_size {};
   std::optional<Wrap32> seqno {};
   std::optional<std::string> data {};
   std::optional<size_t> payload_size {};
@@ -263,6 +363,24 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
     return *this;
   }
 
+  ExpectMessage& with_sack_permitted( bool sack_permitted_ )
+  {
+    sack_permitted = sack_permitted_;
+    return *this;
+  }
+
+  ExpectMessage& with_mss( uint16_t mss_ )
+  {
+    mss = mss_;
+    return *this;
+  }
+
+  ExpectMessage& with_segment_size( uint64_t segment_size_ )
+  {
+    segment_size = segment_size_;
+    return *this;
+  }
+
   ExpectMessage& with_seqno( Wrap32 seqno_ )
   {
     seqno = seqno_;
@@ -292,6 +410,15 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
     if ( syn.has_value() ) {
       o << ( syn.value() ? " +SYN" : " (no SYN)" );
     }
+    if ( sack_permitted.has_value() ) {
+      o << ( sack_permitted.value() ? " +SACK-permitted" : " (no SACK-permitted)" );
+    }
+    if ( mss.has_value() ) {
+      o << " MSS=" << mss.value();
+    }
+    if ( segment_size.has_value() ) {
+      o << " segment_size=" << segment_size.value();
+    }
     if ( payload_size.has_value() ) {
       if ( payload_size.value() ) {
         o << " payload_len=" << payload_size.value();
@@ -328,6 +455,15 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
     if ( syn.has_value() and seg.SYN != syn.value() ) {
       throw ExpectationViolation( "SYN flag", syn.value(), seg.SYN );
     }
+    if ( sack_permitted.has_value() and seg.SACK_permitted != sack_permitted.value() ) {
+      throw ExpectationViolation( "SACK-permitted option", sack_permitted.value(), seg.SACK_permitted );
+    }
+    if ( mss.has_value() and seg.MSS != mss.value() ) {
+      throw ExpectationViolation( "MSS option", mss.value(), seg.MSS );
+    }
+    if ( segment_size.has_value() and seg.segment_size != segment_size.value() ) {
+      throw ExpectationViolation( "segment size", segment_size.value(), seg.segment_size );
+    }
     if ( fin.has_value() and seg.FIN != fin.value() ) {
       throw ExpectationViolation( "FIN flag", fin.value(), seg.FIN );
     }
@@ -340,7 +476,7 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
     if ( payload_size.has_value() and seg.payload.size() != payload_size.value() ) {
       throw ExpectationViolation( "payload_size", payload_size.value(), seg.payload.size() );
     }
-    if ( seg.payload.size() > TCPConfig::MAX_PAYLOAD_SIZE ) {
+    if ( seg.payload.size() > ss.max_payload_size ) {
       throw ExpectationViolation( "payload has length (" + std::to_string( seg.payload.size() )
                                   + ") greater than the maximum" );
     }
@@ -356,9 +492,22 @@ struct ExpectMessage : public Expectation<SenderAndOutput>
 class TCPSenderTestHarness : public TestHarness<SenderAndOutput>
 {
 public:
-  TCPSenderTestHarness( std::string name, TCPConfig config )
-    : TestHarness( move( name ),
-                   "initial_RTO_ms=" + to_string( config.rt_timeout ),
-                   { TCPSender { ByteStream { config.send_capacity }, config.isn, config.rt_timeout } } )
+  TCPSenderTestHarness( std::string name,
+                        TCPConfig config,
+                        std::optional<TCPSender::RTOBounds> rto_bounds = std::nullopt )
+    : TestHarness(
+      move( name ),
+      "initial_RTO_ms=" + to_string( config.rt_timeout )
+        + ( rto_bounds.has_value() ? ", RTO bounds=[" + to_string( rto_bounds->min_ms ) + ", "
+                                       + to_string( rto_bounds->max_ms ) + "]"
+                                   : "" ),
+      { TCPSender { ByteStream { config.send_capacity },
+                    config.isn,
+                    config.rt_timeout,
+                    make_congestion_controller( config.congestion_control, config.mss() ),
+                    rto_bounds,
+                    { config.mss(), config.segmentation_offload, config.path_mtu_discovery } },
+        {},
+        config.segmentation_offload ? TCPConfig::MAX_GSO_PAYLOAD_SIZE : config.mss() } )
   {}
 };
@@ -0,0 +1,110 @@
+#include "syn_cookies.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+
+void expect( const bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( what );
+  }
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    // SipHash-2-4 against the reference vectors (key 00 01 .. 0f, messages 00 01 .. of each length)
+    {
+      const SipHashKey key { 0x0706050403020100ULL, 0x0f0e0d0c0b0a0908ULL };
+      const string message = "\x00\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e"s;
+      expect( siphash24( key, {} ) == 0x726fdb47dd0e0e31ULL, "SipHash of the empty message" );
+      expect( siphash24( key, string_view { message }.substr( 0, 8 ) ) == 0x93f5f5799a932462ULL,
+              "SipHash of 8 bytes" );
+      expect( siphash24( key, message ) == 0xa129ca6149be45e5ULL, "SipHash of 15 bytes" );
+    }
+
+    // (a fixed seed: a wrong cookie has a 1 in 2^24 chance of passing, so a random one would fail now and then)
+    default_random_engine rd { 1370 };
+    uniform_int_distribution<uint64_t> secret_half;
+    const SYNCookies cookies { { secret_half( rd ), secret_half( rd ) } };
+
+    for ( size_t i = 0; i < 10000; ++i ) {
+      const FourTuple tuple { static_cast<uint32_t>( rd() ),
+                              static_cast<uint32_t>( rd() ),
+                              static_cast<uint16_t>( rd() ),
+                              static_cast<uint16_t>( rd() ) };
+      const Wrap32 isn { static_cast<uint32_t>( rd() ) };
+      const auto mss = static_cast<uint16_t>( rd() % 10000 );
+      const uint64_t now = uniform_int_distribution<uint64_t> { 0, uint64_t { 1 } << 40 }( rd );
+      const auto made = cookies.make( tuple, isn, mss, now );
+      if ( mss != 0 and mss < SYNCookies::MIN_MSS ) {
+        expect( not made.has_value(), "MSS " + to_string( mss ) + " got a cookie" );
+        continue;
+      }
+      expect( made.has_value(), "MSS " + to_string( mss ) + " got no cookie" );
+      const Wrap32 cookie = *made;
+
+      // the cookie comes back with the MSS, rounded down to one in the table
+      const auto checked = cookies.check( tuple, isn, cookie, now );
+      expect( checked.has_value(), "a fresh cookie was rejected" );
+      expect( *checked <= mss, "MSS " + to_string( mss ) + " came back as " + to_string( *checked ) );
+      for ( const auto entry : SYNCookies::MSS_TABLE ) {
+        expect( entry <= *checked or entry > mss, "MSS " + to_string( mss ) + " was rounded down too far" );
+      }
+
+      // it's still good in the next period, but not the one after
+      const uint64_t period_end = ( now / SYNCookies::PERIOD_MS + 1 ) * SYNCookies::PERIOD_MS;
+      expect( cookies.check( tuple, isn, cookie, period_end + SYNCookies::PERIOD_MS - 1 ) == checked,
+              "a cookie expired too soon" );
+      expect( not cookies.check( tuple, isn, cookie, period_end + SYNCookies::PERIOD_MS ).has_value(),
+              "an old cookie was accepted" );
+      expect( not cookies.check( tuple, isn, cookie, period_end + 32 * SYNCookies::PERIOD_MS ).has_value(),
+              "a cookie from 32 periods ago was accepted" );
+      if ( now >= SYNCookies::PERIOD_MS ) {
+        expect( not cookies.check( tuple, isn, cookie, now - SYNCookies::PERIOD_MS ).has_value(),
+                "a cookie from the future was accepted" );
+      }
+
+      // and it's only good for that SYN
+      FourTuple other = tuple;
+      other.remote_port ^= 1;
+      expect( not cookies.check( other, isn, cookie, now ).has_value(), "a cookie for another port" );
+      expect( not cookies.check( tuple, isn + 1, cookie, now ).has_value(), "a cookie for another ISN" );
+      expect( not cookies.check( tuple, isn, cookie + 1, now ).has_value(), "a wrong cookie" );
+    }
+
+    // a listener with another secret makes other cookies
+    const SYNCookies others { { 1370, 1371 } };
+    const FourTuple tuple { 1, 2, 3, 4 };
+    const Wrap32 cookie = cookies.make( tuple, Wrap32 { 5 }, 1460, 0 ).value();
+    expect( not others.check( tuple, Wrap32 { 5 }, cookie, 0 ).has_value(), "another secret's cookie" );
+
+    // a SYN without an MSS comes back without one, but a small MSS isn't mistaken for that: it gets no cookie
+    expect( cookies.check( tuple, Wrap32 { 5 }, cookies.make( tuple, Wrap32 { 5 }, 0, 0 ).value(), 0 ) == 0,
+            "no MSS came back as one" );
+    for ( const uint16_t mss : { 1, 88, 535 } ) {
+      expect( not cookies.make( tuple, Wrap32 { 5 }, mss, 0 ).has_value(),
+              "MSS " + to_string( mss ) + " got a cookie" );
+    }
+    expect( cookies.check( tuple, Wrap32 { 5 }, cookies.make( tuple, Wrap32 { 5 }, 536, 0 ).value(), 0 ) == 536,
+            "the smallest MSS didn't come back" );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,165 @@
+#include "emulated_link.hh"
+#include "tcp_config.hh"
+#include "tcp_receiver.hh"
+#include "tcp_sender.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+constexpr uint64_t HEADER_SIZE = 40;            // IPv4 + TCP headers, for the link's accounting
+constexpr uint64_t GIVE_UP_MS = 10 * 60 * 1000; // simulated time limit for one transfer
+constexpr uint64_t BDP = 25000;                 // bytes in flight on a 10 Mbit/s link with a 20 ms RTT
+
+struct Result
+{
+  bool finished;
+  uint64_t duration_ms;
+  uint64_t fast_retransmissions;
+  uint64_t timeout_retransmissions;
+  uint64_t queue_drops;
+  double average_queueing_delay_ms;
+};
+
+string generate_data( const size_t len, const size_t random_seed )
+{
+  default_random_engine rd { random_seed };
+  uniform_int_distribution<char> ud;
+  string ret;
+  for ( size_t i = 0; i < len; ++i ) {
+    ret += ud( rd );
+  }
+  return ret;
+}
+
+// Send `data` across a 10 Mbit/s, 20 ms RTT link with a `queue_limit`-byte queue (acknowledgments come back over
+// a lossless one), and check that it arrives
+Result transfer( const string& data,
+                 const CongestionControl kind,
+                 const uint64_t queue_limit,
+                 const double loss_rate )
+{
+  TCPSender sender { ByteStream { TCPConfig::DEFAULT_CAPACITY },
+                     Wrap32 { 1370 },
+                     TCPConfig::TIMEOUT_DFLT,
+                     make_congestion_controller( kind, TCPConfig::MAX_PAYLOAD_SIZE ),
+                     TCPSender::RTOBounds { TCPConfig::RTO_MIN_DFLT, TCPConfig::RTO_MAX_DFLT } };
+  TCPReceiver receiver { Reassembler { ByteStream { TCPConfig::DEFAULT_CAPACITY } } };
+
+  EmulatedLink<TCPSenderMessage> forward {
+    { .bytes_per_ms = 1250, .delay_ms = 10, .queue_limit = queue_limit, .loss_rate = loss_rate }, 1370 };
+  EmulatedLink<TCPReceiverMessage> reverse { { .bytes_per_ms = 1250, .delay_ms = 10, .queue_limit = UINT64_MAX },
+                                             1370 };
+
+  uint64_t now = 0;
+  const auto transmit = [&]( const TCPSenderMessage& msg ) {
+    forward.send( msg, msg.payload.size() + HEADER_SIZE, now );
+  };
+
+  string received;
+  received.reserve( data.size() );
+  uint64_t written = 0;
+
+  for ( ; not receiver.reader().is_finished(); ++now ) {
+    if ( now > GIVE_UP_MS ) {
+      break;
+    }
+
+    for ( auto& msg : forward.deliver( now ) ) {
+      receiver.receive( move( msg ) );
+      reverse.send( receiver.send(), HEADER_SIZE, now );
+    }
+    while ( receiver.reader().bytes_buffered() ) {
+      received += receiver.reader().peek();
+      receiver.reader().pop( received.size() - receiver.reader().bytes_popped() );
+    }
+
+    for ( const auto& ack : reverse.deliver( now ) ) {
+      sender.receive( ack );
+    }
+
+    const uint64_t room = min( sender.writer().available_capacity(), data.size() - written );
+    sender.writer().push( data.substr( written, room ) );
+    written += room;
+    if ( written == data.size() and not sender.writer().is_closed() ) {
+      sender.writer().close();
+    }
+
+    sender.push( transmit );
+    sender.tick( 1, transmit );
+  }
+
+  const bool finished = receiver.reader().is_finished();
+  if ( received != data.substr( 0, received.size() ) or ( finished and received.size() != data.size() ) ) {
+    throw runtime_error( "Mismatch between data sent and received" );
+  }
+
+  const auto& link = forward.stats();
+  const uint64_t delivered = link.messages_sent - link.random_losses - link.queue_drops;
+  return { finished,
+           now,
+           sender.fast_retransmissions(),
+           sender.timeout_retransmissions(),
+           link.queue_drops,
+           link.total_queueing_delay_ms / static_cast<double>( max( delivered, uint64_t { 1 } ) ) };
+}
+
+void program_body()
+{
+  const string data = generate_data( 4 << 20, 1370 );
+
+  cout << "Transfer of " << data.size() << " bytes over a 10 Mbit/s link with 20 ms RTT (BDP " << BDP
+       << " bytes):\n";
+  cout << "   queue   loss  controller  goodput (Mbit/s)  fast retx  timeout retx  queue drops"
+          "  queueing delay (ms)\n";
+
+  // shallow, BDP-sized and deep bottleneck buffers, the BDP-sized one also with random loss
+  const vector<pair<uint64_t, double>> scenarios {
+    { BDP / 2, 0 }, { BDP, 0 }, { BDP, 0.01 }, { BDP, 0.05 }, { BDP * 4, 0 } };
+
+  for ( const auto& [queue_limit, loss_rate] : scenarios ) {
+    for ( const auto kind : { CongestionControl::None,
+                              CongestionControl::Reno,
+                              CongestionControl::NewReno,
+                              CongestionControl::Cubic,
+                              CongestionControl::BBR } ) {
+      const auto controller = make_congestion_controller( kind, TCPConfig::MAX_PAYLOAD_SIZE );
+      const auto result = transfer( data, kind, queue_limit, loss_rate );
+      const double goodput
+        = static_cast<double>( data.size() ) * 8 / static_cast<double>( result.duration_ms ) / 1e3;
+
+      cout << setw( 8 ) << queue_limit << setw( 6 ) << fixed << setprecision( 0 ) << loss_rate * 100 << "%  "
+           << left << setw( 10 ) << ( controller ? controller->name() : "none" ) << right;
+      if ( not result.finished ) {
+        cout << "  gave up after " << GIVE_UP_MS / 1000 << " s of simulated time\n";
+        continue;
+      }
+      cout << setw( 18 ) << setprecision( 2 ) << goodput << setw( 11 ) << result.fast_retransmissions << setw( 14 )
+           << result.timeout_retransmissions << setw( 13 ) << result.queue_drops << setw( 21 ) << setprecision( 1 )
+           << result.average_queueing_delay_ms << "\n";
+    }
+  }
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,251 @@
+#include "emulated_link.hh"
+#include "tcp_config.hh"
+#include "tcp_peer.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+constexpr size_t MSS = TCPConfig::MAX_PAYLOAD_SIZE;
+constexpr uint64_t ACK_DELAY = TCPConfig::ACK_DELAY_DFLT;
+
+void expect( const bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( what );
+  }
+}
+
+// A client and a server with delayed ACKs, with the messages each sends held until the test delivers them
+class Connection
+{
+  vector<TCPMessage> to_server_ {};
+  vector<TCPMessage> to_client_ {};
+
+  TCPPeer::TransmitFunction send_to_server()
+  {
+    return [this]( TCPMessage msg ) { to_server_.push_back( move( msg ) ); };
+  }
+  TCPPeer::TransmitFunction send_to_client()
+  {
+    return [this]( TCPMessage msg ) { to_client_.push_back( move( msg ) ); };
+  }
+
+  static TCPConfig server_config()
+  {
+    TCPConfig cfg;
+    cfg.isn = Wrap32 { 1370 };
+    cfg.delayed_ack = true;
+    return cfg;
+  }
+
+public:
+  TCPPeer client { TCPConfig {} };
+  TCPPeer server { server_config() };
+
+  // The client writes `data` (and closes the stream, if asked), and sends it
+  vector<TCPMessage> write( const string& data, const bool close = false )
+  {
+    client.outbound_writer().push( data );
+    if ( close ) {
+      client.outbound_writer().close();
+    }
+    client.push( send_to_server() );
+    return exchange( to_server_, {} );
+  }
+
+  // Deliver a message to the server, and return its replies
+  vector<TCPMessage> deliver( const TCPMessage& msg )
+  {
+    server.receive( msg, send_to_client() );
+    return exchange( to_client_, {} );
+  }
+
+  vector<TCPMessage> tick( const uint64_t ms )
+  {
+    server.tick( ms, send_to_client() );
+    return exchange( to_client_, {} );
+  }
+
+  void connect()
+  {
+    client.push( send_to_server() );
+    const auto syn = exchange( to_server_, {} );
+    expect( syn.size() == 1, "no SYN" );
+    const auto syn_ack = deliver( syn.front() );
+    expect( syn_ack.size() == 1 and syn_ack.front().sender.SYN, "the SYN wasn't answered at once" );
+    client.receive( syn_ack.front(), send_to_server() );
+    const auto ack = exchange( to_server_, {} );
+    expect( ack.size() == 1, "the SYN-ACK wasn't acknowledged" );
+    expect( deliver( ack.front() ).empty(), "the handshake's ACK was answered" );
+  }
+};
+
+// One reply, a bare ACK of everything up to `ackno` (counting the SYN)
+void expect_ack( const vector<TCPMessage>& replies, const uint64_t ackno, const string& when )
+{
+  expect( replies.size() == 1, when + ": expected one ACK, got " + to_string( replies.size() ) + " messages" );
+  expect( replies.front().receiver.ackno == Wrap32 { 137 } + ackno, when + ": wrong ackno" );
+}
+
+void check_rules()
+{
+  const string data( 3 * MSS, 'x' );
+  Connection c;
+  c.connect();
+
+  // one segment: the ACK waits for the timer
+  auto segments = c.write( data.substr( 0, MSS ) );
+  expect( c.deliver( segments.at( 0 ) ).empty(), "a single segment was acknowledged at once" );
+  expect( c.tick( ACK_DELAY - 1 ).empty(), "the delayed ACK went out early" );
+  expect_ack( c.tick( 1 ), 1 + MSS, "after the ACK delay" );
+  expect( c.tick( ACK_DELAY ).empty(), "the delayed ACK went out twice" );
+
+  // two segments: the second is acknowledged at once, and the timer stops
+  segments = c.write( data.substr( 0, 2 * MSS ) );
+  expect( c.deliver( segments.at( 0 ) ).empty(), "the first of two segments was acknowledged at once" );
+  expect_ack( c.deliver( segments.at( 1 ) ), 1 + 3 * MSS, "after two segments" );
+  expect( c.tick( ACK_DELAY ).empty(), "the timer ran on after the ACK" );
+
+  // a segment after a gap, and the one that fills it, are acknowledged at once
+  segments = c.write( data );
+  expect_ack( c.deliver( segments.at( 1 ) ), 1 + 3 * MSS, "after a gap" );
+  expect_ack( c.deliver( segments.at( 0 ) ), 1 + 5 * MSS, "after filling the gap" );
+  expect( c.deliver( segments.at( 2 ) ).empty(), "an in-order segment was acknowledged at once" );
+
+  // data the server sends carries the ACK, so the delayed one isn't needed
+  c.server.outbound_writer().push( "hello" );
+  c.server.push( [&]( const TCPMessage& msg ) {
+    expect( msg.sender.payload == "hello" and msg.receiver.ackno == Wrap32 { 137 } + 1 + 6 * MSS,
+            "the reply doesn't carry the ACK" );
+  } );
+  expect( c.tick( ACK_DELAY ).empty(), "a delayed ACK went out after the reply carried it" );
+
+  // a retransmitted segment (a duplicate) is acknowledged at once
+  expect_ack( c.deliver( segments.at( 2 ) ), 1 + 6 * MSS, "after a duplicate" );
+
+  // small segments aren't full-sized: the ACK waits for two full segments' worth of data, or the timer
+  for ( size_t i = 0; i < 3; ++i ) {
+    segments = c.write( "tiny" );
+    expect( c.deliver( segments.at( 0 ) ).empty(), "a small segment was acknowledged at once" );
+  }
+  expect( c.tick( ACK_DELAY - 1 ).empty(), "the delayed ACK of small segments went out early" );
+  expect_ack( c.tick( 1 ), 1 + 6 * MSS + 12, "after small segments" );
+
+  // the FIN is acknowledged at once
+  segments = c.write( "bye", true );
+  expect( segments.size() == 1 and segments.front().sender.FIN, "no FIN" );
+  expect_ack( c.deliver( segments.front() ), 1 + 6 * MSS + 16, "after the FIN" );
+}
+
+struct Result
+{
+  uint64_t duration_ms;
+  uint64_t data_segments;
+  uint64_t acks;
+};
+
+// Send `data` from one TCPPeer to another across a 10 Mbit/s path with a 20 ms RTT, and count the segments
+// carrying it and the bare ACKs that come back
+Result transfer( const string& data, const bool delayed_ack )
+{
+  TCPConfig client_config;
+  TCPConfig server_config;
+  server_config.isn = Wrap32 { 1370 };
+  server_config.delayed_ack = delayed_ack;
+  TCPPeer client { client_config };
+  TCPPeer server { server_config };
+
+  const EmulatedLink<TCPMessage>::Config path { .bytes_per_ms = 1250, .delay_ms = 10, .queue_limit = UINT64_MAX };
+  EmulatedLink<TCPMessage> to_server { path, 1370 };
+  EmulatedLink<TCPMessage> to_client { path, 1370 };
+
+  uint64_t now = 0;
+  Result result {};
+  const auto send_to_server = [&]( const TCPMessage& msg ) {
+    result.data_segments += msg.sender.sequence_length() > 0;
+    to_server.send( msg, msg.sender.payload.size() + TCPConfig::HEADERS_SIZE, now );
+  };
+  const auto send_to_client = [&]( const TCPMessage& msg ) {
+    result.acks += msg.sender.sequence_length() == 0;
+    to_client.send( msg, msg.sender.payload.size() + TCPConfig::HEADERS_SIZE, now );
+  };
+
+  string received;
+  uint64_t written = 0;
+  for ( ; not server.inbound_reader().is_finished(); ++now ) {
+    expect( now < 60 * 1000, "gave up after 60 s of simulated time" );
+
+    for ( auto& msg : to_server.deliver( now ) ) {
+      server.receive( move( msg ), send_to_client );
+    }
+    for ( auto& msg : to_client.deliver( now ) ) {
+      client.receive( move( msg ), send_to_server );
+    }
+    while ( server.inbound_reader().bytes_buffered() ) {
+      received += server.inbound_reader().peek();
+      server.inbound_reader().pop( received.size() - server.inbound_reader().bytes_popped() );
+    }
+
+    const uint64_t room = min( client.outbound_writer().available_capacity(), data.size() - written );
+    client.outbound_writer().push( data.substr( written, room ) );
+    written += room;
+    if ( written == data.size() and not client.outbound_writer().is_closed() ) {
+      client.outbound_writer().close();
+    }
+
+    client.push( send_to_server );
+    client.tick( 1, send_to_server );
+    server.tick( 1, send_to_client );
+  }
+
+  expect( received == data, "Mismatch between data sent and received" );
+  result.duration_ms = now;
+  return result;
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    check_rules();
+
+    const string data = [] {
+      default_random_engine rd { 1370 };
+      uniform_int_distribution<char> ud;
+      string ret;
+      for ( size_t i = 0; i < 1 << 20; ++i ) {
+        ret += ud( rd );
+      }
+      return ret;
+    }();
+
+    const auto every = transfer( data, false );
+    const auto delayed = transfer( data, true );
+    for ( const auto& [name, r] : { pair { "without", every }, pair { "with", delayed } } ) {
+      cout << "1 MB " << name << " delayed ACKs: " << r.duration_ms << " ms, " << r.data_segments
+           << " data segments, " << r.acks << " bare ACKs (ack-to-data ratio "
+           << static_cast<double>( r.acks ) / static_cast<double>( r.data_segments ) << ")\n";
+    }
+    expect( every.acks >= every.data_segments - 1, "not every segment was acknowledged without delayed ACKs" );
+    expect( 2 * delayed.acks <= delayed.data_segments + 2, "delayed ACKs didn't halve the ACKs" );
+    expect( delayed.duration_ms <= every.duration_ms + 2 * ACK_DELAY, "delayed ACKs slowed the transfer down" );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
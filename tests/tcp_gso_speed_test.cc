@@ -0,0 +1,128 @@
+#include "parser.hh"
+#include "tcp_config.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_sender.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+constexpr uint16_t WINDOW = UINT16_MAX;
+
+// Time the send path, from the outbound stream to serialized IPv4 datagrams, with every message acknowledged
+// as soon as it's sent. Returns the payload throughput in Gbit/s.
+double speed_test( const string& data, const bool segmentation_offload )
+{
+  TCPConfig config;
+  config.segmentation_offload = segmentation_offload;
+  config.send_capacity = 1 << 20;
+
+  TCPSender sender { ByteStream { config.send_capacity },
+                     config.isn,
+                     config.rt_timeout,
+                     nullptr,
+                     nullopt,
+                     { config.mss(), config.segmentation_offload, false } };
+  TCPOverIPv4Adapter adapter;
+  adapter.config_mut().source = Address { "10.0.0.1", 1234 };
+  adapter.config_mut().destination = Address { "10.0.0.2", 5678 };
+
+  uint64_t messages = 0;
+  uint64_t datagrams = 0;
+  uint64_t wire_bytes = 0;
+  Wrap32 next_seqno = config.isn;
+  const auto transmit = [&]( const TCPSenderMessage& msg ) {
+    ++messages;
+    for ( const auto& dgram : adapter.wrap_tcp_in_ip( { msg, {} } ) ) {
+      ++datagrams;
+      for ( const auto& piece : serialize( dgram ) ) {
+        wire_bytes += piece.size();
+      }
+    }
+    next_seqno = msg.seqno + msg.sequence_length();
+  };
+
+  size_t written = 0;
+  const auto start_time = steady_clock::now();
+  while ( not sender.reader().is_finished() or sender.sequence_numbers_in_flight() ) {
+    const size_t room = min( sender.writer().available_capacity(), data.size() - written );
+    if ( room ) {
+      sender.writer().push( data.substr( written, room ) );
+      written += room;
+    } else if ( written == data.size() and not sender.writer().is_closed() ) {
+      sender.writer().close();
+    }
+
+    sender.push( transmit );
+    sender.receive( { next_seqno, WINDOW } );
+  }
+  const auto stop_time = steady_clock::now();
+
+  // every datagram carries a 40-byte header (no options without SACK blocks or a SYN)
+  const uint64_t expected_wire_bytes = data.size() + 40 * datagrams + 8 /* MSS and SACK-permitted on the SYN */;
+  if ( wire_bytes != expected_wire_bytes ) {
+    throw runtime_error( "wrote " + to_string( wire_bytes ) + " bytes to the wire, expected "
+                         + to_string( expected_wire_bytes ) );
+  }
+
+  const auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  const double gigabits_per_second = static_cast<double>( data.size() ) * 8 / test_duration.count() / 1e9;
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "Send path with" << ( segmentation_offload ? "    " : "out " ) << "segmentation offload: " << setw( 7 )
+       << messages << " messages, " << setw( 7 ) << datagrams << " datagrams, " << fixed << setprecision( 2 )
+       << gigabits_per_second << " Gbit/s.\n";
+  debug_output << "             send path " << ( segmentation_offload ? "with" : "without" )
+               << " segmentation offload: " << fixed << setprecision( 2 ) << gigabits_per_second << " Gbit/s\n";
+
+  if ( gigabits_per_second < 0.1 ) {
+    throw runtime_error( "Send path did not meet minimum speed of 0.1 Gbit/s." );
+  }
+
+  return gigabits_per_second;
+}
+
+void program_body()
+{
+  const string data = [] {
+    default_random_engine rd { 1370 };
+    uniform_int_distribution<char> ud;
+    string ret;
+    for ( size_t i = 0; i < 100 << 20; ++i ) {
+      ret += ud( rd );
+    }
+    return ret;
+  }();
+
+  const double per_segment = speed_test( data, false );
+  const double offloaded = speed_test( data, true );
+  cout << "Segmentation offload speedup: " << fixed << setprecision( 2 ) << offloaded / per_segment << "x\n";
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
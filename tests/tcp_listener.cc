@@ -0,0 +1,128 @@
+#include "exception.hh"
+#include "tcp_config.hh"
+#include "tcp_listener.hh"
+#include "tcp_stack.hh"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+void expect( const bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( what );
+  }
+}
+
+const Address CLIENT_ADDRESS { "10.0.0.1" };
+const Address SERVER_ADDRESS { "10.0.0.2", 80 };
+constexpr size_t CONNECTIONS = 50;
+constexpr auto GIVE_UP = seconds { 10 };
+
+string read_all( TCPPeer& peer )
+{
+  string ret;
+  while ( peer.inbound_reader().bytes_buffered() ) {
+    ret += peer.inbound_reader().peek();
+    peer.inbound_reader().pop( ret.size() - peer.inbound_reader().bytes_popped() );
+  }
+  return ret;
+}
+
+// Open every connection at once, send each one's request, and collect the replies
+vector<string> run_clients( TCPStackLoop& client )
+{
+  TCPStack& stack = client.stack();
+  vector<TCPStack::ConnectionID> ids;
+  for ( size_t i = 0; i < CONNECTIONS; ++i ) {
+    ids.push_back( stack.connect( SERVER_ADDRESS, {} ) );
+    stack.peer( ids.back() ).outbound_writer().push( "client " + to_string( i ) );
+    stack.close( ids.back() );
+  }
+
+  vector<string> replies( CONNECTIONS );
+  const auto deadline = steady_clock::now() + GIVE_UP;
+  size_t finished = 0;
+  while ( finished < CONNECTIONS and steady_clock::now() < deadline ) {
+    client.wait_next_event( 1 );
+    finished = 0;
+    for ( size_t i = 0; i < CONNECTIONS; ++i ) {
+      replies[i] += read_all( stack.peer( ids[i] ) );
+      finished += stack.peer( ids[i] ).inbound_reader().is_finished();
+    }
+  }
+  return replies;
+}
+
+// The application's side: accept each connection, read its request to the end, and answer
+void serve( TCPListener& listener )
+{
+  for ( size_t i = 0; i < CONNECTIONS; ++i ) {
+    LocalStreamSocket socket = listener.accept();
+    string request;
+    while ( not socket.eof() ) {
+      string buffer;
+      socket.read( buffer );
+      request += buffer;
+    }
+    expect( request.starts_with( "client " ), "the server got \"" + request + "\"" );
+    socket.write( "hello, " + request );
+  }
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    array<int, 2> fds {};
+    CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_DGRAM, 0, fds.data() ) );
+    TCPStackLoop client { FileDescriptor { fds[0] }, CLIENT_ADDRESS };
+    TCPListener listener { FileDescriptor { fds[1] }, SERVER_ADDRESS, {} };
+
+    vector<string> replies;
+    exception_ptr client_failure;
+    thread client_thread { [&] {
+      try {
+        replies = run_clients( client );
+      } catch ( ... ) {
+        client_failure = current_exception();
+      }
+    } };
+    exception_ptr server_failure;
+    try {
+      serve( listener );
+    } catch ( ... ) {
+      server_failure = current_exception();
+    }
+    client_thread.join();
+    for ( const auto& failure : { server_failure, client_failure } ) {
+      if ( failure ) {
+        rethrow_exception( failure );
+      }
+    }
+
+    for ( size_t i = 0; i < CONNECTIONS; ++i ) {
+      expect( replies[i] == "hello, client " + to_string( i ),
+              "client " + to_string( i ) + " got \"" + replies[i] + "\"" );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
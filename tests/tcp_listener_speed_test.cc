@@ -0,0 +1,207 @@
+#include "emulated_link.hh"
+#include "tcp_config.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_stack.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+const Address CLIENT_ADDRESS { "10.0.0.1" };
+const Address SERVER_ADDRESS { "10.0.0.2", 80 };
+constexpr uint64_t CONNECT_MS = 8000;   // clients connect during the first 8 s of simulated time
+constexpr uint64_t CONNECTS_PER_MS = 1; // 8000 connections in all
+constexpr uint64_t DURATION_MS = 10000; // simulated time for one run (the flood lasts all of it)
+constexpr uint64_t TICK_MS = 10;        // how often the stacks' timers run, as in a TCPMinnowSocket
+
+// Hands every datagram a TCPStack sends to an EmulatedLink
+class LinkPort : public TCPStack::OutputPort
+{
+  EmulatedLink<InternetDatagram>& link_;
+  const uint64_t& now_;
+
+public:
+  LinkPort( EmulatedLink<InternetDatagram>& link, const uint64_t& now ) : link_( link ), now_( now ) {}
+
+  void transmit( const TCPStack& sender [[maybe_unused]], const InternetDatagram& dgram ) override
+  {
+    link_.send( dgram, dgram.header.len, now_ );
+  }
+};
+
+struct Result
+{
+  uint64_t attempts;
+  vector<uint64_t> latencies_ms; // from connect() to accept(), of each connection that was accepted
+  uint64_t syn_drops;
+  size_t most_half_open;
+  double accepts_per_second; // wall-clock
+};
+
+// A SYN from a random (spoofed) address, which will never answer the SYN-ACK
+vector<InternetDatagram> spoofed_syn( default_random_engine& rd )
+{
+  TCPMessage syn;
+  syn.sender.SYN = true;
+  syn.sender.seqno = Wrap32 { static_cast<uint32_t>( rd() ) };
+  syn.receiver.window_size = UINT16_MAX;
+  const FourTuple tuple { .local_ip = 0xac100000 | ( static_cast<uint32_t>( rd() ) & 0xfffff ), // 172.16.0.0/12
+                          .remote_ip = SERVER_ADDRESS.ipv4_numeric(),
+                          .local_port = static_cast<uint16_t>( rd() ),
+                          .remote_port = SERVER_ADDRESS.port() };
+  return TCPOverIPv4Adapter::wrap_tcp_in_ip( syn, tuple );
+}
+
+// Connect clients to a listener at a steady rate, while a flood of spoofed SYNs arrives at `flood_per_second`,
+// across a path with a 2 ms RTT
+Result run( const uint64_t flood_per_second, const size_t syn_backlog, const bool syn_cookies )
+{
+  uint64_t now = 0;
+  // (a datagram arrives in the millisecond after it was sent)
+  const EmulatedLink<InternetDatagram>::Config path {
+    .bytes_per_ms = 1e9, .delay_ms = 0, .queue_limit = UINT64_MAX };
+  EmulatedLink<InternetDatagram> to_server { path, 1370 };
+  EmulatedLink<InternetDatagram> to_client { path, 1370 };
+  TCPStack client { make_shared<LinkPort>( to_server, now ), CLIENT_ADDRESS };
+  TCPStack server { make_shared<LinkPort>( to_client, now ), SERVER_ADDRESS };
+  TCPConfig server_config;
+  server_config.syn_cookies = syn_cookies;
+  server.listen( SERVER_ADDRESS.port(), server_config, syn_backlog );
+
+  default_random_engine rd { 1370 };
+  unordered_map<uint16_t, uint64_t> connect_time; // by the client's port
+  vector<TCPStack::ConnectionID> clients;
+  Result result { 0, {}, 0, 0, 0 };
+  double flood_owed = 0;
+
+  const auto start_time = steady_clock::now();
+  for ( ; now < DURATION_MS; ++now ) {
+    if ( now < CONNECT_MS ) {
+      for ( uint64_t i = 0; i < CONNECTS_PER_MS; ++i ) {
+        const auto id = client.connect( SERVER_ADDRESS, {} );
+        connect_time.insert_or_assign( client.tuple( id ).local_port, now );
+        clients.push_back( id );
+        ++result.attempts;
+      }
+    }
+    for ( flood_owed += static_cast<double>( flood_per_second ) / 1000; flood_owed >= 1; --flood_owed ) {
+      for ( const auto& dgram : spoofed_syn( rd ) ) {
+        server.receive( dgram );
+      }
+    }
+
+    for ( const auto& dgram : to_server.deliver( now ) ) {
+      server.receive( dgram );
+    }
+    for ( const auto& dgram : to_client.deliver( now ) ) {
+      client.receive( dgram );
+    }
+
+    // the server's application accepts (and hangs up on) every connection at once
+    while ( const auto id = server.accept( SERVER_ADDRESS.port() ) ) {
+      const auto it = connect_time.find( server.tuple( *id ).remote_port );
+      if ( it == connect_time.end() ) {
+        throw runtime_error( "accepted a connection that no client made" );
+      }
+      result.latencies_ms.push_back( now - it->second );
+      connect_time.erase( it );
+      server.close( *id );
+    }
+    // and the clients hang up once the server has
+    erase_if( clients, [&]( const TCPStack::ConnectionID id ) {
+      if ( not client.peer( id ).inbound_reader().is_finished() ) {
+        return false;
+      }
+      client.close( id );
+      return true;
+    } );
+
+    result.most_half_open = max( result.most_half_open, server.half_open_count( SERVER_ADDRESS.port() ) );
+    if ( now % TICK_MS == 0 ) {
+      client.tick( TICK_MS );
+      server.tick( TICK_MS );
+    }
+  }
+  const auto test_duration = duration_cast<duration<double>>( steady_clock::now() - start_time );
+
+  result.syn_drops = server.stats().syn_drops;
+  result.accepts_per_second = static_cast<double>( result.latencies_ms.size() ) / test_duration.count();
+  return result;
+}
+
+// The latency that `fraction` of the attempts beat, or nothing if too few were accepted at all
+string percentile( const Result& result, const double fraction )
+{
+  vector<uint64_t> sorted = result.latencies_ms;
+  sort( sorted.begin(), sorted.end() );
+  const auto rank = static_cast<size_t>( fraction * static_cast<double>( result.attempts ) );
+  return rank < sorted.size() ? to_string( sorted[rank] ) : "never";
+}
+
+void program_body()
+{
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "Clients open " << CONNECTS_PER_MS * CONNECT_MS << " connections over " << CONNECT_MS
+       << " ms (2 ms RTT), for " << DURATION_MS << " ms of simulated time:\n";
+  cout << "  spoofed SYN/s  SYN backlog  cookies  accepted  p50 (ms)  p99 (ms)  most half-open  SYNs dropped"
+          "  accepts/s\n";
+
+  struct Scenario
+  {
+    uint64_t flood_per_second;
+    size_t syn_backlog;
+    bool syn_cookies;
+  };
+  for ( const auto& [flood, backlog, cookies] : { Scenario { 0, TCPStack::DEFAULT_BACKLOG, false },
+                                                  Scenario { 100, TCPStack::DEFAULT_BACKLOG, false },
+                                                  Scenario { 1000, TCPStack::DEFAULT_BACKLOG, false },
+                                                  Scenario { 1000, 4096, false },
+                                                  Scenario { 1000, TCPStack::DEFAULT_BACKLOG, true } } ) {
+    const auto result = run( flood, backlog, cookies );
+    cout << setw( 15 ) << flood << setw( 13 ) << backlog << setw( 9 ) << ( cookies ? "yes" : "no" ) << setw( 10 )
+         << result.latencies_ms.size() << setw( 10 )
+         << percentile( result, 0.5 ) << setw( 10 ) << percentile( result, 0.99 ) << setw( 16 )
+         << result.most_half_open << setw( 14 ) << result.syn_drops << setw( 11 ) << fixed << setprecision( 0 )
+         << result.accepts_per_second << "\n";
+    debug_output << "             " << flood << " spoofed SYN/s, SYN backlog " << backlog
+                 << ( cookies ? " with" : " without" ) << " cookies: p99 handshake "
+                 << percentile( result, 0.99 ) << " ms, " << fixed << setprecision( 0 ) << result.accepts_per_second
+                 << " accepts/s\n";
+
+    if ( ( flood == 0 or cookies ) and result.latencies_ms.size() != result.attempts ) {
+      throw runtime_error( "not every connection was accepted" );
+    }
+  }
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
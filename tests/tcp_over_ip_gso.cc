@@ -0,0 +1,147 @@
+#include "checksum.hh"
+#include "parser.hh"
+#include "tcp_config.hh"
+#include "tcp_over_ip.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+constexpr size_t MSS = TCPConfig::MAX_PAYLOAD_SIZE;
+
+string concat( const vector<string>& buffers )
+{
+  string ret;
+  for ( const auto& b : buffers ) {
+    ret += b;
+  }
+  return ret;
+}
+
+string random_payload( size_t len )
+{
+  default_random_engine rd { 1370 };
+  uniform_int_distribution<char> ud;
+  string ret;
+  for ( size_t i = 0; i < len; ++i ) {
+    ret += ud( rd );
+  }
+  return ret;
+}
+
+// An adapter from 10.0.0.1:1234 to 10.0.0.2:5678, or the other way round
+TCPOverIPv4Adapter make_adapter( bool reverse )
+{
+  TCPOverIPv4Adapter adapter;
+  const Address a { "10.0.0.1", 1234 };
+  const Address b { "10.0.0.2", 5678 };
+  adapter.config_mut().source = reverse ? b : a;
+  adapter.config_mut().destination = reverse ? a : b;
+  return adapter;
+}
+
+// Wrap `msg`, and check that every datagram is byte-for-byte what wrapping its share of the payload alone would
+// give, and that the far end parses the datagrams back into the original message
+void check_split( const TCPMessage& msg )
+{
+  auto adapter = make_adapter( false );
+  auto far_end = make_adapter( true );
+  const auto datagrams = adapter.wrap_tcp_in_ip( msg );
+
+  const size_t payload_size = msg.sender.payload.size();
+  const size_t expected_count = payload_size <= MSS ? 1 : ( payload_size + MSS - 1 ) / MSS;
+  if ( datagrams.size() != expected_count ) {
+    throw runtime_error( "expected " + to_string( expected_count ) + " datagrams, got "
+                         + to_string( datagrams.size() ) );
+  }
+
+  string payload;
+  Wrap32 next_seqno = msg.sender.seqno;
+  for ( size_t i = 0; i < datagrams.size(); ++i ) {
+    const bool first = i == 0;
+    const bool last = i + 1 == datagrams.size();
+
+    TCPMessage expected { msg.sender, msg.receiver };
+    expected.sender.seqno = next_seqno;
+    expected.sender.SYN = first and msg.sender.SYN;
+    expected.sender.FIN = last and msg.sender.FIN;
+    expected.sender.payload = msg.sender.payload.substr( i * MSS, MSS );
+    const auto alone = adapter.wrap_tcp_in_ip( expected );
+    if ( alone.size() != 1 or concat( serialize( alone.front() ) ) != concat( serialize( datagrams[i] ) ) ) {
+      throw runtime_error( "datagram " + to_string( i ) + " differs from the same segment wrapped alone" );
+    }
+
+    InternetDatagram parsed_dgram;
+    if ( not parse( parsed_dgram, serialize( datagrams[i] ) ) ) {
+      throw runtime_error( "datagram " + to_string( i ) + " has a bad IP header" );
+    }
+    const auto parsed = far_end.unwrap_tcp_in_ip( parsed_dgram );
+    if ( not parsed.has_value() ) {
+      throw runtime_error( "datagram " + to_string( i ) + " has a bad TCP segment" );
+    }
+    if ( not( parsed->sender.seqno == next_seqno ) or parsed->sender.SYN != expected.sender.SYN
+         or parsed->sender.FIN != expected.sender.FIN or parsed->receiver.ackno != msg.receiver.ackno
+         or parsed->receiver.sack_blocks.size() != msg.receiver.sack_blocks.size() ) {
+      throw runtime_error( "segment " + to_string( i ) + " has the wrong header" );
+    }
+
+    payload += parsed->sender.payload;
+    next_seqno = next_seqno + parsed->sender.sequence_length();
+  }
+
+  if ( payload != msg.sender.payload ) {
+    throw runtime_error( "the segments don't add up to the original payload" );
+  }
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    const string data = random_payload( TCPConfig::MAX_GSO_PAYLOAD_SIZE );
+
+    // an ordinary segment is wrapped as before
+    check_split( { { Wrap32 { 1000 }, false, data.substr( 0, MSS ), false, false }, { Wrap32 { 5 }, 2000 } } );
+
+    // a super-segment with an exact multiple of the MSS, and one with a short tail
+    check_split( { { Wrap32 { 1000 }, false, data, false, false }, { Wrap32 { 5 }, 2000 } } );
+    check_split(
+      { { Wrap32 { 1000 }, false, data.substr( 0, 10 * MSS + 7 ), false, false }, { Wrap32 { 5 }, 2000 } } );
+
+    // SYN on the first segment (with its option), FIN on the last
+    check_split( { { Wrap32 { 1000 }, true, data.substr( 0, 3 * MSS + 1 ), true, false, true }, {} } );
+
+    // sequence numbers wrapping around in the middle, and SACK blocks repeated on every segment
+    TCPMessage wrapping { { Wrap32 { UINT32_MAX - 2500 }, false, data.substr( 0, 5 * MSS ), true, false }, {} };
+    wrapping.receiver.ackno = Wrap32 { 77 };
+    wrapping.receiver.window_size = 4096;
+    wrapping.receiver.sack_blocks = { { Wrap32 { 100 }, Wrap32 { 200 } }, { Wrap32 { 300 }, Wrap32 { 400 } } };
+    check_split( wrapping );
+
+    // the RFC 1624 update gives the checksum computed from scratch
+    const uint16_t before = 0x1234;
+    const uint16_t after = 0xfedc;
+    InternetChecksum whole;
+    whole.add( string { "\x12\x34\xab\xcd", 4 } );
+    InternetChecksum changed;
+    changed.add( string { "\xfe\xdc\xab\xcd", 4 } );
+    if ( InternetChecksum::patch( whole.value(), before, after ) != changed.value() ) {
+      throw runtime_error( "incremental checksum update disagrees with the full computation" );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
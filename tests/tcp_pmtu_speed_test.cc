@@ -0,0 +1,191 @@
+#include "congestion_controller.hh"
+#include "emulated_link.hh"
+#include "tcp_config.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_receiver.hh"
+#include "tcp_sender.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+constexpr uint64_t GIVE_UP_MS = 60 * 1000;    // simulated time limit for one transfer
+constexpr double BYTES_PER_MS = 1.25e6;       // a 10 Gbit/s LAN
+constexpr uint64_t JUMBO_MTU = 9000;          // the interface's MTU
+constexpr uint64_t ETHERNET_MTU = 1500;       // a path with a smaller MTU somewhere along it
+constexpr uint64_t RECEIVE_CAPACITY = 1 << 20;
+
+struct Result
+{
+  bool finished;
+  uint64_t duration_ms;
+  uint64_t segment_size;
+  uint64_t datagrams;
+  uint64_t oversize_drops;
+  double gigabits_per_second; // wall-clock processing rate of both ends
+};
+
+string generate_data( const size_t len, const size_t random_seed )
+{
+  default_random_engine rd { random_seed };
+  uniform_int_distribution<char> ud;
+  string ret;
+  for ( size_t i = 0; i < len; ++i ) {
+    ret += ud( rd );
+  }
+  return ret;
+}
+
+// Send `data` as IPv4 datagrams from an interface with the given MTU across a path with `path_mtu` (which drops
+// anything larger without a word), and check that it arrives
+Result transfer( const string& data, const uint64_t mtu, const uint64_t path_mtu, const bool path_mtu_discovery )
+{
+  TCPConfig config;
+  config.mtu = mtu;
+  config.path_mtu_discovery = path_mtu_discovery;
+
+  TCPSender sender { ByteStream { RECEIVE_CAPACITY },
+                     config.isn,
+                     config.rt_timeout,
+                     make_congestion_controller( CongestionControl::NewReno, config.mss() ),
+                     TCPSender::RTOBounds { TCPConfig::RTO_MIN_DFLT, TCPConfig::RTO_MAX_DFLT },
+                     { config.mss(), false, config.path_mtu_discovery } };
+  TCPReceiver receiver { Reassembler { ByteStream { RECEIVE_CAPACITY } } };
+
+  TCPOverIPv4Adapter adapter;
+  adapter.config_mut().source = Address { "10.0.0.1", 1234 };
+  adapter.config_mut().destination = Address { "10.0.0.2", 5678 };
+  TCPOverIPv4Adapter far_end;
+  far_end.config_mut().source = adapter.config().destination;
+  far_end.config_mut().destination = adapter.config().source;
+
+  EmulatedLink<InternetDatagram> forward {
+    { .bytes_per_ms = BYTES_PER_MS, .delay_ms = 1, .queue_limit = UINT64_MAX, .mtu = path_mtu }, 1370 };
+  EmulatedLink<TCPReceiverMessage> reverse {
+    { .bytes_per_ms = BYTES_PER_MS, .delay_ms = 1, .queue_limit = UINT64_MAX }, 1370 };
+
+  uint64_t now = 0;
+  const auto transmit = [&]( const TCPSenderMessage& msg ) {
+    for ( auto& dgram : adapter.wrap_tcp_in_ip( { msg, {} } ) ) {
+      const uint64_t size = dgram.header.len;
+      forward.send( dgram, size, now );
+    }
+  };
+
+  string received;
+  received.reserve( data.size() );
+  uint64_t written = 0;
+
+  const auto start_time = steady_clock::now();
+  for ( ; not receiver.reader().is_finished() and now <= GIVE_UP_MS; ++now ) {
+    for ( const auto& dgram : forward.deliver( now ) ) {
+      auto msg = far_end.unwrap_tcp_in_ip( dgram );
+      if ( not msg.has_value() ) {
+        throw runtime_error( "the far end couldn't parse a datagram" );
+      }
+      receiver.receive( move( msg->sender ) );
+      reverse.send( receiver.send(), TCPConfig::HEADERS_SIZE, now );
+    }
+    while ( receiver.reader().bytes_buffered() ) {
+      received += receiver.reader().peek();
+      receiver.reader().pop( received.size() - receiver.reader().bytes_popped() );
+    }
+
+    for ( const auto& ack : reverse.deliver( now ) ) {
+      sender.receive( ack );
+    }
+
+    const uint64_t room = min( sender.writer().available_capacity(), data.size() - written );
+    sender.writer().push( data.substr( written, room ) );
+    written += room;
+    if ( written == data.size() and not sender.writer().is_closed() ) {
+      sender.writer().close();
+    }
+
+    sender.push( transmit );
+    sender.tick( 1, transmit );
+  }
+  const auto stop_time = steady_clock::now();
+
+  const bool finished = receiver.reader().is_finished();
+  if ( received != data.substr( 0, received.size() ) or ( finished and received.size() != data.size() ) ) {
+    throw runtime_error( "Mismatch between data sent and received" );
+  }
+
+  const auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  return { finished,
+           now,
+           sender.segment_size(),
+           forward.stats().messages_sent,
+           forward.stats().oversize_drops,
+           static_cast<double>( received.size() ) * 8 / test_duration.count() / 1e9 };
+}
+
+void program_body()
+{
+  const string data = generate_data( 32 << 20, 1370 );
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "Transfer of " << data.size() << " bytes over a 10 Gbit/s link with 2 ms RTT:\n";
+  cout << "    MTU  path MTU  PLPMTUD  segment size  datagrams  too big  simulated time (ms)  Gbit/s\n";
+
+  struct Scenario
+  {
+    uint64_t mtu;
+    uint64_t path_mtu;
+    bool path_mtu_discovery;
+  };
+  for ( const auto& [mtu, path_mtu, plpmtud] : { Scenario { TCPConfig::DEFAULT_MTU, JUMBO_MTU, false },
+                                                 Scenario { JUMBO_MTU, JUMBO_MTU, false },
+                                                 Scenario { JUMBO_MTU, JUMBO_MTU, true },
+                                                 Scenario { JUMBO_MTU, ETHERNET_MTU, false },
+                                                 Scenario { JUMBO_MTU, ETHERNET_MTU, true } } ) {
+    const auto result = transfer( data, mtu, path_mtu, plpmtud );
+    cout << setw( 7 ) << mtu << setw( 10 ) << path_mtu << setw( 9 ) << ( plpmtud ? "yes" : "no" ) << setw( 14 )
+         << result.segment_size << setw( 11 ) << result.datagrams << setw( 9 ) << result.oversize_drops;
+    if ( not result.finished ) {
+      cout << "  gave up after " << GIVE_UP_MS / 1000 << " s of simulated time\n";
+      if ( plpmtud ) {
+        throw runtime_error( "path MTU discovery didn't get the transfer through" );
+      }
+      continue;
+    }
+    cout << setw( 21 ) << result.duration_ms << setw( 8 ) << fixed << setprecision( 2 )
+         << result.gigabits_per_second << "\n";
+    debug_output << "             MTU " << mtu << ", path MTU " << path_mtu << ( plpmtud ? " with" : " without" )
+                 << " PLPMTUD: " << fixed << setprecision( 2 ) << result.gigabits_per_second << " Gbit/s\n";
+
+    const bool jumbo_path = mtu == JUMBO_MTU and path_mtu == JUMBO_MTU;
+    if ( jumbo_path and result.segment_size != JUMBO_MTU - TCPConfig::HEADERS_SIZE ) {
+      throw runtime_error( "segments didn't grow to fill the jumbo frames" );
+    }
+  }
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,135 @@
+#include "emulated_link.hh"
+#include "tcp_config.hh"
+#include "tcp_peer.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+namespace {
+
+constexpr uint64_t MAX_RECEIVE_BUFFER = 16 << 20;
+constexpr uint64_t BYTES_PER_MS = 12500; // 100 Mbit/s
+constexpr uint64_t DELAY_MS = 20;
+constexpr uint64_t BDP = BYTES_PER_MS * 2 * DELAY_MS; // 500 kB
+constexpr uint64_t GIVE_UP_MS = 60 * 1000;            // simulated time limit for one transfer
+
+struct Result
+{
+  uint64_t duration_ms;
+  uint64_t receive_buffer;
+};
+
+// Send `data` from one TCPPeer to another across a 100 Mbit/s path with a 40 ms RTT, to a receiver that autotunes
+// its buffer up to 16 MB and whose application reads at most `read_rate` bytes per ms, and check that it arrives
+Result transfer( const string& data, const uint64_t read_rate )
+{
+  TCPConfig client_config;
+  client_config.send_capacity = MAX_RECEIVE_BUFFER;
+  TCPConfig server_config;
+  server_config.isn = Wrap32 { 1370 };
+  server_config.recv_capacity = MAX_RECEIVE_BUFFER;
+  server_config.recv_autotuning = true;
+  TCPPeer client { client_config };
+  TCPPeer server { server_config };
+
+  const EmulatedLink<TCPMessage>::Config path {
+    .bytes_per_ms = BYTES_PER_MS, .delay_ms = DELAY_MS, .queue_limit = UINT64_MAX };
+  EmulatedLink<TCPMessage> to_server { path, 1370 };
+  EmulatedLink<TCPMessage> to_client { path, 1370 };
+
+  uint64_t now = 0;
+  const auto send_to_server = [&]( const TCPMessage& msg ) {
+    to_server.send( msg, msg.sender.payload.size() + TCPConfig::HEADERS_SIZE, now );
+  };
+  const auto send_to_client = [&]( const TCPMessage& msg ) {
+    to_client.send( msg, msg.sender.payload.size() + TCPConfig::HEADERS_SIZE, now );
+  };
+
+  string received;
+  received.reserve( data.size() );
+  uint64_t written = 0;
+
+  for ( ; not server.inbound_reader().is_finished(); ++now ) {
+    if ( now > GIVE_UP_MS ) {
+      throw runtime_error( "gave up after " + to_string( GIVE_UP_MS / 1000 ) + " s of simulated time" );
+    }
+
+    for ( auto& msg : to_server.deliver( now ) ) {
+      server.receive( move( msg ), send_to_client );
+    }
+    for ( auto& msg : to_client.deliver( now ) ) {
+      client.receive( move( msg ), send_to_server );
+    }
+    const uint64_t read_limit = received.size() + read_rate;
+    while ( server.inbound_reader().bytes_buffered() and received.size() < read_limit ) {
+      received += server.inbound_reader().peek().substr( 0, read_limit - received.size() );
+      server.inbound_reader().pop( received.size() - server.inbound_reader().bytes_popped() );
+    }
+
+    const uint64_t room = min( client.outbound_writer().available_capacity(), data.size() - written );
+    client.outbound_writer().push( data.substr( written, room ) );
+    written += room;
+    if ( written == data.size() and not client.outbound_writer().is_closed() ) {
+      client.outbound_writer().close();
+    }
+
+    client.push( send_to_server );
+    client.tick( 1, send_to_server );
+    server.tick( 1, send_to_client );
+  }
+
+  if ( received != data ) {
+    throw runtime_error( "Mismatch between data sent and received" );
+  }
+  return { now, server.receiver().capacity() };
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    const string data = [] {
+      default_random_engine rd { 1370 };
+      uniform_int_distribution<char> ud;
+      string ret;
+      for ( size_t i = 0; i < 8 << 20; ++i ) {
+        ret += ud( rd );
+      }
+      return ret;
+    }();
+
+    // an application that reads faster than the path delivers: the buffer grows past the bandwidth-delay
+    // product, but not all the way to the maximum
+    const auto fast = transfer( data, 10 * BYTES_PER_MS );
+    if ( fast.receive_buffer < BDP or fast.receive_buffer > 4 * BDP ) {
+      throw runtime_error( "a fast reader's buffer grew to " + to_string( fast.receive_buffer )
+                           + " bytes, for a bandwidth-delay product of " + to_string( BDP ) );
+    }
+
+    // an application that reads at a tenth of the path's rate doesn't need a buffer that large
+    const auto slow = transfer( data.substr( 0, 1 << 20 ), BYTES_PER_MS / 10 );
+    if ( slow.receive_buffer > BDP / 2 ) {
+      throw runtime_error( "a slow reader's buffer grew to " + to_string( slow.receive_buffer ) + " bytes" );
+    }
+
+    cout << "8 MB to a fast reader: " << fast.duration_ms << " ms, with a " << fast.receive_buffer
+         << "-byte receive buffer\n";
+    cout << "1 MB to a slow reader: " << slow.duration_ms << " ms, with a " << slow.receive_buffer
+         << "-byte receive buffer\n";
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,165 @@
+#include "emulated_link.hh"
+#include "tcp_config.hh"
+#include "tcp_receiver.hh"
+#include "tcp_sender.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+namespace {
+
+constexpr uint64_t HEADER_SIZE = 40;            // IPv4 + TCP headers, for the link's accounting
+constexpr uint64_t GIVE_UP_MS = 10 * 60 * 1000; // simulated time limit for one transfer
+constexpr uint64_t BURST_PERIOD = 500;          // segments between the starts of two loss bursts
+
+struct Result
+{
+  bool finished;
+  uint64_t duration_ms;
+  uint64_t fast_retransmissions;
+  uint64_t timeout_retransmissions;
+  uint64_t retransmitted_bytes;
+};
+
+string generate_data( const size_t len, const size_t random_seed )
+{
+  default_random_engine rd { random_seed };
+  uniform_int_distribution<char> ud;
+  string ret;
+  for ( size_t i = 0; i < len; ++i ) {
+    ret += ud( rd );
+  }
+  return ret;
+}
+
+// Send `data` across a 10 Mbit/s, 20 ms RTT link with a deep queue, where every BURST_PERIOD segments the next
+// `burst` in a row are lost, and check that it arrives. Without `sack`, the receiver's SACK blocks are dropped on
+// the way back, as if it didn't support them.
+Result transfer( const string& data, const CongestionControl kind, const uint64_t burst, const bool sack )
+{
+  const Wrap32 isn { 1370 };
+  TCPSender sender { ByteStream { TCPConfig::DEFAULT_CAPACITY },
+                     isn,
+                     TCPConfig::TIMEOUT_DFLT,
+                     make_congestion_controller( kind, TCPConfig::MAX_PAYLOAD_SIZE ),
+                     TCPSender::RTOBounds { TCPConfig::RTO_MIN_DFLT, TCPConfig::RTO_MAX_DFLT } };
+  TCPReceiver receiver { Reassembler { ByteStream { TCPConfig::DEFAULT_CAPACITY } } };
+
+  EmulatedLink<TCPSenderMessage> forward { { .bytes_per_ms = 1250, .delay_ms = 10, .queue_limit = 100000 }, 1370 };
+  EmulatedLink<TCPReceiverMessage> reverse { { .bytes_per_ms = 1250, .delay_ms = 10, .queue_limit = UINT64_MAX },
+                                             1370 };
+
+  uint64_t now = 0;
+  uint64_t segments_sent = 0;
+  uint64_t highest_sent = 0;
+  uint64_t retransmitted_bytes = 0;
+  const auto transmit = [&]( const TCPSenderMessage& msg ) {
+    const uint64_t seqno = msg.seqno.unwrap( isn, highest_sent );
+    if ( seqno < highest_sent ) {
+      retransmitted_bytes += msg.payload.size();
+    }
+    highest_sent = max( highest_sent, seqno + msg.sequence_length() );
+    if ( ( segments_sent++ % BURST_PERIOD ) >= BURST_PERIOD - burst ) {
+      return;
+    }
+    forward.send( msg, msg.payload.size() + HEADER_SIZE, now );
+  };
+
+  string received;
+  received.reserve( data.size() );
+  uint64_t written = 0;
+
+  for ( ; not receiver.reader().is_finished(); ++now ) {
+    if ( now > GIVE_UP_MS ) {
+      break;
+    }
+
+    for ( auto& msg : forward.deliver( now ) ) {
+      receiver.receive( move( msg ) );
+      auto ack = receiver.send();
+      if ( not sack ) {
+        ack.sack_blocks.clear();
+      }
+      reverse.send( ack, HEADER_SIZE, now );
+    }
+    while ( receiver.reader().bytes_buffered() ) {
+      received += receiver.reader().peek();
+      receiver.reader().pop( received.size() - receiver.reader().bytes_popped() );
+    }
+
+    for ( const auto& ack : reverse.deliver( now ) ) {
+      sender.receive( ack );
+    }
+
+    const uint64_t room = min( sender.writer().available_capacity(), data.size() - written );
+    sender.writer().push( data.substr( written, room ) );
+    written += room;
+    if ( written == data.size() and not sender.writer().is_closed() ) {
+      sender.writer().close();
+    }
+
+    sender.push( transmit );
+    sender.tick( 1, transmit );
+  }
+
+  const bool finished = receiver.reader().is_finished();
+  if ( received != data.substr( 0, received.size() ) or ( finished and received.size() != data.size() ) ) {
+    throw runtime_error( "Mismatch between data sent and received" );
+  }
+
+  return { finished,
+           now,
+           sender.fast_retransmissions(),
+           sender.timeout_retransmissions(),
+           retransmitted_bytes };
+}
+
+void program_body()
+{
+  const string data = generate_data( 4 << 20, 1370 );
+
+  cout << "Transfer of " << data.size() << " bytes over a 10 Mbit/s link with 20 ms RTT, losing a burst of"
+       << " segments out of every " << BURST_PERIOD << ":\n";
+  cout << "  burst  controller  SACK  goodput (Mbit/s)  fast retx  timeout retx  retransmitted bytes\n";
+
+  for ( const uint64_t burst : { 1, 2, 4, 8 } ) {
+    for ( const auto kind : { CongestionControl::NewReno, CongestionControl::Cubic } ) {
+      for ( const bool sack : { false, true } ) {
+        const auto controller = make_congestion_controller( kind, TCPConfig::MAX_PAYLOAD_SIZE );
+        const auto result = transfer( data, kind, burst, sack );
+        const double goodput
+          = static_cast<double>( data.size() ) * 8 / static_cast<double>( result.duration_ms ) / 1e3;
+
+        cout << setw( 7 ) << burst << "  " << left << setw( 10 ) << controller->name() << right << setw( 6 )
+             << ( sack ? "yes" : "no" );
+        if ( not result.finished ) {
+          cout << "  gave up after " << GIVE_UP_MS / 1000 << " s of simulated time\n";
+          continue;
+        }
+        cout << setw( 18 ) << fixed << setprecision( 2 ) << goodput << setw( 11 ) << result.fast_retransmissions
+             << setw( 14 ) << result.timeout_retransmissions << setw( 21 ) << result.retransmitted_bytes << "\n";
+      }
+    }
+  }
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,188 @@
+#include "checksum.hh"
+#include "parser.hh"
+#include "tcp_segment.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+constexpr uint32_t PSEUDO_CHECKSUM = 0x1370;
+
+string concat( const vector<string>& buffers )
+{
+  string ret;
+  for ( const auto& b : buffers ) {
+    ret += b;
+  }
+  return ret;
+}
+
+// Serialize (with a valid checksum) and parse back
+TCPSegment round_trip( TCPSegment seg, size_t expected_header_length )
+{
+  seg.compute_checksum( PSEUDO_CHECKSUM );
+  const auto wire = serialize( seg );
+  const string bytes = concat( wire );
+  if ( bytes.size() != expected_header_length + seg.message.sender.payload.size() ) {
+    throw runtime_error( "serialized segment has " + to_string( bytes.size() ) + " bytes, expected "
+                         + to_string( expected_header_length + seg.message.sender.payload.size() ) );
+  }
+
+  TCPSegment parsed;
+  if ( not parse( parsed, wire, PSEUDO_CHECKSUM ) ) {
+    throw runtime_error( "failed to parse a serialized segment" );
+  }
+  return parsed;
+}
+
+void expect_blocks( const TCPSegment& seg, const vector<pair<uint32_t, uint32_t>>& expected )
+{
+  const auto& blocks = seg.message.receiver.sack_blocks;
+  bool same = blocks.size() == expected.size();
+  for ( size_t i = 0; same and i < blocks.size(); ++i ) {
+    same = blocks[i].begin == Wrap32 { expected[i].first } and blocks[i].end == Wrap32 { expected[i].second };
+  }
+  if ( not same ) {
+    throw runtime_error( "parsed " + to_string( blocks.size() ) + " SACK blocks, not the expected "
+                         + to_string( expected.size() ) );
+  }
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    {
+      // SACK-permitted travels on the SYN only
+      TCPSegment syn;
+      syn.message.sender = { Wrap32 { 1000 }, true, "", false, false, true };
+      const auto parsed = round_trip( syn, 24 );
+      if ( not parsed.message.sender.SYN or not parsed.message.sender.SACK_permitted ) {
+        throw runtime_error( "SACK-permitted was lost" );
+      }
+
+      TCPSegment data;
+      data.message.sender = { Wrap32 { 1000 }, false, "hello", false, false, true };
+      if ( round_trip( data, 20 ).message.sender.SACK_permitted ) {
+        throw runtime_error( "SACK-permitted was sent without a SYN" );
+      }
+    }
+
+    {
+      // so does the MSS option, which comes first
+      TCPSegment syn;
+      syn.message.sender = { Wrap32 { 1000 }, true, "", false, false, true, 8960 };
+      const auto parsed = round_trip( syn, 28 );
+      if ( parsed.message.sender.MSS != 8960 or not parsed.message.sender.SACK_permitted ) {
+        throw runtime_error( "MSS option was lost" );
+      }
+
+      TCPSegment data;
+      data.message.sender = { Wrap32 { 1000 }, false, "hello", false, false, false, 8960 };
+      if ( round_trip( data, 20 ).message.sender.MSS != 0 ) {
+        throw runtime_error( "MSS option was sent without a SYN" );
+      }
+    }
+
+    {
+      // and the window scale, after a NOP
+      TCPSegment syn;
+      syn.message.sender = { Wrap32 { 1000 }, true, "", false, false, true, 8960, 9 };
+      const auto parsed = round_trip( syn, 32 );
+      if ( parsed.message.sender.window_scale != uint8_t { 9 } or parsed.message.sender.MSS != 8960 ) {
+        throw runtime_error( "window scale option was lost" );
+      }
+
+      TCPSegment data;
+      data.message.sender = { Wrap32 { 1000 }, false, "hello", false, false, false, 0, 9 };
+      if ( round_trip( data, 20 ).message.sender.window_scale.has_value() ) {
+        throw runtime_error( "window scale option was sent without a SYN" );
+      }
+    }
+
+    {
+      TCPSegment ack;
+      ack.message.sender.payload = "payload";
+      ack.message.receiver.ackno = Wrap32 { 50 };
+      ack.message.receiver.window_size = 1000;
+      ack.message.receiver.sack_blocks
+        = { { Wrap32 { 60 }, Wrap32 { 70 } }, { Wrap32 { UINT32_MAX }, Wrap32 { 5 } } };
+      const auto parsed = round_trip( ack, 20 + 4 + 16 );
+      expect_blocks( parsed, { { 60, 70 }, { UINT32_MAX, 5 } } );
+      if ( parsed.message.sender.payload != "payload" or parsed.message.receiver.ackno != Wrap32 { 50 } ) {
+        throw runtime_error( "SACK option corrupted the rest of the segment" );
+      }
+
+      // only four blocks fit in the header
+      for ( uint32_t i = 0; i < 3; ++i ) {
+        ack.message.receiver.sack_blocks.push_back( { Wrap32 { 100 + 10 * i }, Wrap32 { 105 + 10 * i } } );
+      }
+      expect_blocks( round_trip( ack, 20 + 4 + 32 ),
+                     { { 60, 70 }, { UINT32_MAX, 5 }, { 100, 105 }, { 110, 115 } } );
+    }
+
+    {
+      // the MSS and window scale options are kept, and others (here timestamps) are skipped
+      Serializer s;
+      s.integer( uint16_t { 1 } );       // source port
+      s.integer( uint16_t { 2 } );       // destination port
+      s.integer( uint32_t { 3 } );       // seqno
+      s.integer( uint32_t { 4 } );       // ackno
+      s.integer( uint8_t { 13 << 4 } );  // data offset: 32 bytes of options
+      s.integer( uint8_t { 0b10000 } );  // ACK
+      s.integer( uint16_t { 5 } );       // window
+      s.integer( uint16_t { 0 } );       // checksum, filled in below
+      s.integer( uint16_t { 0 } );       // urgent pointer
+      s.integer( uint32_t { 0x0204'05b4 } );
+      s.integer( uint32_t { 0x0103'0307 } );
+      s.integer( uint32_t { 0x0101'080a } );
+      s.integer( uint32_t { 11 } );
+      s.integer( uint32_t { 12 } );
+      s.integer( uint32_t { 0x0101'050a } );
+      s.integer( uint32_t { 8 } );
+      s.integer( uint32_t { 9 } );
+      s.integer( uint8_t { 'x' } );
+      string bytes = concat( s.output() );
+
+      InternetChecksum check { PSEUDO_CHECKSUM };
+      check.add( bytes );
+      bytes[16] = static_cast<char>( check.value() >> 8 );
+      bytes[17] = static_cast<char>( check.value() & 0xff );
+
+      TCPSegment parsed;
+      if ( not parse( parsed, { bytes }, PSEUDO_CHECKSUM ) ) {
+        throw runtime_error( "failed to parse a segment with unknown options" );
+      }
+      expect_blocks( parsed, { { 8, 9 } } );
+      if ( parsed.message.sender.payload != "x" or parsed.message.receiver.window_size != 5
+           or parsed.message.sender.MSS != 1460 or parsed.message.sender.window_scale != uint8_t { 7 } ) {
+        throw runtime_error( "unknown options corrupted the segment" );
+      }
+
+      // an option running past the header is an error
+      bytes[20 + 1] = 40;
+      check = InternetChecksum { PSEUDO_CHECKSUM };
+      bytes[16] = bytes[17] = 0;
+      check.add( bytes );
+      bytes[16] = static_cast<char>( check.value() >> 8 );
+      bytes[17] = static_cast<char>( check.value() & 0xff );
+      if ( parse( parsed, { bytes }, PSEUDO_CHECKSUM ) ) {
+        throw runtime_error( "parsed a segment with a malformed option" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,338 @@
+#include "exception.hh"
+#include "parser.hh"
+#include "tcp_config.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_stack.hh"
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+void expect( const bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( what );
+  }
+}
+
+// Queues the datagrams a stack sends, serialized and parsed again on the way
+class Wire : public TCPStack::OutputPort
+{
+public:
+  queue<InternetDatagram> datagrams {};
+
+  void transmit( const TCPStack& sender [[maybe_unused]], const InternetDatagram& dgram ) override
+  {
+    InternetDatagram parsed;
+    if ( not parse( parsed, serialize( dgram ) ) ) {
+      throw runtime_error( "a datagram didn't parse" );
+    }
+    datagrams.push( move( parsed ) );
+  }
+};
+
+const Address CLIENT_ADDRESS { "10.0.0.1" };
+const Address SERVER_ADDRESS { "10.0.0.2", 80 };
+constexpr size_t CONNECTIONS = 2000;
+
+// A client stack and a server stack, wired back to back
+struct Network
+{
+  shared_ptr<Wire> to_server = make_shared<Wire>();
+  shared_ptr<Wire> to_client = make_shared<Wire>();
+  TCPStack client { to_server, CLIENT_ADDRESS };
+  TCPStack server { to_client, SERVER_ADDRESS };
+
+  // Deliver datagrams until there are none left
+  void deliver()
+  {
+    while ( not to_server->datagrams.empty() or not to_client->datagrams.empty() ) {
+      for ( ; not to_server->datagrams.empty(); to_server->datagrams.pop() ) {
+        server.receive( to_server->datagrams.front() );
+      }
+      for ( ; not to_client->datagrams.empty(); to_client->datagrams.pop() ) {
+        client.receive( to_client->datagrams.front() );
+      }
+    }
+  }
+
+  // Let time pass until both stacks have forgotten every connection
+  void wait_for_close()
+  {
+    for ( size_t i = 0; i < 1000 and ( client.connection_count() or server.connection_count() ); ++i ) {
+      client.tick( TCPConfig::TIMEOUT_DFLT );
+      server.tick( TCPConfig::TIMEOUT_DFLT );
+      deliver();
+    }
+    expect( client.connection_count() == 0 and server.connection_count() == 0, "connections weren't forgotten" );
+  }
+};
+
+string read_all( TCPPeer& peer )
+{
+  string ret;
+  while ( peer.inbound_reader().bytes_buffered() ) {
+    ret += peer.inbound_reader().peek();
+    peer.inbound_reader().pop( ret.size() - peer.inbound_reader().bytes_popped() );
+  }
+  return ret;
+}
+
+void many_connections()
+{
+  Network net;
+  net.server.listen( SERVER_ADDRESS.port(), {}, CONNECTIONS, CONNECTIONS );
+
+  // thousands of clients connect to the same server port, each from its own port
+  vector<TCPStack::ConnectionID> clients;
+  set<uint16_t> ports;
+  for ( size_t i = 0; i < CONNECTIONS; ++i ) {
+    clients.push_back( net.client.connect( SERVER_ADDRESS, {} ) );
+    ports.insert( net.client.tuple( clients.back() ).local_port );
+  }
+  expect( ports.size() == CONNECTIONS, "two connections share a port" );
+  net.deliver();
+  expect( net.server.connection_count() == CONNECTIONS, "the server doesn't have every connection" );
+  expect( net.server.accept_queue_length( SERVER_ADDRESS.port() ) == CONNECTIONS
+            and net.server.half_open_count( SERVER_ADDRESS.port() ) == 0,
+          "not every connection is waiting to be accepted" );
+
+  // every client says which one it is, and the server answers on the same connection
+  for ( size_t i = 0; i < CONNECTIONS; ++i ) {
+    net.client.peer( clients[i] ).outbound_writer().push( "client " + to_string( i ) );
+    net.client.push( clients[i] );
+  }
+  net.deliver();
+  while ( const auto id = net.server.accept( SERVER_ADDRESS.port() ) ) {
+    TCPPeer& peer = net.server.peer( *id );
+    const string request = read_all( peer );
+    expect( request.starts_with( "client " ), "the server got \"" + request + "\"" );
+    peer.outbound_writer().push( "hello, " + request );
+    net.server.close( *id );
+  }
+  net.deliver();
+  for ( size_t i = 0; i < CONNECTIONS; ++i ) {
+    const string reply = read_all( net.client.peer( clients[i] ) );
+    expect( reply == "hello, client " + to_string( i ), "client " + to_string( i ) + " got \"" + reply + "\"" );
+    expect( net.client.peer( clients[i] ).inbound_reader().is_finished(), "the server didn't close" );
+    net.client.close( clients[i] );
+  }
+  net.deliver();
+  net.wait_for_close();
+
+  // connection IDs are reused
+  const auto id = net.client.connect( SERVER_ADDRESS, {} );
+  expect( id < CONNECTIONS, "a new connection didn't reuse an ID" );
+  expect( net.client.contains( id ) and not net.client.contains( CONNECTIONS ), "contains()" );
+}
+
+void stray_segments()
+{
+  Network net;
+  net.server.listen( SERVER_ADDRESS.port(), {} );
+
+  // a connection's segments all find it
+  const auto real = net.client.connect( SERVER_ADDRESS, {} );
+  net.deliver();
+  expect( net.server.connection_count() == 1 and net.server.stats().unmatched_segments == 0, "a real connection" );
+
+  // a SYN to a port nobody listens on is dropped
+  const auto nobody = net.client.connect( Address { "10.0.0.2", 81 }, {} );
+  net.deliver();
+  expect( net.server.stats().unmatched_segments == 1 and net.server.connection_count() == 1, "port 81" );
+
+  // so is a segment without a SYN, even to the listening port
+  FourTuple tuple = net.client.tuple( real );
+  tuple.local_port = 1234;
+  for ( const auto& dgram : TCPOverIPv4Adapter::wrap_tcp_in_ip( { {}, { Wrap32 { 1 }, 1000 } }, tuple ) ) {
+    net.server.receive( dgram );
+  }
+  expect( net.server.stats().unmatched_segments == 2 and net.server.connection_count() == 1, "an ACK" );
+
+  // and a datagram for another address isn't even looked at
+  const auto elsewhere = net.client.connect( Address { "10.0.0.3", 80 }, {} );
+  net.deliver();
+  expect( net.server.stats().bad_datagrams == 1, "a datagram for 10.0.0.3 wasn't rejected" );
+
+  // the connection attempts that got no answer give up in the end
+  const auto accepted = net.server.accept( SERVER_ADDRESS.port() );
+  expect( accepted.has_value(), "the real connection wasn't accepted" );
+  net.server.close( *accepted );
+  for ( const auto id : { real, nobody, elsewhere } ) {
+    net.client.close( id );
+  }
+  net.deliver();
+  net.wait_for_close();
+}
+
+// A listener with small backlogs: SYNs beyond the first are dropped, and handshakes wait for accept()
+void backlogs()
+{
+  constexpr size_t SYN_BACKLOG = 4;
+  constexpr size_t ACCEPT_BACKLOG = 2;
+  const uint16_t port = SERVER_ADDRESS.port();
+  Network net;
+  net.server.listen( port, {}, SYN_BACKLOG, ACCEPT_BACKLOG );
+
+  // six SYNs arrive at once: four make half-open connections, and two are dropped
+  vector<TCPStack::ConnectionID> clients;
+  for ( size_t i = 0; i < 6; ++i ) {
+    clients.push_back( net.client.connect( SERVER_ADDRESS, {} ) );
+  }
+  for ( ; not net.to_server->datagrams.empty(); net.to_server->datagrams.pop() ) {
+    net.server.receive( net.to_server->datagrams.front() );
+  }
+  expect( net.server.half_open_count( port ) == SYN_BACKLOG, "the half-open table isn't full" );
+  expect( net.server.stats().syn_drops == 2 and net.server.connection_count() == SYN_BACKLOG, "SYNs dropped" );
+
+  // the four handshakes finish, but only two fit in the accept queue
+  net.deliver();
+  expect( net.server.accept_queue_length( port ) == ACCEPT_BACKLOG, "the accept queue isn't full" );
+  expect( net.server.half_open_count( port ) == SYN_BACKLOG - ACCEPT_BACKLOG, "finished handshakes left" );
+
+  // accepting makes room, and the next tick moves the waiting handshakes into the queue
+  set<TCPStack::ConnectionID> accepted;
+  while ( const auto id = net.server.accept( port ) ) {
+    accepted.insert( *id );
+  }
+  expect( not net.server.accept( port ).has_value() and accepted.size() == ACCEPT_BACKLOG, "accept()" );
+  net.server.tick( 1 );
+  expect( net.server.accept_queue_length( port ) == ACCEPT_BACKLOG, "the handshakes didn't move on" );
+  expect( net.server.half_open_count( port ) == 0, "a connection is still half-open" );
+  while ( const auto id = net.server.accept( port ) ) {
+    accepted.insert( *id );
+  }
+
+  // the dropped SYNs are retransmitted, and find room now
+  net.client.tick( TCPConfig::TIMEOUT_DFLT );
+  net.deliver();
+  while ( const auto id = net.server.accept( port ) ) {
+    accepted.insert( *id );
+  }
+  expect( accepted.size() == clients.size(), "only " + to_string( accepted.size() ) + " connections accepted" );
+
+  for ( const auto id : accepted ) {
+    net.server.close( id );
+  }
+  for ( const auto id : clients ) {
+    net.client.close( id );
+  }
+  net.deliver();
+  net.wait_for_close();
+}
+
+// With SYN cookies, SYNs that find the half-open table full still make connections
+void syn_cookies()
+{
+  const uint16_t port = SERVER_ADDRESS.port();
+  TCPConfig cfg;
+  cfg.syn_cookies = true;
+  Network net;
+  net.server.listen( port, cfg, 1 );
+
+  // one SYN makes a half-open connection; the others get cookies, and leave nothing behind
+  vector<TCPStack::ConnectionID> clients;
+  for ( size_t i = 0; i < 5; ++i ) {
+    clients.push_back( net.client.connect( SERVER_ADDRESS, {} ) );
+  }
+  for ( ; not net.to_server->datagrams.empty(); net.to_server->datagrams.pop() ) {
+    net.server.receive( net.to_server->datagrams.front() );
+  }
+  expect( net.server.connection_count() == 1 and net.server.half_open_count( port ) == 1, "state for a SYN" );
+  expect( net.server.stats().syn_cookies_sent == 4 and net.server.stats().syn_drops == 0, "cookies sent" );
+
+  // the handshakes' last ACKs bring the cookies back, and make the connections
+  net.deliver();
+  expect( net.server.stats().syn_cookies_valid == 4, "cookies that came back" );
+  expect( net.server.accept_queue_length( port ) == clients.size(), "not every connection was accepted" );
+
+  // which carry data both ways
+  for ( size_t i = 0; i < clients.size(); ++i ) {
+    net.client.peer( clients[i] ).outbound_writer().push( "client " + to_string( i ) );
+    net.client.push( clients[i] );
+  }
+  net.deliver();
+  while ( const auto id = net.server.accept( port ) ) {
+    TCPPeer& peer = net.server.peer( *id );
+    peer.outbound_writer().push( "hello, " + read_all( peer ) );
+    net.server.close( *id );
+  }
+  net.deliver();
+  for ( size_t i = 0; i < clients.size(); ++i ) {
+    const string reply = read_all( net.client.peer( clients[i] ) );
+    expect( reply == "hello, client " + to_string( i ), "client " + to_string( i ) + " got \"" + reply + "\"" );
+    net.client.close( clients[i] );
+  }
+
+  // an ACK with a cookie that the server didn't make is just a stray segment
+  FourTuple tuple = net.client.tuple( clients.front() );
+  tuple.local_port = 1234;
+  for ( const auto& dgram : TCPOverIPv4Adapter::wrap_tcp_in_ip( { {}, { Wrap32 { 1 }, 1000 } }, tuple ) ) {
+    net.server.receive( dgram );
+  }
+  expect( net.server.stats().syn_cookies_valid == 4 and net.server.stats().unmatched_segments == 1, "a forgery" );
+
+  net.deliver();
+  net.wait_for_close();
+}
+
+// Two TCPStackLoops on the ends of a datagram socket pair, run by turns in this thread
+void over_a_socket_pair()
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_DGRAM, 0, fds.data() ) );
+  TCPStackLoop client { FileDescriptor { fds[0] }, CLIENT_ADDRESS };
+  TCPStackLoop server { FileDescriptor { fds[1] }, SERVER_ADDRESS };
+  server.stack().listen( SERVER_ADDRESS.port(), {} );
+
+  const auto id = client.stack().connect( SERVER_ADDRESS, {} );
+  client.stack().peer( id ).outbound_writer().push( "hello over a socket pair" );
+  client.stack().close( id );
+
+  string received;
+  optional<TCPStack::ConnectionID> accepted;
+  for ( size_t i = 0; i < 1000 and received.size() < 24; ++i ) {
+    server.wait_next_event( 1 );
+    client.wait_next_event( 1 );
+    if ( not accepted.has_value() ) {
+      accepted = server.stack().accept( SERVER_ADDRESS.port() );
+    }
+    if ( accepted.has_value() ) {
+      received += read_all( server.stack().peer( *accepted ) );
+    }
+  }
+  expect( received == "hello over a socket pair", "the server got \"" + received + "\"" );
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    many_connections();
+    stray_segments();
+    backlogs();
+    syn_cookies();
+    over_a_socket_pair();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
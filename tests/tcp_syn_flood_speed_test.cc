@@ -0,0 +1,211 @@
+#include "emulated_link.hh"
+#include "tcp_config.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_stack.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+const Address CLIENT_ADDRESS { "10.0.0.1" };
+const Address SERVER_ADDRESS { "10.0.0.2", 80 };
+constexpr uint64_t FLOOD_PER_MS = 5;       // 5,000 spoofed SYNs a second
+constexpr uint64_t CONNECT_EVERY_MS = 100; // and a real client now and then
+constexpr uint64_t DURATION_MS = 5000;     // simulated time for one run
+constexpr uint64_t TICK_MS = 10;           // how often the stacks' timers run, as in a TCPMinnowSocket
+constexpr uint64_t SETTLE_MS = 1000;       // after which memory should stop growing, if it's going to
+constexpr size_t FLAT = 4 << 20;           // what "stop growing" means, in bytes
+
+// Hands every datagram a TCPStack sends to an EmulatedLink
+class LinkPort : public TCPStack::OutputPort
+{
+  EmulatedLink<InternetDatagram>& link_;
+  const uint64_t& now_;
+
+public:
+  LinkPort( EmulatedLink<InternetDatagram>& link, const uint64_t& now ) : link_( link ), now_( now ) {}
+
+  void transmit( const TCPStack& sender [[maybe_unused]], const InternetDatagram& dgram ) override
+  {
+    link_.send( dgram, dgram.header.len, now_ );
+  }
+};
+
+// The process's resident set size, in bytes
+size_t resident_bytes()
+{
+  ifstream statm { "/proc/self/statm" };
+  size_t size = 0;
+  size_t resident = 0;
+  statm >> size >> resident;
+  return resident * static_cast<size_t>( sysconf( _SC_PAGESIZE ) );
+}
+
+// A SYN from a random (spoofed) address, which will never answer the SYN-ACK
+vector<InternetDatagram> spoofed_syn( default_random_engine& rd )
+{
+  TCPMessage syn;
+  syn.sender.SYN = true;
+  syn.sender.seqno = Wrap32 { static_cast<uint32_t>( rd() ) };
+  syn.sender.MSS = 1460;
+  syn.receiver.window_size = UINT16_MAX;
+  const FourTuple tuple { .local_ip = 0xac100000 | ( static_cast<uint32_t>( rd() ) & 0xfffff ), // 172.16.0.0/12
+                          .remote_ip = SERVER_ADDRESS.ipv4_numeric(),
+                          .local_port = static_cast<uint16_t>( rd() ),
+                          .remote_port = SERVER_ADDRESS.port() };
+  return TCPOverIPv4Adapter::wrap_tcp_in_ip( syn, tuple );
+}
+
+struct Result
+{
+  uint64_t attempts;
+  uint64_t accepted;
+  size_t growth_after_settling; // bytes
+};
+
+// Flood a listener with spoofed SYNs, while real clients connect now and then, and print what the server
+// holds each second
+Result run( const size_t syn_backlog, const bool syn_cookies, fstream& debug_output )
+{
+  uint64_t now = 0;
+  const EmulatedLink<InternetDatagram>::Config path {
+    .bytes_per_ms = 1e9, .delay_ms = 0, .queue_limit = UINT64_MAX };
+  EmulatedLink<InternetDatagram> to_server { path, 1370 };
+  EmulatedLink<InternetDatagram> to_client { path, 1370 };
+  TCPStack client { make_shared<LinkPort>( to_server, now ), CLIENT_ADDRESS };
+  TCPStack server { make_shared<LinkPort>( to_client, now ), SERVER_ADDRESS };
+  // small buffers, so that an unbounded half-open table can grow for a while before memory runs out (and the
+  // real connections that linger for a while after they close take little)
+  TCPConfig client_config;
+  client_config.recv_capacity = 4096;
+  client_config.send_capacity = 4096;
+  TCPConfig server_config = client_config;
+  server_config.syn_cookies = syn_cookies;
+  server.listen( SERVER_ADDRESS.port(), server_config, syn_backlog );
+
+  default_random_engine rd { 1370 };
+  vector<TCPStack::ConnectionID> clients;
+  Result result { 0, 0, 0 };
+  const size_t start_bytes = resident_bytes();
+  size_t settled_bytes = start_bytes;
+
+  const auto start_time = steady_clock::now();
+  for ( ; now <= DURATION_MS; ++now ) {
+    if ( now % CONNECT_EVERY_MS == 0 and now < DURATION_MS ) {
+      clients.push_back( client.connect( SERVER_ADDRESS, client_config ) );
+      ++result.attempts;
+    }
+    for ( uint64_t i = 0; i < FLOOD_PER_MS; ++i ) {
+      for ( const auto& dgram : spoofed_syn( rd ) ) {
+        server.receive( dgram );
+      }
+    }
+
+    for ( const auto& dgram : to_server.deliver( now ) ) {
+      server.receive( dgram );
+    }
+    for ( const auto& dgram : to_client.deliver( now ) ) {
+      client.receive( dgram );
+    }
+
+    // the server hangs up on every connection it accepts, and the client hangs up after
+    while ( const auto id = server.accept( SERVER_ADDRESS.port() ) ) {
+      ++result.accepted;
+      server.close( *id );
+    }
+    erase_if( clients, [&]( const TCPStack::ConnectionID id ) {
+      if ( not client.peer( id ).inbound_reader().is_finished() ) {
+        return false;
+      }
+      client.close( id );
+      return true;
+    } );
+
+    if ( now % TICK_MS == 0 ) {
+      client.tick( TICK_MS );
+      server.tick( TICK_MS );
+    }
+
+    if ( now == SETTLE_MS ) {
+      settled_bytes = resident_bytes();
+    }
+    if ( now % 1000 == 0 ) {
+      const size_t bytes = resident_bytes();
+      cout << setw( 8 ) << now / 1000 << setw( 14 ) << now * FLOOD_PER_MS << setw( 13 )
+           << server.connection_count() << setw( 15 ) << fixed << setprecision( 1 )
+           << static_cast<double>( bytes - min( bytes, start_bytes ) ) / 1e6 << setw( 10 ) << result.accepted
+           << " of " << result.attempts << "\n";
+    }
+  }
+  const auto test_duration = duration_cast<duration<double>>( steady_clock::now() - start_time );
+
+  result.growth_after_settling = resident_bytes() - min( resident_bytes(), settled_bytes );
+  debug_output << "             SYN backlog " << syn_backlog << ( syn_cookies ? " with" : " without" )
+               << " cookies: " << server.connection_count() << " connections held, " << fixed << setprecision( 0 )
+               << static_cast<double>( now * FLOOD_PER_MS ) / test_duration.count() << " SYNs/s handled\n";
+  return result;
+}
+
+void program_body()
+{
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "A flood of " << FLOOD_PER_MS * 1000 << " spoofed SYNs per second, and a real client every "
+       << CONNECT_EVERY_MS << " ms:\n";
+
+  struct Scenario
+  {
+    size_t syn_backlog;
+    bool syn_cookies;
+  };
+  // (unbounded last: the memory it takes isn't all given back to the system)
+  for ( const auto& [backlog, cookies] : { Scenario { TCPStack::DEFAULT_BACKLOG, true },
+                                           Scenario { TCPStack::DEFAULT_BACKLOG, false },
+                                           Scenario { SIZE_MAX, false } } ) {
+    cout << "\nSYN backlog " << ( backlog == SIZE_MAX ? "unbounded" : to_string( backlog ) )
+         << ( cookies ? ", with" : ", without" ) << " SYN cookies:\n";
+    cout << "  time (s)  spoofed SYNs  connections  memory (MB)  clients accepted\n";
+    const auto result = run( backlog, cookies, debug_output );
+
+    if ( cookies ) {
+      if ( result.accepted != result.attempts ) {
+        throw runtime_error( "with SYN cookies, a real client wasn't accepted" );
+      }
+      if ( result.growth_after_settling > FLAT ) {
+        throw runtime_error( "with SYN cookies, memory grew by " + to_string( result.growth_after_settling )
+                             + " bytes under the flood" );
+      }
+    }
+  }
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
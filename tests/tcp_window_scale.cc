@@ -0,0 +1,152 @@
+#include "emulated_link.hh"
+#include "parser.hh"
+#include "tcp_config.hh"
+#include "tcp_peer.hh"
+#include "tcp_segment.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+namespace {
+
+constexpr uint64_t RECEIVE_BUFFER = 16 << 20;
+constexpr uint64_t GIVE_UP_MS = 10 * 60 * 1000; // simulated time limit for one transfer
+
+struct Result
+{
+  uint64_t duration_ms;
+  uint64_t most_in_flight;
+};
+
+// Serialize a message and parse it back, so the options go through the wire format
+TCPMessage over_the_wire( const TCPMessage& msg )
+{
+  TCPSegment seg { msg, {} };
+  seg.compute_checksum( 0 );
+  TCPSegment parsed;
+  if ( not parse( parsed, serialize( seg ), 0 ) ) {
+    throw runtime_error( "failed to parse a serialized segment" );
+  }
+  return parsed.message;
+}
+
+// Send `data` from one TCPPeer to another across a 1 Gbit/s path with a 100 ms RTT (a 12.5 MB
+// bandwidth-delay product), to a receiver with a 16 MB buffer, and check that it arrives
+Result transfer( const string& data, const bool window_scaling )
+{
+  TCPConfig client_config;
+  client_config.send_capacity = RECEIVE_BUFFER;
+  client_config.window_scaling = window_scaling;
+  TCPConfig server_config;
+  server_config.isn = Wrap32 { 1370 };
+  server_config.recv_capacity = RECEIVE_BUFFER;
+  server_config.window_scaling = window_scaling;
+  TCPPeer client { client_config };
+  TCPPeer server { server_config };
+
+  const EmulatedLink<TCPMessage>::Config path {
+    .bytes_per_ms = 125000, .delay_ms = 50, .queue_limit = UINT64_MAX };
+  EmulatedLink<TCPMessage> to_server { path, 1370 };
+  EmulatedLink<TCPMessage> to_client { path, 1370 };
+
+  uint64_t now = 0;
+  const auto send_to_server = [&]( const TCPMessage& msg ) {
+    to_server.send( over_the_wire( msg ), msg.sender.payload.size() + TCPConfig::HEADERS_SIZE, now );
+  };
+  const auto send_to_client = [&]( const TCPMessage& msg ) {
+    to_client.send( over_the_wire( msg ), msg.sender.payload.size() + TCPConfig::HEADERS_SIZE, now );
+  };
+
+  string received;
+  received.reserve( data.size() );
+  uint64_t written = 0;
+  uint64_t most_in_flight = 0;
+
+  for ( ; not server.inbound_reader().is_finished(); ++now ) {
+    if ( now > GIVE_UP_MS ) {
+      throw runtime_error( "gave up after " + to_string( GIVE_UP_MS / 1000 ) + " s of simulated time" );
+    }
+
+    for ( auto& msg : to_server.deliver( now ) ) {
+      server.receive( move( msg ), send_to_client );
+    }
+    for ( auto& msg : to_client.deliver( now ) ) {
+      client.receive( move( msg ), send_to_server );
+    }
+    while ( server.inbound_reader().bytes_buffered() ) {
+      received += server.inbound_reader().peek();
+      server.inbound_reader().pop( received.size() - server.inbound_reader().bytes_popped() );
+    }
+
+    const uint64_t room = min( client.outbound_writer().available_capacity(), data.size() - written );
+    client.outbound_writer().push( data.substr( written, room ) );
+    written += room;
+    if ( written == data.size() and not client.outbound_writer().is_closed() ) {
+      client.outbound_writer().close();
+    }
+
+    client.push( send_to_server );
+    client.tick( 1, send_to_server );
+    server.tick( 1, send_to_client );
+    most_in_flight = max( most_in_flight, client.sender().sequence_numbers_in_flight() );
+  }
+
+  if ( received != data ) {
+    throw runtime_error( "Mismatch between data sent and received" );
+  }
+  return { now, most_in_flight };
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    // 20 MB: a random megabyte, repeated
+    const string data = [] {
+      default_random_engine rd { 1370 };
+      uniform_int_distribution<char> ud;
+      string block;
+      for ( size_t i = 0; i < 1 << 20; ++i ) {
+        block += ud( rd );
+      }
+      string ret;
+      for ( size_t i = 0; i < 20; ++i ) {
+        ret += block;
+      }
+      return ret;
+    }();
+
+    // without window scaling, only 64 KB can be in flight however large the buffer
+    const auto unscaled = transfer( data.substr( 0, 1 << 20 ), false );
+    if ( unscaled.most_in_flight > UINT16_MAX ) {
+      throw runtime_error( "more than 64 KB in flight without window scaling" );
+    }
+
+    // with it, the sender fills the whole buffer: most of it is in flight at once
+    const auto scaled = transfer( data, true );
+    if ( scaled.most_in_flight < RECEIVE_BUFFER / 2 ) {
+      throw runtime_error( "only " + to_string( scaled.most_in_flight )
+                           + " bytes in flight with a 16 MB receive buffer and window scaling" );
+    }
+
+    cout << "1 MB without window scaling: " << unscaled.duration_ms << " ms, at most " << unscaled.most_in_flight
+         << " bytes in flight\n";
+    cout << "20 MB with window scaling: " << scaled.duration_ms << " ms, at most " << scaled.most_in_flight
+         << " bytes in flight\n";
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
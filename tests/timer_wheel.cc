@@ -0,0 +1,176 @@
+#include "random.hh"
+#include "timer_wheel.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+void expect( const bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( what );
+  }
+}
+
+using Wheel = TimerWheel<uint64_t>;
+
+struct Armed
+{
+  Wheel::TimerID id;
+  uint64_t deadline; // when it should expire (a time that had come when it was armed: the next ms)
+};
+
+// How far ahead to arm a timer: on each level of the wheel, and past the last
+uint64_t random_delay( default_random_engine& rd )
+{
+  static constexpr uint64_t reach[] = { 4, 256, 1 << 14, 1 << 20, uint64_t { 1 } << 26, uint64_t { 1 } << 34 };
+  const uint64_t limit = reach[uniform_int_distribution<size_t> { 0, size( reach ) - 1 }( rd )];
+  return uniform_int_distribution<uint64_t> { 0, limit }( rd );
+}
+
+uint64_t random_step( default_random_engine& rd )
+{
+  static constexpr uint64_t reach[] = { 1, 10, 300, 1 << 16, uint64_t { 1 } << 30 };
+  const uint64_t limit = reach[uniform_int_distribution<size_t> { 0, size( reach ) - 1 }( rd )];
+  return uniform_int_distribution<uint64_t> { 0, limit }( rd );
+}
+
+// Arm, cancel and advance at random, and check that each timer expires exactly when it should
+void random_operations( default_random_engine& rd )
+{
+  const uint64_t start = uniform_int_distribution<uint64_t> { 0, uint64_t { 1 } << 40 }( rd );
+  Wheel wheel { start };
+  map<uint64_t, Armed> armed; // by value
+  uint64_t next_value = 0;
+
+  for ( size_t op = 0; op < 20000; ++op ) {
+    const uint64_t now = wheel.now();
+    switch ( uniform_int_distribution<int> { 0, 5 }( rd ) ) {
+      case 0:
+      case 1:
+      case 2: {
+        const uint64_t deadline = now + random_delay( rd ) - ( op % 7 == 0 ? 10 : 0 ); // (some already passed)
+        const uint64_t value = next_value++;
+        armed.emplace( value, Armed { wheel.arm( deadline, value ), max( deadline, now + 1 ) } );
+        break;
+      }
+
+      case 3: {
+        if ( armed.empty() ) {
+          break;
+        }
+        auto it = armed.begin();
+        advance( it, uniform_int_distribution<size_t> { 0, armed.size() - 1 }( rd ) );
+        expect( wheel.armed( it->second.id ), "an armed timer isn't" );
+        wheel.cancel( it->second.id );
+        expect( not wheel.armed( it->second.id ), "a cancelled timer is still armed" );
+        armed.erase( it );
+        break;
+      }
+
+      default: {
+        uint64_t earliest = UINT64_MAX;
+        for ( const auto& [value, timer] : armed ) {
+          earliest = min( earliest, timer.deadline );
+        }
+        const auto next = wheel.next_deadline();
+        expect( next.has_value() == not armed.empty(), "next_deadline() with " + to_string( armed.size() ) );
+        if ( next.has_value() ) {
+          expect( *next <= earliest, "next_deadline() is after a deadline" );
+          expect( *next > now, "next_deadline() has passed" );
+        }
+
+        const uint64_t target = now + random_step( rd );
+        uint64_t last_deadline = 0;
+        wheel.advance_to( target, [&]( const uint64_t value ) {
+          const auto it = armed.find( value );
+          expect( it != armed.end(), "timer " + to_string( value ) + " expired twice, or after it was cancelled" );
+          const uint64_t deadline = it->second.deadline;
+          expect( deadline > now and deadline <= target,
+                  "timer for " + to_string( deadline ) + " expired advancing from " + to_string( now ) + " to "
+                    + to_string( target ) );
+          expect( deadline >= last_deadline, "timers expired out of order" );
+          last_deadline = deadline;
+          armed.erase( it );
+        } );
+        expect( wheel.now() == target, "the wheel's time didn't advance" );
+        for ( const auto& [value, timer] : armed ) {
+          expect( timer.deadline > target, "timer for " + to_string( timer.deadline ) + " didn't expire by "
+                                             + to_string( target ) );
+        }
+      }
+    }
+    expect( wheel.size() == armed.size(), "size() is " + to_string( wheel.size() ) );
+  }
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      Wheel wheel;
+      vector<uint64_t> expired;
+      const auto record = [&]( const uint64_t value ) { expired.push_back( value ); };
+
+      // each timer expires at its deadline, not before
+      wheel.arm( 300, 300 );
+      wheel.arm( 5, 5 );
+      wheel.arm( 20000, 20000 );
+      wheel.advance_to( 4, record );
+      expect( expired.empty(), "a timer expired early" );
+      wheel.advance_to( 5, record );
+      expect( expired == vector<uint64_t> { 5 }, "a timer didn't expire at its deadline" );
+      wheel.advance_to( 299, record );
+      expect( expired.size() == 1, "a timer on level 1 expired early" );
+      wheel.advance_to( 19999, record );
+      expect( expired == vector<uint64_t> { 5, 300 }, "a timer on level 1 didn't expire" );
+      wheel.advance_to( 20000, record );
+      expect( expired == vector<uint64_t> { 5, 300, 20000 }, "a timer on level 2 didn't expire" );
+
+      // a stale ID cancels nothing, even once its node is reused
+      const auto first = wheel.arm( 20100, 1 );
+      wheel.advance_to( 20100, record );
+      const auto second = wheel.arm( 20200, 2 );
+      wheel.cancel( first );
+      expect( wheel.armed( second ), "a stale ID cancelled another timer" );
+
+      // a timer armed while timers expire, for a time that has come, waits for the next millisecond
+      expired.clear();
+      wheel.advance_to( 20200, [&]( const uint64_t value ) {
+        expired.push_back( value );
+        if ( value == 2 ) {
+          wheel.arm( 0, 3 );
+        }
+      } );
+      expect( expired == vector<uint64_t> { 2 }, "a timer armed in the past expired at once" );
+      expect( wheel.next_deadline() == 20201, "a timer armed in the past isn't due next" );
+      wheel.advance_to( 20201, record );
+      expect( expired == vector<uint64_t> { 2, 3 }, "a timer armed in the past didn't expire" );
+      expect( wheel.empty(), "timers are left" );
+    }
+
+    for ( size_t i = 0; i < 10; ++i ) {
+      random_operations( rd );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
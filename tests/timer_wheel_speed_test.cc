@@ -0,0 +1,127 @@
+#include "timer_wheel.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+constexpr uint32_t TIMERS = 1'000'000;
+constexpr uint64_t MAX_DEADLINE_MS = 120'000; // deadlines spread over the next two minutes
+constexpr uint64_t TICK_MS = 10;              // as in a TCPMinnowSocket
+constexpr uint64_t RUN_MS = 10'000;           // simulated time to advance through
+constexpr uint64_t NEVER = UINT64_MAX;
+
+double ns_per( const steady_clock::duration elapsed, const uint64_t count )
+{
+  return static_cast<double>( duration_cast<nanoseconds>( elapsed ).count() ) / static_cast<double>( count );
+}
+
+double ms_of( const steady_clock::duration elapsed )
+{
+  return duration_cast<duration<double, milli>>( elapsed ).count();
+}
+
+void program_body()
+{
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  default_random_engine rd { 1370 };
+  uniform_int_distribution<uint64_t> delay { 1, MAX_DEADLINE_MS };
+  uniform_int_distribution<uint32_t> pick { 0, TIMERS - 1 };
+
+  TimerWheel<uint32_t> wheel;
+  vector<TimerWheel<uint32_t>::TimerID> ids( TIMERS );
+  vector<uint64_t> deadlines( TIMERS ); // what a scan of every timer on each tick looks at
+
+  // arm a timer for each of a million connections
+  auto start = steady_clock::now();
+  for ( uint32_t i = 0; i < TIMERS; ++i ) {
+    deadlines[i] = delay( rd );
+    ids[i] = wheel.arm( deadlines[i], i );
+  }
+  const double arm_ns = ns_per( steady_clock::now() - start, TIMERS );
+
+  // and move a million of them, as an ACK moves a retransmission timer
+  start = steady_clock::now();
+  for ( uint32_t n = 0; n < TIMERS; ++n ) {
+    const uint32_t i = pick( rd );
+    wheel.cancel( ids[i] );
+    deadlines[i] = delay( rd );
+    ids[i] = wheel.arm( deadlines[i], i );
+  }
+  const double rearm_ns = ns_per( steady_clock::now() - start, TIMERS );
+  if ( wheel.size() != TIMERS ) {
+    throw runtime_error( "the wheel has " + to_string( wheel.size() ) + " timers" );
+  }
+
+  // advance through the simulated time, tick by tick, with the wheel
+  uint64_t wheel_expired = 0;
+  start = steady_clock::now();
+  for ( uint64_t now = TICK_MS; now <= RUN_MS; now += TICK_MS ) {
+    wheel.advance_to( now, [&]( const uint32_t i ) {
+      if ( deadlines[i] > now or deadlines[i] + TICK_MS <= now ) {
+        throw runtime_error( "timer for " + to_string( deadlines[i] ) + " expired at " + to_string( now ) );
+      }
+      ++wheel_expired;
+    } );
+  }
+  const auto wheel_time = steady_clock::now() - start;
+
+  // and by looking at every timer on every tick
+  uint64_t scan_expired = 0;
+  start = steady_clock::now();
+  for ( uint64_t now = TICK_MS; now <= RUN_MS; now += TICK_MS ) {
+    for ( auto& deadline : deadlines ) {
+      if ( deadline <= now ) {
+        deadline = NEVER;
+        ++scan_expired;
+      }
+    }
+  }
+  const auto scan_time = steady_clock::now() - start;
+
+  if ( wheel_expired != scan_expired ) {
+    throw runtime_error( "the wheel expired " + to_string( wheel_expired ) + " timers, and the scan "
+                         + to_string( scan_expired ) );
+  }
+
+  const double simulated_seconds = static_cast<double>( RUN_MS ) / 1000;
+  cout << "TimerWheel with " << TIMERS << " timers armed: " << fixed << setprecision( 0 ) << arm_ns
+       << " ns to arm, " << rearm_ns << " ns to cancel and rearm; advancing " << TICK_MS << " ms at a time took "
+       << setprecision( 1 ) << ms_of( wheel_time ) / simulated_seconds << " ms per simulated second ("
+       << wheel_expired << " expired), against " << ms_of( scan_time ) / simulated_seconds
+       << " ms to scan every timer on every tick.\n";
+  debug_output << "             " << fixed << setprecision( 0 ) << arm_ns << " ns/arm, " << rearm_ns
+               << " ns/rearm, " << setprecision( 1 ) << ms_of( wheel_time ) / simulated_seconds
+               << " ms/s advancing vs. " << ms_of( scan_time ) / simulated_seconds << " ms/s scanning\n";
+
+  if ( wheel_time >= scan_time ) {
+    throw runtime_error( "advancing the wheel was no faster than scanning every timer" );
+  }
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -36,6 +36,20 @@ public:
     return ~ret;
   }
 
+  //! The checksum `cksum` after one 16-bit word of the checksummed data changes from `old_word` to `new_word`
+  //! (RFC 1624: HC' = ~(~HC + ~m + m'))
+  static uint16_t patch( const uint16_t cksum, const uint16_t old_word, const uint16_t new_word )
+  {
+    uint32_t ret = static_cast<uint16_t>( ~cksum ) + static_cast<uint32_t>( static_cast<uint16_t>( ~old_word ) )
+                   + new_word;
+
+    while ( ret > 0xffff ) {
+      ret = ( ret >> 16 ) + static_cast<uint16_t>( ret );
+    }
+
+    return ~ret;
+  }
+
   void add( const std::vector<std::string>& data )
   {
     for ( const auto& x : data ) {
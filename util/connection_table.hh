@@ -0,0 +1,126 @@
+#pragma once
+
+#include "four_tuple.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+//! \brief An open-addressing hash table from FourTuples to connections (or anything small)
+//! \details The slots are one flat array, a power of two long and never more than half full, searched by
+//! linear probing from the key's hash. Erasing an entry shifts the rest of its cluster back, so there are no
+//! tombstones and lookups stay short however many connections come and go. The hash is keyed with a secret,
+//! so a remote host can't pick 4-tuples that all land in the same cluster.
+template<class Value>
+class ConnectionTable
+{
+public:
+  explicit ConnectionTable( uint64_t secret = 0 ) : secret_( secret ) {}
+
+  //! The value for `key`, if it's in the table
+  Value* find( const FourTuple& key )
+  {
+    const auto slot = locate( key );
+    return slot.has_value() ? &slots_[*slot].value : nullptr;
+  }
+  const Value* find( const FourTuple& key ) const
+  {
+    const auto slot = locate( key );
+    return slot.has_value() ? &slots_[*slot].value : nullptr;
+  }
+
+  //! Add `key`, unless it's already there. Returns whether it was added.
+  bool insert( const FourTuple& key, Value value )
+  {
+    if ( locate( key ).has_value() ) {
+      return false;
+    }
+    if ( 2 * ( size_ + 1 ) > slots_.size() ) {
+      grow();
+    }
+    place( key, std::move( value ) );
+    return true;
+  }
+
+  //! Remove `key`. Returns whether it was there.
+  bool erase( const FourTuple& key )
+  {
+    const auto found = locate( key );
+    if ( not found.has_value() ) {
+      return false;
+    }
+
+    // Move each later entry of the cluster into the hole, unless the hole is before the entry's home slot
+    const size_t mask = slots_.size() - 1;
+    size_t hole = *found;
+    for ( size_t i = ( hole + 1 ) & mask; slots_[i].occupied; i = ( i + 1 ) & mask ) {
+      if ( ( ( i - home( slots_[i].key ) ) & mask ) >= ( ( i - hole ) & mask ) ) {
+        slots_[hole] = std::move( slots_[i] );
+        hole = i;
+      }
+    }
+    slots_[hole] = {};
+    --size_;
+    return true;
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  size_t capacity() const { return slots_.size(); }
+
+private:
+  struct Slot
+  {
+    FourTuple key {};
+    Value value {};
+    bool occupied {};
+  };
+
+  std::vector<Slot> slots_ {};
+  size_t size_ {};
+  uint64_t secret_;
+
+  static constexpr size_t MIN_CAPACITY = 16;
+
+  size_t home( const FourTuple& key ) const { return keyed_hash( key, secret_ ) & ( slots_.size() - 1 ); }
+
+  std::optional<size_t> locate( const FourTuple& key ) const
+  {
+    if ( slots_.empty() ) {
+      return {};
+    }
+    const size_t mask = slots_.size() - 1;
+    for ( size_t i = home( key ); slots_[i].occupied; i = ( i + 1 ) & mask ) {
+      if ( slots_[i].key == key ) {
+        return i;
+      }
+    }
+    return {};
+  }
+
+  void place( const FourTuple& key, Value&& value )
+  {
+    const size_t mask = slots_.size() - 1;
+    size_t i = home( key );
+    while ( slots_[i].occupied ) {
+      i = ( i + 1 ) & mask;
+    }
+    slots_[i] = { key, std::move( value ), true };
+    ++size_;
+  }
+
+  void grow()
+  {
+    std::vector<Slot> old( std::max( 2 * slots_.size(), MIN_CAPACITY ) );
+    std::swap( old, slots_ );
+    size_ = 0;
+    for ( auto& slot : old ) {
+      if ( slot.occupied ) {
+        place( slot.key, std::move( slot.value ) );
+      }
+    }
+  }
+};
@@ -151,6 +151,63 @@ void FileDescriptor::read( vector<string>& buffers )
   }
 }
 
+size_t FileDescriptor::read( const vector<span<char>>& buffers )
+{
+  vector<iovec> iovecs;
+  iovecs.reserve( buffers.size() );
+  size_t total_size = 0;
+  for ( const auto x : buffers ) {
+    iovecs.push_back( { x.data(), x.size() } );
+    total_size += x.size();
+  }
+
+  const ssize_t bytes_read = ::readv( fd_num(), iovecs.data(), static_cast<int>( iovecs.size() ) );
+  if ( bytes_read < 0 ) {
+    if ( internal_fd_->non_blocking_ and ( errno == EAGAIN or errno == EINPROGRESS ) ) {
+      return 0;
+    }
+    throw unix_error { "readv" };
+  }
+
+  register_read();
+
+  if ( bytes_read == 0 and total_size != 0 ) {
+    internal_fd_->eof_ = true;
+  }
+
+  if ( bytes_read > static_cast<ssize_t>( total_size ) ) {
+    throw runtime_error( "readv() read more than requested" );
+  }
+
+  return bytes_read;
+}
+
+size_t FileDescriptor::splice_to( FileDescriptor& sink, size_t len )
+{
+  const ssize_t bytes_moved
+    = ::splice( fd_num(), nullptr, sink.fd_num(), nullptr, len, SPLICE_F_MOVE | SPLICE_F_NONBLOCK );
+  if ( bytes_moved < 0 ) {
+    // SPLICE_F_NONBLOCK makes the pipe side non-blocking, whatever the flags on either descriptor
+    if ( errno == EAGAIN ) {
+      return 0;
+    }
+    throw unix_error { "splice" };
+  }
+
+  register_read();
+  sink.register_write();
+
+  if ( bytes_moved == 0 and len != 0 ) {
+    internal_fd_->eof_ = true;
+  }
+
+  if ( bytes_moved > static_cast<ssize_t>( len ) ) {
+    throw runtime_error( "splice() moved more than requested" );
+  }
+
+  return bytes_moved;
+}
+
 size_t FileDescriptor::write( string_view buffer )
 {
   return write( vector<string_view> { buffer } );
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+//! \brief The addresses of a TCP connection, as seen from this end: which identify the connection among all
+//! those sharing an IP interface
+struct FourTuple
+{
+  uint32_t local_ip {};    //!< Our IPv4 address (numeric, host byte order)
+  uint32_t remote_ip {};   //!< The peer's IPv4 address
+  uint16_t local_port {};  //!< Our TCP port
+  uint16_t remote_port {}; //!< The peer's TCP port
+
+  bool operator==( const FourTuple& other ) const = default;
+};
+
+//! A 64-bit mixing function (the finalizer of splitmix64)
+inline uint64_t mix64( uint64_t x )
+{
+  x = ( x ^ ( x >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+  x = ( x ^ ( x >> 27 ) ) * 0x94d049bb133111ebULL;
+  return x ^ ( x >> 31 );
+}
+
+//! Hash a FourTuple, keyed with a secret so that a remote host can't predict the result
+//! (for spreading a hash table only: mix64 is invertible, so this is no MAC; see siphash.hh)
+inline uint64_t keyed_hash( const FourTuple& tuple, uint64_t secret )
+{
+  const uint64_t ips = static_cast<uint64_t>( tuple.local_ip ) << 32 | tuple.remote_ip;
+  const uint64_t ports = static_cast<uint64_t>( tuple.local_port ) << 16 | tuple.remote_port;
+  return mix64( mix64( ips ^ secret ) ^ ports );
+}
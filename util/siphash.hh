@@ -0,0 +1,64 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+//! A 128-bit SipHash key
+struct SipHashKey
+{
+  uint64_t k0 {};
+  uint64_t k1 {};
+};
+
+//! \brief SipHash-2-4 (Aumasson and Bernstein): a keyed pseudorandom function of a short message
+//! \details Unlike a mixing function with the key folded into its input, its outputs don't give the key away:
+//! what it says about one message doesn't help to forge the value for another.
+inline uint64_t siphash24( const SipHashKey& key, std::string_view message )
+{
+  uint64_t v0 = key.k0 ^ 0x736f6d6570736575ULL;
+  uint64_t v1 = key.k1 ^ 0x646f72616e646f6dULL;
+  uint64_t v2 = key.k0 ^ 0x6c7967656e657261ULL;
+  uint64_t v3 = key.k1 ^ 0x7465646279746573ULL;
+
+  const auto round = [&] {
+    v0 += v1;
+    v1 = std::rotl( v1, 13 ) ^ v0;
+    v0 = std::rotl( v0, 32 );
+    v2 += v3;
+    v3 = std::rotl( v3, 16 ) ^ v2;
+    v0 += v3;
+    v3 = std::rotl( v3, 21 ) ^ v0;
+    v2 += v1;
+    v1 = std::rotl( v1, 17 ) ^ v2;
+    v2 = std::rotl( v2, 32 );
+  };
+  const auto compress = [&]( uint64_t m ) {
+    v3 ^= m;
+    round();
+    round();
+    v0 ^= m;
+  };
+
+  // each whole 8-byte word of the message (little-endian), then the rest with the length in the top byte
+  size_t pos = 0;
+  for ( ; pos + 8 <= message.size(); pos += 8 ) {
+    uint64_t m = 0;
+    for ( size_t i = 0; i < 8; ++i ) {
+      m |= static_cast<uint64_t>( static_cast<uint8_t>( message[pos + i] ) ) << ( 8 * i );
+    }
+    compress( m );
+  }
+  uint64_t last = static_cast<uint64_t>( message.size() ) << 56;
+  for ( size_t i = 0; pos + i < message.size(); ++i ) {
+    last |= static_cast<uint64_t>( static_cast<uint8_t>( message[pos + i] ) ) << ( 8 * i );
+  }
+  compress( last );
+
+  v2 ^= 0xff;
+  for ( size_t i = 0; i < 4; ++i ) {
+    round();
+  }
+  return v0 ^ v1 ^ v2 ^ v3;
+}
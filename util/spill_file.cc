@@ -0,0 +1,195 @@
+#include "spill_file.hh"
+
+#include "exception.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+using namespace std;
+
+namespace {
+// never map less than this, so a stream that spills a little doesn't remap on every push
+constexpr uint64_t MIN_FILE_SIZE = 1 << 20;
+
+// An anonymous file in $TMPDIR (or /tmp) that disappears when the last descriptor is closed
+FileDescriptor create_temp_file()
+{
+  const char* dir = getenv( "TMPDIR" ); // NOLINT(*-mt-unsafe)
+  if ( dir == nullptr or *dir == '\0' ) {
+    dir = "/tmp";
+  }
+
+  const int fd = ::open( dir, O_TMPFILE | O_RDWR | O_CLOEXEC, S_IRUSR | S_IWUSR ); // NOLINT(*-vararg)
+  if ( fd >= 0 ) {
+    return FileDescriptor { fd };
+  }
+
+  // fall back for filesystems without O_TMPFILE
+  string path = string( dir ) + "/minnow-spill-XXXXXX";
+  FileDescriptor file { CheckSystemCall( "mkostemp", mkostemp( path.data(), O_CLOEXEC ) ) };
+  CheckSystemCall( "unlink", unlink( path.c_str() ) );
+  return file;
+}
+} // namespace
+
+SpillFile::SpillFile( uint64_t max_size ) : max_size_( max_size ) {}
+
+void SpillFile::set_max_size( uint64_t max_size )
+{
+  max_size_ = max_size;
+}
+
+void SpillFile::grow( uint64_t min_size )
+{
+  const uint64_t page = sysconf( _SC_PAGESIZE );
+  uint64_t new_size = max( { min_size, 2 * ring_size_, MIN_FILE_SIZE } );
+  new_size = min( new_size, max( min_size, max_size_ ) );
+  new_size = ( new_size + page - 1 ) / page * page;
+
+  if ( not fd_ ) {
+    fd_ = make_unique<FileDescriptor>( create_temp_file() );
+  }
+  CheckSystemCall( "ftruncate", ftruncate( fd_->fd_num(), static_cast<off_t>( new_size ) ) );
+
+  void* const mapping
+    = map_ ? mremap( map_, ring_size_, new_size, MREMAP_MAYMOVE )
+           : mmap( nullptr, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_->fd_num(), 0 ); // NOLINT(*-bitwise)
+  if ( mapping == MAP_FAILED ) { // NOLINT(*-cstyle-cast)
+    throw unix_error { map_ ? "mremap" : "mmap" };
+  }
+  map_ = static_cast<char*>( mapping );
+
+  // a backlog that wrapped around the end of the old file: move its first part up to the end of the new one
+  if ( head_ + size_ > ring_size_ ) {
+    const uint64_t first_part = ring_size_ - head_;
+    memmove( map_ + new_size - first_part, map_ + head_, first_part );
+    head_ = new_size - first_part;
+  }
+  ring_size_ = new_size;
+}
+
+vector<span<char>> SpillFile::reserve( uint64_t len )
+{
+  if ( len == 0 ) {
+    return {};
+  }
+  if ( size_ + len > ring_size_ ) {
+    grow( size_ + len );
+  }
+
+  const uint64_t write_pos = ( head_ + size_ ) % ring_size_;
+  const uint64_t first_part = min( len, ring_size_ - write_pos );
+  vector<span<char>> free_space { { map_ + write_pos, first_part } };
+  if ( first_part < len ) {
+    free_space.emplace_back( map_, len - first_part );
+  }
+  return free_space;
+}
+
+void SpillFile::commit( uint64_t len )
+{
+  if ( size_ + len > ring_size_ ) {
+    throw runtime_error( "SpillFile: committed more than was reserved" );
+  }
+  size_ += len;
+}
+
+void SpillFile::push( string_view data )
+{
+  const uint64_t len = data.size();
+  for ( const auto region : reserve( len ) ) {
+    copy_n( data.data(), region.size(), region.data() );
+    data.remove_prefix( region.size() );
+  }
+  commit( len );
+}
+
+string_view SpillFile::peek( uint64_t offset ) const
+{
+  if ( offset >= size_ ) {
+    return {};
+  }
+  const uint64_t read_pos = ( head_ + offset ) % ring_size_;
+  return { map_ + read_pos, min( size_ - offset, ring_size_ - read_pos ) };
+}
+
+void SpillFile::pop( uint64_t len )
+{
+  if ( len > size_ ) {
+    throw runtime_error( "SpillFile: not enough data to pop" );
+  }
+  if ( len == 0 ) {
+    return;
+  }
+  head_ = ( head_ + len ) % ring_size_;
+  size_ -= len;
+
+  if ( size_ == 0 ) {
+    // drained: give the blocks (and their page cache) back, best effort, but keep the mapping for the next spill
+    head_ = 0;
+    // NOLINTNEXTLINE(*-bitwise)
+    fallocate( fd_->fd_num(), FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>( ring_size_ ) );
+  }
+}
+
+void SpillFile::unmap()
+{
+  if ( map_ ) {
+    munmap( map_, ring_size_ );
+  }
+  map_ = nullptr;
+  ring_size_ = head_ = size_ = 0;
+  fd_.reset();
+}
+
+SpillFile::~SpillFile()
+{
+  unmap();
+}
+
+SpillFile::SpillFile( const SpillFile& other ) : max_size_( other.max_size_ )
+{
+  for ( uint64_t offset = 0; offset < other.size_; ) {
+    const auto view = other.peek( offset );
+    push( view );
+    offset += view.size();
+  }
+}
+
+SpillFile& SpillFile::operator=( const SpillFile& other )
+{
+  if ( this != &other ) {
+    *this = SpillFile { other };
+  }
+  return *this;
+}
+
+SpillFile::SpillFile( SpillFile&& other ) noexcept
+  : max_size_( other.max_size_ )
+  , fd_( std::move( other.fd_ ) )
+  , map_( exchange( other.map_, nullptr ) )
+  , ring_size_( exchange( other.ring_size_, 0 ) )
+  , head_( exchange( other.head_, 0 ) )
+  , size_( exchange( other.size_, 0 ) )
+{}
+
+SpillFile& SpillFile::operator=( SpillFile&& other ) noexcept
+{
+  if ( this != &other ) {
+    unmap();
+    max_size_ = other.max_size_;
+    fd_ = std::move( other.fd_ );
+    map_ = exchange( other.map_, nullptr );
+    ring_size_ = exchange( other.ring_size_, 0 );
+    head_ = exchange( other.head_, 0 );
+    size_ = exchange( other.size_, 0 );
+  }
+  return *this;
+}
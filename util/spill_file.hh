@@ -0,0 +1,46 @@
+#pragma once
+
+#include "file_descriptor.hh"
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+//! \brief A FIFO of bytes kept in a memory-mapped, unlinked temporary file
+//! \details The file is created and mapped on the first push, and grows by doubling (up to `max_size`, rounded up
+//! to a page) only when the bytes waiting in it no longer fit. It is used as a ring, so it stays as large as the
+//! biggest backlog rather than the total ever pushed. Once everything has been popped, the file's blocks are
+//! released with a hole punch; the mapping itself is kept until destruction. Copies get a file of their own.
+class SpillFile
+{
+public:
+  explicit SpillFile( uint64_t max_size );
+
+  uint64_t size() const { return size_; }               //!< Bytes pushed and not yet popped
+  uint64_t file_size() const { return ring_size_; }     //!< Current length of the backing file
+  void push( std::string_view data );                   //!< Append all of `data`, growing the file if needed
+  std::string_view peek( uint64_t offset ) const;       //!< Contiguous bytes starting `offset` past the front
+  void pop( uint64_t len );                             //!< Drop `len` bytes from the front
+  std::vector<std::span<char>> reserve( uint64_t len ); //!< Free space for exactly `len` more bytes
+  void commit( uint64_t len );                          //!< Append `len` bytes written into reserve()'s spans
+  void set_max_size( uint64_t max_size );               //!< Change the limit on the file's growth
+
+  ~SpillFile();
+  SpillFile( const SpillFile& other );
+  SpillFile& operator=( const SpillFile& other );
+  SpillFile( SpillFile&& other ) noexcept;
+  SpillFile& operator=( SpillFile&& other ) noexcept;
+
+private:
+  void grow( uint64_t min_size );
+  void unmap();
+
+  uint64_t max_size_;
+  std::unique_ptr<FileDescriptor> fd_ {};
+  char* map_ = nullptr;
+  uint64_t ring_size_ = 0; // length of the file and of the mapping
+  uint64_t head_ = 0;      // offset of the first buffered byte
+  uint64_t size_ = 0;      // number of buffered bytes, which may wrap past the end of the file
+};
@@ -0,0 +1,218 @@
+#include "spsc_byte_stream.hh"
+
+#include "exception.hh"
+
+#include <algorithm>
+#include <span>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+using namespace std;
+
+static FileDescriptor make_eventfd()
+{
+  return FileDescriptor { CheckSystemCall( "eventfd", ::eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) ) };
+}
+
+SPSCByteStream::SPSCByteStream( uint64_t capacity )
+  : capacity_( capacity ), ring_( capacity, '\0' ), data_event_( make_eventfd() ), space_event_( make_eventfd() )
+{
+  if ( capacity_ == 0 ) {
+    throw runtime_error( "SPSCByteStream capacity must be nonzero" );
+  }
+}
+
+void SPSCByteStream::signal( FileDescriptor& event )
+{
+  const uint64_t one = 1;
+  CheckSystemCall( "write(eventfd)", static_cast<int>( ::write( event.fd_num(), &one, sizeof( one ) ) ) );
+}
+
+void SPSCByteStream::clear_event( FileDescriptor& event )
+{
+  string counter( sizeof( uint64_t ), '\0' );
+  event.read( counter );
+}
+
+// The producer publishes first and only then looks at the consumer's counter. If the consumer had already
+// popped everything that was published before, it may be asleep and must be woken; if not, it will see the new
+// bytes when it next checks bytes_buffered(), because that check happens after this one.
+void SPSCByteStream::publish( uint64_t len )
+{
+  const uint64_t old_pushed = pushed_.load( memory_order_relaxed );
+  pushed_.store( old_pushed + len );
+  if ( popped_.load() == old_pushed ) {
+    signal( data_event_ );
+  }
+}
+
+// Mirror image of publish(): wake the producer only if it may have seen the stream full.
+void SPSCByteStream::release( uint64_t len )
+{
+  const uint64_t old_popped = popped_.load( memory_order_relaxed );
+  popped_.store( old_popped + len );
+  if ( pushed_.load() - old_popped == capacity_ ) {
+    signal( space_event_ );
+  }
+}
+
+vector<pair<char*, uint64_t>> SPSCByteStream::free_regions()
+{
+  const uint64_t available = available_capacity();
+  if ( available == 0 ) {
+    return {};
+  }
+
+  const uint64_t write_pos = pushed_.load( memory_order_relaxed ) % capacity_;
+  const uint64_t first_part = min( available, capacity_ - write_pos );
+  vector<pair<char*, uint64_t>> regions { { ring_.data() + write_pos, first_part } };
+  if ( first_part < available ) {
+    regions.emplace_back( ring_.data(), available - first_part );
+  }
+  return regions;
+}
+
+uint64_t SPSCByteStream::push( string_view data )
+{
+  if ( is_closed() ) {
+    throw runtime_error( "SPSCByteStream has already been closed" );
+  }
+
+  uint64_t len = 0;
+  for ( const auto& [region, size] : free_regions() ) {
+    const uint64_t n = min( size, data.size() - len );
+    copy_n( data.data() + len, n, region );
+    len += n;
+  }
+
+  if ( len > 0 ) {
+    publish( len );
+  }
+  return len;
+}
+
+uint64_t SPSCByteStream::read_from( FileDescriptor& fd )
+{
+  if ( is_closed() ) {
+    throw runtime_error( "SPSCByteStream has already been closed" );
+  }
+
+  // a zero-length readv() would look like EOF, so don't ask the kernel for nothing
+  const auto regions = free_regions();
+  if ( regions.empty() ) {
+    return 0;
+  }
+
+  vector<span<char>> buffers;
+  for ( const auto& [region, size] : regions ) {
+    buffers.emplace_back( region, size );
+  }
+
+  const uint64_t len = fd.read( buffers );
+  if ( len > 0 ) {
+    publish( len );
+  }
+  return len;
+}
+
+void SPSCByteStream::close()
+{
+  if ( not closed_.exchange( true ) ) {
+    signal( data_event_ );
+  }
+}
+
+bool SPSCByteStream::is_closed() const
+{
+  return closed_.load();
+}
+
+uint64_t SPSCByteStream::available_capacity() const
+{
+  return capacity_ - ( pushed_.load( memory_order_relaxed ) - popped_.load() );
+}
+
+uint64_t SPSCByteStream::bytes_pushed() const
+{
+  return pushed_.load();
+}
+
+string_view SPSCByteStream::peek() const
+{
+  const uint64_t buffered = bytes_buffered();
+  if ( buffered == 0 ) {
+    return {};
+  }
+
+  const uint64_t read_pos = popped_.load( memory_order_relaxed ) % capacity_;
+  return { ring_.data() + read_pos, min( buffered, capacity_ - read_pos ) };
+}
+
+vector<string_view> SPSCByteStream::peek_all() const
+{
+  vector<string_view> views;
+  const uint64_t buffered = bytes_buffered();
+  if ( buffered == 0 ) {
+    return views;
+  }
+
+  const uint64_t read_pos = popped_.load( memory_order_relaxed ) % capacity_;
+  const uint64_t first_part = min( buffered, capacity_ - read_pos );
+  views.emplace_back( ring_.data() + read_pos, first_part );
+  if ( first_part < buffered ) {
+    views.emplace_back( ring_.data(), buffered - first_part );
+  }
+  return views;
+}
+
+void SPSCByteStream::pop( uint64_t len )
+{
+  if ( len > bytes_buffered() ) {
+    throw runtime_error( "SPSCByteStream: not enough data to pop" );
+  }
+  if ( len > 0 ) {
+    release( len );
+  }
+}
+
+uint64_t SPSCByteStream::write_to( FileDescriptor& fd )
+{
+  const auto views = peek_all();
+  if ( views.empty() ) {
+    return 0;
+  }
+
+  const uint64_t len = fd.write( views );
+  pop( len );
+  return len;
+}
+
+bool SPSCByteStream::is_finished() const
+{
+  // check the flag first: once it is set, every byte the producer will ever push is already published
+  return is_closed() and bytes_buffered() == 0;
+}
+
+uint64_t SPSCByteStream::bytes_buffered() const
+{
+  return pushed_.load() - popped_.load( memory_order_relaxed );
+}
+
+uint64_t SPSCByteStream::bytes_popped() const
+{
+  return popped_.load();
+}
+
+void SPSCByteStream::set_error()
+{
+  if ( not error_.exchange( true ) ) {
+    signal( data_event_ );
+    signal( space_event_ );
+  }
+}
+
+bool SPSCByteStream::has_error() const
+{
+  return error_.load();
+}
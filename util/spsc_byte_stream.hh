@@ -0,0 +1,89 @@
+#pragma once
+
+#include "file_descriptor.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+//! \brief A byte stream shared by exactly one producer thread and one consumer thread
+//! \details The bytes live in a ring of `capacity` bytes. Only the producer advances the push counter and
+//! only the consumer advances the pop counter, so neither side ever takes a lock. Each side can sleep on an
+//! eventfd (e.g. in an EventLoop rule) that the other side signals when it makes progress that the sleeper
+//! might be waiting for.
+class SPSCByteStream
+{
+public:
+  explicit SPSCByteStream( uint64_t capacity );
+
+  //! \name Producer side
+  //!@{
+  uint64_t push( std::string_view data );   //!< Push as much of `data` as fits; returns the number of bytes pushed
+  uint64_t read_from( FileDescriptor& fd ); //!< readv() from `fd` straight into the free space
+  void close();                             //!< Signal that nothing more will be pushed
+  bool is_closed() const;
+  uint64_t available_capacity() const;
+  uint64_t bytes_pushed() const;
+  //!@}
+
+  //! \name Consumer side
+  //!@{
+  std::string_view peek() const;                  //!< The contiguous bytes at the front of the stream
+  std::vector<std::string_view> peek_all() const; //!< Views that together cover every buffered byte
+  void pop( uint64_t len );
+  uint64_t write_to( FileDescriptor& fd ); //!< writev() the buffered bytes to `fd`, popping what was written
+  bool is_finished() const;                //!< Closed, and every pushed byte has been popped
+  uint64_t bytes_buffered() const;
+  uint64_t bytes_popped() const;
+  //!@}
+
+  //! \name Either side
+  //!@{
+  void set_error();
+  bool has_error() const;
+  //!@}
+
+  //! Readable after the producer pushes into an empty stream, closes it, or either side sets an error
+  FileDescriptor& data_event() { return data_event_; }
+
+  //! Readable after the consumer pops from a full stream, or either side sets an error
+  FileDescriptor& space_event() { return space_event_; }
+
+  //! Reset an event after waking up on it
+  static void clear_event( FileDescriptor& event );
+
+  //! Shared between two threads by reference; never copied or moved
+  //!@{
+  SPSCByteStream( const SPSCByteStream& other ) = delete;
+  SPSCByteStream& operator=( const SPSCByteStream& other ) = delete;
+  SPSCByteStream( SPSCByteStream&& other ) = delete;
+  SPSCByteStream& operator=( SPSCByteStream&& other ) = delete;
+  ~SPSCByteStream() = default;
+  //!@}
+
+private:
+  uint64_t capacity_;
+  std::string ring_;
+
+  // Each counter is written by one thread only; keep them on separate cache lines.
+  alignas( 64 ) std::atomic<uint64_t> pushed_ { 0 };
+  alignas( 64 ) std::atomic<uint64_t> popped_ { 0 };
+
+  std::atomic<bool> closed_ { false };
+  std::atomic<bool> error_ { false };
+
+  FileDescriptor data_event_;
+  FileDescriptor space_event_;
+
+  // The free space (producer side) as at most two regions of the ring
+  std::vector<std::pair<char*, uint64_t>> free_regions();
+
+  // Publish `len` newly written bytes (producer) or release `len` consumed bytes (consumer)
+  void publish( uint64_t len );
+  void release( uint64_t len );
+
+  static void signal( FileDescriptor& event );
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "four_tuple.hh"
+#include "siphash.hh"
+#include "wrapping_integers.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+//! \brief SYN cookies (RFC 4987): the initial sequence numbers a listener picks when it keeps no state for a SYN
+//! \details A cookie's top 5 bits count PERIOD_MS intervals, its next 3 bits pick the peer's MSS from MSS_TABLE
+//! (rounded down), and its low 24 bits are a SipHash-2-4 MAC of the 4-tuple, the peer's ISN and the count, keyed
+//! with a 128-bit secret (so the cookies a peer collects don't give the secret away). The last ACK of the
+//! handshake acknowledges cookie + 1, so the listener can check that it answered that SYN, recently, and recover
+//! the MSS. There's no room for a window scale or SACK-permitted: a connection made from a cookie has neither.
+class SYNCookies
+{
+public:
+  static constexpr uint64_t PERIOD_MS = 64000; //!< A cookie is good for one or two periods (as in Linux)
+
+  //! The MSS values a cookie can carry (0: the SYN didn't say). A SYN with an MSS below MIN_MSS gets no cookie.
+  static constexpr std::array<uint16_t, 8> MSS_TABLE { 0, 536, 1000, 1220, 1440, 1460, 4312, 8960 };
+  static constexpr uint16_t MIN_MSS = MSS_TABLE[1];
+
+  explicit SYNCookies( const SipHashKey& secret ) : secret_( secret ) {}
+
+  //! The ISN for a SYN-ACK that answers a SYN (with the peer's `peer_isn` and `peer_mss`) at time `now_ms`, or
+  //! nothing if the SYN's MSS is too small for the table (rounding it down to "no MSS" would lift the limit)
+  std::optional<Wrap32> make( const FourTuple& tuple, Wrap32 peer_isn, uint16_t peer_mss, uint64_t now_ms ) const
+  {
+    if ( peer_mss != 0 and peer_mss < MIN_MSS ) {
+      return {};
+    }
+    size_t index = MSS_TABLE.size() - 1;
+    while ( MSS_TABLE[index] > peer_mss ) {
+      --index;
+    }
+    const uint64_t count = now_ms / PERIOD_MS;
+    return Wrap32 { static_cast<uint32_t>( ( count % COUNT_MODULUS ) << COUNT_SHIFT | index << MSS_SHIFT
+                                           | hash( tuple, peer_isn, count ) ) };
+  }
+
+  //! If `cookie` is one that make() gave for this connection, one period ago at most, the peer's MSS
+  std::optional<uint16_t> check( const FourTuple& tuple, Wrap32 peer_isn, Wrap32 cookie, uint64_t now_ms ) const
+  {
+    const uint32_t raw = raw_value( cookie );
+    const uint64_t now_count = now_ms / PERIOD_MS;
+    // the latest count that matches the cookie's top bits
+    const uint64_t age = ( now_count - ( raw >> COUNT_SHIFT ) ) % COUNT_MODULUS;
+    if ( age > 1 or age > now_count ) {
+      return {};
+    }
+    if ( ( raw & HASH_MASK ) != hash( tuple, peer_isn, now_count - age ) ) {
+      return {};
+    }
+    return MSS_TABLE[raw >> MSS_SHIFT & ( MSS_TABLE.size() - 1 )];
+  }
+
+private:
+  static constexpr unsigned COUNT_SHIFT = 27;
+  static constexpr uint64_t COUNT_MODULUS = 32;
+  static constexpr unsigned MSS_SHIFT = 24;
+  static constexpr uint32_t HASH_MASK = ( 1 << MSS_SHIFT ) - 1;
+
+  SipHashKey secret_;
+
+  static uint32_t raw_value( Wrap32 x ) { return static_cast<uint32_t>( x.unwrap( Wrap32 { 0 }, 0 ) ); }
+
+  uint32_t hash( const FourTuple& tuple, Wrap32 peer_isn, uint64_t count ) const
+  {
+    // the message: local IP, remote IP, local port, remote port, peer ISN, count (little-endian)
+    std::array<char, 24> message {};
+    size_t pos = 0;
+    const auto append = [&]( uint64_t value, size_t bytes ) {
+      for ( size_t i = 0; i < bytes; ++i ) {
+        message.at( pos++ ) = static_cast<char>( value >> ( 8 * i ) );
+      }
+    };
+    append( tuple.local_ip, 4 );
+    append( tuple.remote_ip, 4 );
+    append( tuple.local_port, 2 );
+    append( tuple.remote_port, 2 );
+    append( raw_value( peer_isn ), 4 );
+    append( count, 8 );
+    return static_cast<uint32_t>( siphash24( secret_, std::string_view { message.data(), message.size() } ) )
+           & HASH_MASK;
+  }
+};
@@ -1,8 +1,12 @@
 #pragma once
 
 #include "address.hh"
+#include "byte_stream.hh"
+#include "congestion_controller.hh"
+#include "reassembler.hh"
 #include "wrapping_integers.hh"
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <optional>
@@ -11,15 +15,85 @@
 class TCPConfig
 {
 public:
-  static constexpr size_t DEFAULT_CAPACITY = 64000; //!< Default capacity
-  static constexpr size_t MAX_PAYLOAD_SIZE = 1000;  //!< Conservative max payload size for real Internet
-  static constexpr uint16_t TIMEOUT_DFLT = 1000;    //!< Default re-transmit timeout is 1 second
-  static constexpr unsigned MAX_RETX_ATTEMPTS = 8;  //!< Maximum re-transmit attempts before giving up
+  static constexpr size_t DEFAULT_CAPACITY = 64000;        //!< Default capacity
+  static constexpr size_t MAX_PAYLOAD_SIZE = 1000;         //!< Conservative max payload size for real Internet
+  static constexpr uint16_t TIMEOUT_DFLT = 1000;           //!< Default re-transmit timeout is 1 second
+  static constexpr unsigned MAX_RETX_ATTEMPTS = 8;         //!< Maximum re-transmit attempts before giving up
+  static constexpr size_t SPILL_THRESHOLD_DFLT = 64 << 20; //!< Streams larger than 64 MiB spill to disk
+  static constexpr uint64_t RTO_MIN_DFLT = 200;            //!< Floor for the computed RTO (as in Linux)
+  static constexpr uint64_t RTO_MAX_DFLT = 60000;          //!< Ceiling for the RTO, including backoff
+  static constexpr uint64_t DUP_ACK_THRESHOLD = 3;         //!< Duplicate ACKs that trigger a fast retransmit
+  static constexpr size_t MAX_GSO_PAYLOAD_SIZE = 64000;    //!< Largest message with segmentation offload
+  static constexpr size_t HEADERS_SIZE = 40;               //!< IPv4 and TCP headers, without options
+  static constexpr size_t DEFAULT_MTU = 1040;              //!< MAX_PAYLOAD_SIZE plus the headers
+  static constexpr size_t MTU_PROBE_STEP = 32;             //!< PLPMTUD stops when the search range is smaller
+  static constexpr uint64_t ACK_DELAY_DFLT = 40;           //!< Longest a delayed ACK waits (as in Linux)
 
   uint16_t rt_timeout = TIMEOUT_DFLT;      //!< Initial value of the retransmission timeout, in milliseconds
   size_t recv_capacity = DEFAULT_CAPACITY; //!< Receive capacity, in bytes
   size_t send_capacity = DEFAULT_CAPACITY; //!< Sender capacity, in bytes
   Wrap32 isn { 137 };                      //!< Default initial sequence number
+  bool adaptive_rto = true;                //!< Compute the RTO from measured RTTs (RFC 6298)
+  uint64_t rto_min = RTO_MIN_DFLT;         //!< Floor for the computed RTO, in milliseconds
+  uint64_t rto_max = RTO_MAX_DFLT;         //!< Ceiling for the computed and backed-off RTO, in milliseconds
+
+  //! How the inbound stream buffers its bytes (Chunked hands reassembled payloads to the reader without a copy)
+  ByteStream::Storage recv_storage = ByteStream::Storage::Ring;
+
+  //! A send or receive stream whose capacity exceeds this keeps only this many bytes in memory, and spills the
+  //! rest of its backlog to a memory-mapped temporary file
+  size_t spill_threshold = SPILL_THRESHOLD_DFLT;
+
+  //! Most memory the inbound Reassembler may hold for out-of-order bytes before it evicts the furthest ones
+  uint64_t reassembly_memory_limit = Reassembler::UNLIMITED;
+
+  //! Congestion controller for the outbound stream (None sends whatever the receiver's window allows)
+  CongestionControl congestion_control = CongestionControl::None;
+
+  //! Segmentation offload: the sender emits messages of up to MAX_GSO_PAYLOAD_SIZE bytes, and the datagram
+  //! adapter splits each into segments on the way out
+  bool segmentation_offload = false;
+
+  //! MTU of the interface. Segments carry at most mss() bytes of payload, advertised to the peer in the SYN,
+  //! and no more than the peer advertises in its SYN
+  size_t mtu = DEFAULT_MTU;
+
+  //! Packetization-layer path MTU discovery (RFC 4821): start with MAX_PAYLOAD_SIZE segments, and send larger
+  //! probe segments to find out whether the path carries up to mss() bytes
+  bool path_mtu_discovery = false;
+
+  //! Window scaling (RFC 7323): offer a window scale in the SYN, so a receive capacity above 64 KiB can be
+  //! advertised if the peer offers one too
+  bool window_scaling = true;
+
+  //! Receive-buffer autotuning: the inbound stream starts with initial_recv_capacity() bytes, and grows toward
+  //! twice what the application reads in a round trip, up to recv_capacity
+  bool recv_autotuning = false;
+
+  //! Delayed ACKs (RFC 1122): acknowledge every second full-sized segment's worth of data, or ack_delay ms after
+  //! the first, unless a segment is out of order, fills a gap, or carries a SYN or FIN (acknowledged at once)
+  bool delayed_ack = false;
+  uint64_t ack_delay = ACK_DELAY_DFLT; //!< Longest a delayed ACK waits, in milliseconds
+
+  //! SYN cookies, for a listener (RFC 4987): once its half-open table is full, answer a SYN with a SYN-ACK whose
+  //! ISN encodes what the connection needs, instead of dropping it, and keep no state until the last ACK of the
+  //! handshake brings the ISN back. Such a connection has no window scaling or selective acknowledgments.
+  bool syn_cookies = false;
+
+  //! The inbound stream's capacity when the connection starts
+  size_t initial_recv_capacity() const
+  {
+    return recv_autotuning ? std::min( recv_capacity, DEFAULT_CAPACITY ) : recv_capacity;
+  }
+
+  //! The largest payload that fits in one datagram on the interface
+  size_t mss() const { return mtu - HEADERS_SIZE; }
+
+  //! The storage for a stream of `capacity` bytes: Spill above the threshold, `in_memory` otherwise
+  ByteStream::Storage storage_for( size_t capacity, ByteStream::Storage in_memory ) const
+  {
+    return capacity > spill_threshold ? ByteStream::Storage::Spill : in_memory;
+  }
 };
 
 //! Config for classes derived from FdAdapter
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "address.hh"
+#include "eventloop.hh"
+#include "file_descriptor.hh"
+#include "socket.hh"
+#include "tcp_config.hh"
+#include "tcp_stack.hh"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+//! \brief A listening TCP socket: it accepts any number of connections, one stream socket for each, and keeps
+//! listening until it is destroyed
+//! \details A TCPListener owns a TCPStackLoop, run by a thread of its own (like the TCPPeer thread of a
+//! TCPMinnowSocket). The stack listens on one port with a bounded half-open table and a bounded accept queue
+//! (see TCPStack::listen). Each connection that finishes its handshake is handed to the owner, through
+//! accept(), as one end of an AF_UNIX socket pair; the listener's thread moves bytes between the other end
+//! and the connection's TCPPeer. Shutting down the owner's end for writing (or closing it) finishes the
+//! connection's outbound stream, and the owner reads EOF once the remote peer has finished its own.
+class TCPListener
+{
+public:
+  //! Listen on `address` (an IPv4 address and port), on a file descriptor that carries IPv4 datagrams
+  TCPListener( FileDescriptor&& datagram_fd,
+               const Address& address,
+               const TCPConfig& cfg,
+               size_t syn_backlog = TCPStack::DEFAULT_BACKLOG,
+               size_t accept_backlog = TCPStack::DEFAULT_BACKLOG );
+
+  //! Wait for the next connection (a runtime_error if the listener has stopped)
+  LocalStreamSocket accept();
+
+  //! Stop listening. Connections that are still open are left unfinished.
+  ~TCPListener();
+
+  //! \name
+  //! This object cannot be safely moved or copied, since it is in use by two threads simultaneously
+
+  //!@{
+  TCPListener( const TCPListener& ) = delete;
+  TCPListener( TCPListener&& ) = delete;
+  TCPListener& operator=( const TCPListener& ) = delete;
+  TCPListener& operator=( TCPListener&& ) = delete;
+  //!@}
+
+private:
+  //! One accepted connection, and the listener thread's end of its socket pair
+  struct Bridge
+  {
+    TCPStack::ConnectionID id;
+    LocalStreamSocket socket;
+    bool outbound_shutdown {}; // has the owner finished writing?
+    bool inbound_shutdown {};  // has everything the peer sent been written to the owner?
+    std::vector<EventLoop::RuleHandle> rules {};
+  };
+
+  TCPStackLoop loop_;
+  uint16_t port_;
+  size_t accept_backlog_;
+  size_t outbound_category_;
+  size_t inbound_category_;
+  std::vector<std::unique_ptr<Bridge>> bridges_ {};
+
+  //! \name
+  //! Shared with the owner thread
+
+  //!@{
+  std::mutex mutex_ {};
+  std::condition_variable accepted_ {};
+  std::queue<LocalStreamSocket> sockets_ {}; // accepted connections, waiting for accept()
+  bool stopped_ {};                           // has the listener thread exited?
+  std::atomic_bool abort_ { false };          // set by the owner to stop the listener thread
+  //!@}
+
+  std::thread thread_ {};
+
+  //! Main loop of the listener thread
+  void serve();
+
+  //! Take established connections from the stack, while the owner's queue has room
+  void accept_connections();
+
+  //! Add the event loop rules that move a connection's bytes to and from the owner's socket
+  void add_bridge( TCPStack::ConnectionID id, LocalStreamSocket&& socket );
+
+  //! Close the connections whose streams are both done, and forget their bridges
+  void finish_bridges();
+};
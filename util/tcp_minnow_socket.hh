@@ -4,12 +4,14 @@
 #include "eventloop.hh"
 #include "file_descriptor.hh"
 #include "socket.hh"
+#include "spsc_byte_stream.hh"
 #include "tcp_config.hh"
 #include "tcp_peer.hh"
 #include "tuntap_adapter.hh"
 
 #include <atomic>
 #include <cstdint>
+#include <memory>
 #include <optional>
 #include <thread>
 #include <vector>
@@ -58,6 +60,19 @@ public:
   // Return peer address from underlying datagram adapter
   const Address& peer_address() const { return _datagram_adapter.config().destination; }
 
+  //! Exchange bytes with the TCPPeer thread through two shared SPSCByteStreams instead of the socket pair.
+  //! Must be called before connect() or listen_and_accept(); afterwards the owner writes into
+  //! outbound_stream() and reads from inbound_stream() instead of using this socket's file descriptor.
+  void enable_direct_streams();
+
+  //! \name
+  //! Streams shared with the TCPPeer thread (only after enable_direct_streams() and connect/listen)
+
+  //!@{
+  SPSCByteStream& outbound_stream();
+  SPSCByteStream& inbound_stream();
+  //!@}
+
 protected:
   //! Adapter to underlying datagram socket (e.g., UDP or IP)
   AdaptT _datagram_adapter;
@@ -66,6 +81,21 @@ private:
   //! Stream socket for reads and writes between owner and TCP thread
   LocalStreamSocket _thread_data;
 
+  //! Use the shared streams below instead of _thread_data?
+  bool _direct_streams { false };
+
+  //! \name
+  //! Lock-free streams shared with the owner thread (only in direct mode)
+
+  //!@{
+  std::unique_ptr<SPSCByteStream> _direct_outbound {};
+  std::unique_ptr<SPSCByteStream> _direct_inbound {};
+  //!@}
+
+  //! Set up the event loop rules that move bytes between the owner and the TCPPeer
+  void _initialize_socket_pair_rules();
+  void _initialize_direct_stream_rules();
+
   //! Set up the TCPPeer and the event loop
   void _initialize_TCP( const TCPConfig& config );
 
@@ -118,6 +148,11 @@ using LossyTCPOverIPv4MinnowSocket = TCPMinnowSocket<LossyFdAdapter<TCPOverIPv4O
 //!   and [accept(2)](\ref man2::accept)
 //! - if TCPMinnowSocket is destructed while a TCP connection is open, the connection is
 //!   immediately terminated with a RST (call `wait_until_closed` to avoid this)
+//!
+//! By default the two threads exchange application bytes through an AF_UNIX socket pair, so every byte is
+//! copied through the kernel twice. After enable_direct_streams(), they share a pair of lock-free
+//! SPSCByteStreams instead: the owner pushes into outbound_stream() and pops from inbound_stream(), and the
+//! TCPPeer thread moves bytes between those rings and the TCPPeer's own streams, waking up on eventfds.
 
 //! Helper class that makes a TCPOverIPv4MinnowSocket behave more like a (kernel) TCPSocket
 class CS144TCPSocket : public TCPOverIPv4MinnowSocket
@@ -4,6 +4,7 @@
 #include "parser.hh"
 #include "tun.hh"
 
+#include <algorithm>
 #include <cstddef>
 #include <exception>
 #include <iostream>
@@ -15,7 +16,8 @@
 #include <unistd.h>
 #include <utility>
 
-static constexpr size_t TCP_TICK_MS = 10;
+// The longest _tcp_loop waits for an event (when the TCPPeer has no timer due sooner) before it looks at _abort
+static constexpr uint64_t TCP_MAX_WAIT_MS = 100;
 
 inline uint64_t timestamp_ms()
 {
@@ -30,7 +32,11 @@ void TCPMinnowSocket<AdaptT>::_tcp_loop( const std::function<bool()>& condition
 {
   auto base_time = timestamp_ms();
   while ( condition() ) {
-    auto ret = _eventloop.wait_next_event( TCP_TICK_MS );
+    uint64_t timeout = TCP_MAX_WAIT_MS;
+    if ( _tcp.has_value() ) {
+      timeout = std::min( timeout, _tcp.value().ms_until_next_timer().value_or( TCP_MAX_WAIT_MS ) );
+    }
+    auto ret = _eventloop.wait_next_event( static_cast<int>( timeout ) );
     if ( ret == EventLoop::Result::Exit or _abort ) {
       break;
     }
@@ -99,16 +105,25 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
     },
     [&] { return _tcp->active(); } );
 
+  if ( _direct_streams ) {
+    _direct_outbound = std::make_unique<SPSCByteStream>( config.send_capacity );
+    _direct_inbound = std::make_unique<SPSCByteStream>( config.recv_capacity );
+    _initialize_direct_stream_rules();
+  } else {
+    _initialize_socket_pair_rules();
+  }
+}
+
+template<TCPDatagramAdapter AdaptT>
+void TCPMinnowSocket<AdaptT>::_initialize_socket_pair_rules()
+{
   // rule 2: read from pipe into outbound buffer
   _eventloop.add_rule(
     "push bytes to TCPPeer",
     _thread_data,
     Direction::In,
     [&] {
-      std::string data;
-      data.resize( _tcp->outbound_writer().available_capacity() );
-      _thread_data.read( data );
-      _tcp->outbound_writer().push( move( data ) );
+      _tcp->outbound_writer().read_from( _thread_data );
 
       if ( _thread_data.eof() ) {
         _tcp->outbound_writer().close();
@@ -146,11 +161,7 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
       // Write from the inbound_stream into
       // the pipe, handling the possibility of a partial
       // write (i.e., only pop what was actually written).
-      if ( inbound.bytes_buffered() ) {
-        const std::string_view buffer = inbound.peek();
-        const auto bytes_written = _thread_data.write( buffer );
-        inbound.pop( bytes_written );
-      }
+      inbound.write_to( _thread_data );
 
       if ( inbound.is_finished() or inbound.has_error() ) {
         _thread_data.shutdown( SHUT_WR );
@@ -173,6 +184,91 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
     } );
 }
 
+template<TCPDatagramAdapter AdaptT>
+void TCPMinnowSocket<AdaptT>::_initialize_direct_stream_rules()
+{
+  // rule 2: move bytes from the shared outbound stream into the TCPPeer's outbound buffer
+  _eventloop.add_rule(
+    "push bytes to TCPPeer",
+    [&] {
+      Writer& outbound = _tcp->outbound_writer();
+      // copied straight from the shared ring into the TCPPeer's (no temporary string)
+      while ( outbound.available_capacity() > 0 and _direct_outbound->bytes_buffered() > 0 ) {
+        _direct_outbound->pop( outbound.push_copy( _direct_outbound->peek() ) );
+      }
+
+      if ( _direct_outbound->has_error() ) {
+        std::cerr << "DEBUG: minnow outbound stream had error.\n";
+        outbound.set_error();
+        _outbound_shutdown = true;
+      } else if ( _direct_outbound->is_finished() ) {
+        outbound.close();
+        _outbound_shutdown = true;
+
+        // debugging output:
+        std::cerr << "DEBUG: minnow outbound stream to " << _datagram_adapter.config().destination.to_string()
+                  << " finished (" << _tcp.value().sender().sequence_numbers_in_flight() << " seqno"
+                  << ( _tcp.value().sender().sequence_numbers_in_flight() == 1 ? "" : "s" )
+                  << " still in flight).\n";
+      }
+
+      _tcp->push( [&]( auto x ) { _datagram_adapter.write( x ); } );
+    },
+    [&] {
+      return _tcp->active() and ( not _outbound_shutdown )
+             and ( ( _direct_outbound->bytes_buffered() and _tcp->outbound_writer().available_capacity() > 0 )
+                   or _direct_outbound->is_finished() or _direct_outbound->has_error() );
+    } );
+
+  // rule 3: move bytes from the TCPPeer's inbound buffer into the shared inbound stream
+  _eventloop.add_rule(
+    "read bytes from inbound stream",
+    [&] {
+      Reader& inbound = _tcp->inbound_reader();
+      if ( _direct_inbound->has_error() ) {
+        // the owner has stopped reading; discard, so the connection can still finish
+        inbound.pop( inbound.bytes_buffered() );
+      }
+      while ( inbound.bytes_buffered() and _direct_inbound->available_capacity() > 0 ) {
+        inbound.pop( _direct_inbound->push( inbound.peek() ) );
+      }
+
+      if ( inbound.is_finished() or inbound.has_error() ) {
+        if ( inbound.has_error() ) {
+          _direct_inbound->set_error();
+        }
+        _direct_inbound->close();
+        _inbound_shutdown = true;
+
+        // debugging output:
+        std::cerr << "DEBUG: minnow inbound stream from " << _datagram_adapter.config().destination.to_string()
+                  << " finished " << ( inbound.has_error() ? "uncleanly.\n" : "cleanly.\n" );
+      }
+    },
+    [&] {
+      const Reader& inbound = _tcp->inbound_reader();
+      return ( not _inbound_shutdown )
+             and ( ( inbound.bytes_buffered()
+                     and ( _direct_inbound->available_capacity() > 0 or _direct_inbound->has_error() ) )
+                   or inbound.is_finished() or inbound.has_error() );
+    } );
+
+  // The rules above only need waking up when the owner makes progress they could be waiting for.
+  _eventloop.add_rule(
+    "owner pushed to outbound stream",
+    _direct_outbound->data_event(),
+    Direction::In,
+    [&] { SPSCByteStream::clear_event( _direct_outbound->data_event() ); },
+    [&] { return _tcp->active() and not _outbound_shutdown; } );
+
+  _eventloop.add_rule(
+    "owner popped from inbound stream",
+    _direct_inbound->space_event(),
+    Direction::In,
+    [&] { SPSCByteStream::clear_event( _direct_inbound->space_event() ); },
+    [&] { return _tcp->active() and not _inbound_shutdown; } );
+}
+
 //! \brief Call [socketpair](\ref man2::socketpair) and return connected Unix-domain sockets of specified type
 //! \param[in] type is the type of AF_UNIX sockets to create (e.g., SOCK_SEQPACKET)
 //! \returns a std::pair of connected sockets
@@ -206,10 +302,41 @@ TCPMinnowSocket<AdaptT>::~TCPMinnowSocket()
   }
 }
 
+template<TCPDatagramAdapter AdaptT>
+void TCPMinnowSocket<AdaptT>::enable_direct_streams()
+{
+  if ( _tcp ) {
+    throw std::runtime_error( "enable_direct_streams() with TCPConnection already initialized" );
+  }
+  _direct_streams = true;
+}
+
+template<TCPDatagramAdapter AdaptT>
+SPSCByteStream& TCPMinnowSocket<AdaptT>::outbound_stream()
+{
+  if ( not _direct_outbound ) {
+    throw std::runtime_error( "outbound_stream() requires enable_direct_streams() and a connection" );
+  }
+  return *_direct_outbound;
+}
+
+template<TCPDatagramAdapter AdaptT>
+SPSCByteStream& TCPMinnowSocket<AdaptT>::inbound_stream()
+{
+  if ( not _direct_inbound ) {
+    throw std::runtime_error( "inbound_stream() requires enable_direct_streams() and a connection" );
+  }
+  return *_direct_inbound;
+}
+
 template<TCPDatagramAdapter AdaptT>
 void TCPMinnowSocket<AdaptT>::wait_until_closed()
 {
   shutdown( SHUT_RDWR );
+  if ( _direct_outbound ) {
+    _direct_outbound->close();
+    _direct_inbound->set_error(); // tell the TCPPeer thread that nobody is reading any more
+  }
   if ( _tcp_thread.joinable() ) {
     std::cerr << "DEBUG: minnow waiting for clean shutdown... ";
     _tcp_thread.join();
@@ -282,6 +409,10 @@ void TCPMinnowSocket<AdaptT>::_tcp_main()
     }
     _tcp_loop( [] { return true; } );
     shutdown( SHUT_RDWR );
+    if ( _direct_inbound ) {
+      _direct_inbound->close();
+      _direct_outbound->set_error(); // the owner can no longer push
+    }
     if ( not _tcp.value().active() ) {
       std::cerr << "DEBUG: minnow TCP connection finished "
                 << ( _tcp->inbound_reader().has_error() ? "uncleanly.\n" : "cleanly.\n" );
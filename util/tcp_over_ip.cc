@@ -1,16 +1,24 @@
 #include "tcp_over_ip.hh"
 
+#include "checksum.hh"
 #include "ipv4_datagram.hh"
 #include "ipv4_header.hh"
 #include "parser.hh"
+#include "tcp_config.hh"
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <stdexcept>
+#include <string_view>
 #include <unistd.h>
 #include <utility>
 
 using namespace std;
 
+// where the sequence number and checksum sit in a serialized TCP header
+static constexpr size_t TCP_SEQNO_OFFSET = 4;
+static constexpr size_t TCP_CHECKSUM_OFFSET = 16;
+
 //! \details This function attempts to parse a TCP segment from
 //! the IP datagram's payload.
 //!
@@ -73,24 +81,122 @@ optional<TCPMessage> TCPOverIPv4Adapter::unwrap_tcp_in_ip( const InternetDatagra
 }
 
 //! Takes a TCP segment, sets port numbers as necessary, and wraps it in an IPv4 datagram
-//! \param[in] seg is the TCP segment to convert
-InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip( const TCPMessage& msg )
+//! \param[in] msg is the TCP segment to convert
+//! \param[in] tuple gives the addresses and port numbers
+InternetDatagram TCPOverIPv4Adapter::wrap_segment( const TCPMessage& msg, const FourTuple& tuple )
 {
   TCPSegment seg { .message = msg };
   // set the port numbers in the TCP segment
-  seg.udinfo.src_port = config().source.port();
-  seg.udinfo.dst_port = config().destination.port();
+  seg.udinfo.src_port = tuple.local_port;
+  seg.udinfo.dst_port = tuple.remote_port;
 
-  // create an Internet Datagram and set its addresses and length
+  // create an Internet Datagram and set its addresses
   InternetDatagram ip_dgram;
-  ip_dgram.header.src = config().source.ipv4_numeric();
-  ip_dgram.header.dst = config().destination.ipv4_numeric();
-  ip_dgram.header.len = ip_dgram.header.hlen * 4 + 20 /* tcp header len */ + seg.message.sender.payload.size();
+  ip_dgram.header.src = tuple.local_ip;
+  ip_dgram.header.dst = tuple.remote_ip;
 
-  // set payload, calculating TCP checksum using information from IP header
-  seg.compute_checksum( ip_dgram.header.pseudo_checksum() );
-  ip_dgram.header.compute_checksum();
+  // set payload and length (the TCP header is longer than 20 bytes when it carries options), then fill in the
+  // TCP checksum, calculated using information from the IP header
   ip_dgram.payload = serialize( seg );
+  size_t tcp_length = 0;
+  for ( const auto& piece : ip_dgram.payload ) {
+    tcp_length += piece.size();
+  }
+  ip_dgram.header.len = ip_dgram.header.hlen * 4 + tcp_length;
+
+  InternetChecksum check { ip_dgram.header.pseudo_checksum() };
+  check.add( ip_dgram.payload );
+  const uint16_t cksum = check.value();
+  ip_dgram.payload.front().at( TCP_CHECKSUM_OFFSET ) = static_cast<char>( cksum >> 8 );
+  ip_dgram.payload.front().at( TCP_CHECKSUM_OFFSET + 1 ) = static_cast<char>( cksum );
+  ip_dgram.header.compute_checksum();
 
   return ip_dgram;
 }
+
+vector<InternetDatagram> TCPOverIPv4Adapter::wrap_tcp_in_ip( const TCPMessage& msg )
+{
+  return wrap_tcp_in_ip( msg,
+                         { .local_ip = config().source.ipv4_numeric(),
+                           .remote_ip = config().destination.ipv4_numeric(),
+                           .local_port = config().source.port(),
+                           .remote_port = config().destination.port() } );
+}
+
+//! \details A message with more payload than its segment size (with TCPConfig::segmentation_offload, or a
+//! retransmission after the segment size shrank) is split into segments of that size. The first segment keeps
+//! the SYN and the last one the FIN. Every segment in between has the same TCP header except for the sequence
+//! number and checksum, and the same IP header except for the last one's length, so both headers are serialized
+//! once and patched for each segment: only the payload is checksummed per segment.
+vector<InternetDatagram> TCPOverIPv4Adapter::wrap_tcp_in_ip( const TCPMessage& msg, const FourTuple& tuple )
+{
+  const TCPSenderMessage& sender = msg.sender;
+  const size_t mss = sender.segment_size ? sender.segment_size : TCPConfig::MAX_PAYLOAD_SIZE;
+  if ( sender.payload.size() <= mss ) {
+    return { wrap_segment( msg, tuple ) };
+  }
+
+  const size_t count = ( sender.payload.size() + mss - 1 ) / mss;
+  vector<InternetDatagram> datagrams;
+  datagrams.reserve( count );
+
+  // the headers shared by the segments without SYN or FIN, serialized with an empty payload
+  const InternetDatagram empty
+    = wrap_segment( { { sender.seqno, false, {}, false, sender.RST }, msg.receiver }, tuple );
+  const string& header_template = empty.payload.front();
+
+  IPv4Header full_header = empty.header;
+  full_header.len += mss;
+  full_header.compute_checksum();
+
+  // the template's contribution to the TCP checksum, without its sequence number and checksum fields
+  uint32_t first_seqno = 0;
+  for ( size_t byte = 0; byte < 4; ++byte ) {
+    first_seqno = first_seqno << 8 | static_cast<uint8_t>( header_template[TCP_SEQNO_OFFSET + byte] );
+  }
+  string zeroed = header_template;
+  fill_n( zeroed.begin() + TCP_SEQNO_OFFSET, 4, '\0' );
+  fill_n( zeroed.begin() + TCP_CHECKSUM_OFFSET, 2, '\0' );
+
+  const string_view payload = sender.payload;
+  for ( size_t i = 0; i < count; ++i ) {
+    const string_view chunk = payload.substr( i * mss, mss );
+    const auto offset = static_cast<uint32_t>( ( i > 0 and sender.SYN ) + i * mss );
+    const bool last = i + 1 == count;
+
+    if ( ( i == 0 and sender.SYN ) or ( last and sender.FIN ) ) {
+      const TCPSenderMessage segment {
+        sender.seqno + offset, i == 0 and sender.SYN, string { chunk }, last and sender.FIN, sender.RST,
+        sender.SACK_permitted, sender.MSS };
+      datagrams.push_back( wrap_segment( { segment, msg.receiver }, tuple ) );
+      continue;
+    }
+
+    InternetDatagram& dgram = datagrams.emplace_back();
+    dgram.header = full_header;
+    if ( chunk.size() < mss ) {
+      dgram.header.len = empty.header.len + chunk.size();
+      dgram.header.cksum = InternetChecksum::patch( full_header.cksum, full_header.len, dgram.header.len );
+    }
+
+    string header = header_template;
+    const uint32_t raw_seqno = first_seqno + offset;
+    for ( size_t byte = 0; byte < 4; ++byte ) {
+      header[TCP_SEQNO_OFFSET + byte] = static_cast<char>( raw_seqno >> ( 24 - 8 * byte ) );
+    }
+
+    InternetChecksum check { dgram.header.pseudo_checksum() };
+    check.add( zeroed );
+    check.add( string_view { header }.substr( TCP_SEQNO_OFFSET, 4 ) );
+    check.add( chunk );
+    const uint16_t cksum = check.value();
+    header[TCP_CHECKSUM_OFFSET] = static_cast<char>( cksum >> 8 );
+    header[TCP_CHECKSUM_OFFSET + 1] = static_cast<char>( cksum );
+
+    dgram.payload.reserve( 2 );
+    dgram.payload.push_back( move( header ) );
+    dgram.payload.emplace_back( chunk );
+  }
+
+  return datagrams;
+}
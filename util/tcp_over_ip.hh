@@ -1,10 +1,12 @@
 #pragma once
 
 #include "fd_adapter.hh"
+#include "four_tuple.hh"
 #include "ipv4_datagram.hh"
 #include "tcp_segment.hh"
 
 #include <optional>
+#include <vector>
 
 //! \brief A converter from TCP segments to serialized IPv4 datagrams
 class TCPOverIPv4Adapter : public FdAdapterBase
@@ -12,5 +14,13 @@ class TCPOverIPv4Adapter : public FdAdapterBase
 public:
   std::optional<TCPMessage> unwrap_tcp_in_ip( const InternetDatagram& ip_dgram );
 
-  InternetDatagram wrap_tcp_in_ip( const TCPMessage& msg );
+  //! One datagram per `msg.sender.segment_size` bytes of payload (a single one for an ordinary segment)
+  std::vector<InternetDatagram> wrap_tcp_in_ip( const TCPMessage& msg );
+
+  //! The same, for any connection: from `tuple`'s local address and port to its remote ones
+  static std::vector<InternetDatagram> wrap_tcp_in_ip( const TCPMessage& msg, const FourTuple& tuple );
+
+private:
+  //! Wraps one segment, however large its payload
+  static InternetDatagram wrap_segment( const TCPMessage& msg, const FourTuple& tuple );
 };
@@ -7,6 +7,8 @@
 #include "tcp_sender.hh"
 #include "tcp_sender_message.hh"
 
+#include <algorithm>
+#include <cstdint>
 #include <functional>
 #include <optional>
 
@@ -31,7 +33,13 @@ public:
   void tick( uint64_t t, const TransmitFunction& transmit )
   {
     cumulative_time_ += t;
+    receiver_.tick( t );
     sender_.tick( t, make_send( transmit ) );
+
+    // A delayed ACK that has waited long enough (unless it just went out with a retransmission)
+    if ( ack_deadline_.has_value() and cumulative_time_ >= ack_deadline_.value() ) {
+      send( sender_.make_empty_message(), transmit );
+    }
   }
   bool has_ackno() const { return receiver_.send().ackno.has_value(); }
 
@@ -47,6 +55,29 @@ public:
     return ( not any_errors ) and ( sender_active or receiver_active or lingering );
   }
 
+  /* How long until tick() has something to do: retransmit, send paced or delayed-ACK segments, or stop
+   * lingering. (Nothing if only a segment from the peer, or the application, can give it work.) */
+  std::optional<uint64_t> ms_until_next_timer() const
+  {
+    if ( not active() ) {
+      return {};
+    }
+    std::optional<uint64_t> next = sender_.ms_until_next_timer();
+    const auto consider = [&]( uint64_t deadline ) {
+      const uint64_t ms = deadline > cumulative_time_ ? deadline - cumulative_time_ : 0;
+      next = std::min( next.value_or( UINT64_MAX ), ms );
+    };
+    if ( ack_deadline_.has_value() ) {
+      consider( ack_deadline_.value() );
+    }
+    const bool streams_finished = receiver_.writer().is_closed() and sender_.reader().is_finished()
+                                  and sender_.sequence_numbers_in_flight() == 0;
+    if ( linger_after_streams_finish_ and streams_finished ) {
+      consider( time_of_last_receipt_ + 10UL * cfg_.rt_timeout );
+    }
+    return next;
+  }
+
   void receive( TCPMessage msg, const TransmitFunction& transmit )
   {
     if ( not active() ) {
@@ -56,26 +87,60 @@ public:
     // Record time in case this peer has to linger after streams finish.
     time_of_last_receipt_ = cumulative_time_;
 
-    // If SenderMessage occupies a sequence number, make sure to reply.
-    need_send_ |= ( msg.sender.sequence_length() > 0 );
+    // If SenderMessage occupies a sequence number, make sure to reply (now, or soon with delayed ACKs).
+    const bool occupies_seqno = msg.sender.sequence_length() > 0;
+    const uint64_t payload_size = msg.sender.payload.size();
 
     // If SenderMessage is a "keep-alive" (with intentionally invalid seqno), make sure to reply.
     // (N.B. orthodox TCP rules require a reply on any unacceptable segment.)
     const auto our_ackno = receiver_.send().ackno;
     need_send_ |= ( our_ackno.has_value() and msg.sender.seqno + 1 == our_ackno.value() );
 
+    // A segment that isn't the next one expected, or that fills a gap, is acknowledged at once, so the sender
+    // sees duplicate ACKs (and SACK blocks) without delay (RFC 5681). So is a SYN or a FIN.
+    const bool urgent = msg.sender.SYN or msg.sender.FIN or not our_ackno.has_value()
+                        or not( msg.sender.seqno == our_ackno.value() )
+                        or receiver_.reassembler().bytes_pending() > 0;
+
     // Did the inbound stream finish before the outbound stream? If so, no need to linger after streams finish.
     if ( receiver_.writer().is_closed() and not sender_.reader().is_finished() ) {
       linger_after_streams_finish_ = false;
     }
 
+    // The peer's SYN says how large a segment it can receive, and how its windows will be scaled.
+    // (The window in the SYN itself isn't scaled, so the scale applies from the next message on.)
+    std::optional<uint8_t> peer_window_scale;
+    if ( msg.sender.SYN ) {
+      sender_.set_peer_mss( msg.sender.MSS );
+      peer_window_scale = msg.sender.window_scale;
+      if ( msg.sender.MSS != 0 ) {
+        rcv_mss_ = std::min( rcv_mss_, uint64_t { msg.sender.MSS } );
+      }
+    }
+
     // Give incoming TCPSenderMessage to receiver.
     receiver_.receive( std::move( msg.sender ) );
 
     // Give incoming TCPReceiverMessage to sender.
-    sender_.receive( msg.receiver );
+    sender_.receive( msg.receiver, occupies_seqno );
+    if ( peer_window_scale.has_value() and receiver_.window_scale().has_value() ) {
+      sender_.set_peer_window_scale( peer_window_scale.value() );
+    }
+
+    // With delayed ACKs, the reply to in-order data waits until two full-sized segments' worth has arrived (or
+    // the timer), so a run of small segments isn't acknowledged every second one. As in Linux, a full-sized
+    // segment is the largest one seen so far (up to our MSS), since the peer may start below it (RFC 4821).
+    if ( occupies_seqno ) {
+      rcv_mss_ = std::max( rcv_mss_, std::min( payload_size, uint64_t { cfg_.mss() } ) );
+      unacknowledged_bytes_ += payload_size;
+      if ( not cfg_.delayed_ack or urgent or unacknowledged_bytes_ >= 2 * rcv_mss_ ) {
+        need_send_ = true;
+      } else if ( not ack_deadline_.has_value() ) {
+        ack_deadline_ = cumulative_time_ + cfg_.ack_delay;
+      }
+    }
 
-    // Send reply if needed.
+    // Send reply if needed. (Any segment sent carries the ACK.)
     push( transmit );
     if ( need_send_ ) {
       send( sender_.make_empty_message(), transmit );
@@ -85,19 +150,48 @@ public:
   // Testing interface
   const TCPReceiver& receiver() const { return receiver_; }
   const TCPSender& sender() const { return sender_; }
+  const ReassemblyStats& reassembly_stats() const { return receiver_.reassembly_stats(); }
 
 private:
   TCPConfig cfg_;
-  TCPSender sender_ { ByteStream { cfg_.send_capacity }, cfg_.isn, cfg_.rt_timeout };
-  TCPReceiver receiver_ { Reassembler { ByteStream { cfg_.recv_capacity } } };
+  TCPSender sender_ {
+    ByteStream { cfg_.send_capacity,
+                 cfg_.storage_for( cfg_.send_capacity, ByteStream::Storage::Ring ),
+                 cfg_.spill_threshold },
+    cfg_.isn,
+    cfg_.rt_timeout,
+    make_congestion_controller( cfg_.congestion_control, cfg_.mss() ),
+    cfg_.adaptive_rto ? std::optional<TCPSender::RTOBounds> { { cfg_.rto_min, cfg_.rto_max } } : std::nullopt,
+    { cfg_.mss(), cfg_.segmentation_offload, cfg_.path_mtu_discovery } };
+  TCPReceiver receiver_ {
+    Reassembler {
+      ByteStream { cfg_.initial_recv_capacity(),
+                   cfg_.storage_for( cfg_.recv_capacity, cfg_.recv_storage ),
+                   cfg_.spill_threshold },
+      Reassembler::Engine::Intervals,
+      cfg_.reassembly_memory_limit },
+    cfg_.window_scaling,
+    cfg_.recv_autotuning ? cfg_.recv_capacity : 0 };
 
   bool need_send_ {};
+  uint64_t unacknowledged_bytes_ {};        // in-order payload received since our last ACK (with delayed ACKs)
+  std::optional<uint64_t> ack_deadline_ {}; // when the delayed ACK goes out at the latest
+  // how large a full-sized segment from the peer is (for delayed ACKs)
+  uint64_t rcv_mss_ { std::min( uint64_t { cfg_.mss() }, TCPConfig::MAX_PAYLOAD_SIZE ) };
 
   void send( const TCPSenderMessage& sender_message, const TransmitFunction& transmit )
   {
     TCPMessage msg { sender_message, receiver_.send() };
+    if ( msg.sender.SYN ) {
+      // Offer our window scale, and don't scale the window in the SYN itself (RFC 7323).
+      msg.sender.window_scale = receiver_.window_scale();
+      msg.receiver.window_size = static_cast<uint16_t>(
+        std::min( receiver_.writer().available_capacity(), static_cast<uint64_t>( UINT16_MAX ) ) );
+    }
     transmit( std::move( msg ) );
     need_send_ = false;
+    unacknowledged_bytes_ = 0;
+    ack_deadline_.reset();
   }
 
   bool linger_after_streams_finish_ { true }; // one peer may need to linger to make sure all closure conditions met
@@ -2,26 +2,41 @@
 
 #include "wrapping_integers.hh"
 
+#include <cstddef>
 #include <optional>
+#include <vector>
 
 /*
  * The TCPReceiverMessage structure contains the information sent from a TCP receiver to its sender.
  *
- * It contains three fields:
+ * It contains four fields:
  *
  * 1) The acknowledgment number (ackno): the *next* sequence number needed by the TCP Receiver.
  *    This is an optional field that is empty if the TCPReceiver hasn't yet received the Initial Sequence Number.
  *
  * 2) The window size. This is the number of sequence numbers that the TCP receiver is interested
  *    to receive, starting from the ackno if present. The maximum value is 65,535 (UINT16_MAX from
- *    the <cstdint> header).
+ *    the <cstdint> header), unless window scaling (RFC 7323) was negotiated in the SYNs: then the window is
+ *    this value shifted left by the receiver's window scale.
  *
  * 3) The RST (reset) flag. If set, the stream has suffered an error and the connection should be aborted.
+ *
+ * 4) Selective acknowledgments (RFC 2018): up to four blocks of sequence numbers that arrived beyond the ackno,
+ *    the one with the most recently received segment first. Only sent if the peer's SYN permitted SACK.
  */
 
+struct SACKBlock
+{
+  Wrap32 begin; // first sequence number in the block
+  Wrap32 end;   // sequence number just past the block
+};
+
 struct TCPReceiverMessage
 {
+  static constexpr size_t MAX_SACK_BLOCKS = 4; // as many as fit in the TCP header's 40 bytes of options
+
   std::optional<Wrap32> ackno {};
   uint16_t window_size {};
   bool RST {};
+  std::vector<SACKBlock> sack_blocks {};
 };
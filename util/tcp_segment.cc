@@ -2,12 +2,73 @@
 #include "checksum.hh"
 #include "wrapping_integers.hh"
 
+#include <algorithm>
 #include <cstddef>
 
 static constexpr uint32_t TCPHeaderMinLen = 5; // 32-bit words
 
+// TCP option kinds
+static constexpr uint8_t TCPOptionEnd = 0;
+static constexpr uint8_t TCPOptionNop = 1;
+static constexpr uint8_t TCPOptionMSS = 2;           // RFC 9293
+static constexpr uint8_t TCPOptionWindowScale = 3;   // RFC 7323
+static constexpr uint8_t TCPOptionSACKPermitted = 4; // RFC 2018
+static constexpr uint8_t TCPOptionSACK = 5;          // RFC 2018
+
 using namespace std;
 
+namespace {
+
+// Parse `length` bytes of options, keeping the MSS, window scale and SACK ones and skipping any others
+void parse_options( Parser& parser, size_t length, TCPMessage& message )
+{
+  while ( length > 0 and not parser.has_error() ) {
+    uint8_t kind {};
+    parser.integer( kind );
+    --length;
+    if ( kind == TCPOptionEnd ) {
+      break;
+    }
+    if ( kind == TCPOptionNop ) {
+      continue;
+    }
+
+    uint8_t option_length {};
+    parser.integer( option_length );
+    if ( length == 0 or option_length < 2 or option_length - 2U > length - 1 ) {
+      parser.set_error();
+      return;
+    }
+    const size_t body = option_length - 2U;
+    length -= 1 + body;
+
+    if ( kind == TCPOptionMSS and body == 2 ) {
+      parser.integer( message.sender.MSS );
+    } else if ( kind == TCPOptionWindowScale and body == 1 ) {
+      uint8_t shift {};
+      parser.integer( shift );
+      message.sender.window_scale = shift;
+    } else if ( kind == TCPOptionSACKPermitted and body == 0 ) {
+      message.sender.SACK_permitted = true;
+    } else if ( kind == TCPOptionSACK and body % 8 == 0 ) {
+      for ( size_t i = 0; i < body / 8; ++i ) {
+        uint32_t begin {};
+        uint32_t end {};
+        parser.integer( begin );
+        parser.integer( end );
+        message.receiver.sack_blocks.push_back( { Wrap32 { begin }, Wrap32 { end } } );
+      }
+    } else {
+      parser.remove_prefix( body );
+    }
+  }
+
+  // whatever follows the end-of-options marker is padding
+  parser.remove_prefix( length );
+}
+
+} // namespace
+
 void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum )
 {
   /* verify checksum */
@@ -47,11 +108,12 @@ void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum
   parser.integer( udinfo.cksum );
   parser.integer( raw16 ); // urgent pointer
 
-  // skip any options or anything extra in the header
+  // keep the MSS, window scale and SACK options, and skip any others or anything extra in the header
   if ( data_offset < TCPHeaderMinLen ) {
     parser.set_error();
+    return;
   }
-  parser.remove_prefix( data_offset * 4 - TCPHeaderMinLen * 4 );
+  parse_options( parser, data_offset * 4 - TCPHeaderMinLen * 4, message );
 
   parser.all_remaining( message.sender.payload );
 }
@@ -68,7 +130,14 @@ void TCPSegment::serialize( Serializer& serializer ) const
   serializer.integer( udinfo.dst_port );
   serializer.integer( Wrap32Serializable { message.sender.seqno }.raw_value() );
   serializer.integer( Wrap32Serializable { message.receiver.ackno.value_or( Wrap32 { 0 } ) }.raw_value() );
-  serializer.integer( uint8_t { TCPHeaderMinLen << 4 } ); // data offset
+  // the other options are preceded by NOPs, so the options stay 32-bit aligned
+  const bool mss = message.sender.SYN and message.sender.MSS;
+  const bool sack_permitted = message.sender.SYN and message.sender.SACK_permitted;
+  const bool window_scale = message.sender.SYN and message.sender.window_scale.has_value();
+  const size_t num_blocks = min( message.receiver.sack_blocks.size(), TCPReceiverMessage::MAX_SACK_BLOCKS );
+  const size_t options_length = ( mss ? 4 : 0 ) + ( sack_permitted ? 4 : 0 ) + ( window_scale ? 4 : 0 )
+                                + ( num_blocks ? 4 + 8 * num_blocks : 0 );
+  serializer.integer( static_cast<uint8_t>( ( TCPHeaderMinLen + options_length / 4 ) << 4 ) ); // data offset
   const bool reset = message.sender.RST or message.receiver.RST;
   const uint8_t flags = ( message.receiver.ackno.has_value() ? 0b0001'0000U : 0 ) | ( reset ? 0b0000'0100U : 0 )
                         | ( message.sender.SYN ? 0b0000'0010U : 0 ) | ( message.sender.FIN ? 0b0000'0001U : 0 );
@@ -76,6 +145,35 @@ void TCPSegment::serialize( Serializer& serializer ) const
   serializer.integer( message.receiver.window_size );
   serializer.integer( udinfo.cksum );
   serializer.integer( uint16_t { 0 } ); // urgent pointer
+
+  if ( mss ) {
+    serializer.integer( TCPOptionMSS );
+    serializer.integer( uint8_t { 4 } );
+    serializer.integer( message.sender.MSS );
+  }
+  if ( sack_permitted ) {
+    serializer.integer( TCPOptionNop );
+    serializer.integer( TCPOptionNop );
+    serializer.integer( TCPOptionSACKPermitted );
+    serializer.integer( uint8_t { 2 } );
+  }
+  if ( window_scale ) {
+    serializer.integer( TCPOptionNop );
+    serializer.integer( TCPOptionWindowScale );
+    serializer.integer( uint8_t { 3 } );
+    serializer.integer( message.sender.window_scale.value() );
+  }
+  if ( num_blocks ) {
+    serializer.integer( TCPOptionNop );
+    serializer.integer( TCPOptionNop );
+    serializer.integer( TCPOptionSACK );
+    serializer.integer( static_cast<uint8_t>( 2 + 8 * num_blocks ) );
+    for ( size_t i = 0; i < num_blocks; ++i ) {
+      serializer.integer( Wrap32Serializable { message.receiver.sack_blocks[i].begin }.raw_value() );
+      serializer.integer( Wrap32Serializable { message.receiver.sack_blocks[i].end }.raw_value() );
+    }
+  }
+
   serializer.buffer( message.sender.payload );
 }
 
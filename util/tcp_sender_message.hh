@@ -2,12 +2,14 @@
 
 #include "wrapping_integers.hh"
 
+#include <cstdint>
+#include <optional>
 #include <string>
 
 /*
  * The TCPSenderMessage structure contains the information sent from a TCP sender to its receiver.
  *
- * It contains five fields:
+ * It contains these fields:
  *
  * 1) The sequence number (seqno) of the beginning of the segment. If the SYN flag is set, this is the
  *    sequence number of the SYN flag. Otherwise, it's the sequence number of the beginning of the payload.
@@ -20,10 +22,24 @@
  * 4) The FIN flag. If set, the payload represents the ending of the byte stream.
  *
  * 5) The RST (reset) flag. If set, the stream has suffered an error and the connection should be aborted.
+ *
+ * 6) The SACK-permitted option (RFC 2018), only meaningful on a SYN: the sender understands selective
+ *    acknowledgments, so the receiver may send them.
+ *
+ * 7) The MSS option (0 if absent), only meaningful on a SYN: the largest payload the sender can receive in
+ *    one segment.
+ *
+ * 8) The window scale option (RFC 7323, absent if not offered), only meaningful on a SYN: the sender's own
+ *    receiver will shift the windows it advertises right by this many bits, once both SYNs have offered it.
+ *
+ * 9) The segment size, which is not sent: the largest payload per datagram when the message is wrapped for
+ *    the network (0 for TCPConfig::MAX_PAYLOAD_SIZE). A larger payload is split into several segments.
  */
 
 struct TCPSenderMessage
 {
+  static constexpr uint8_t MAX_WINDOW_SCALE = 14; // the window can't cover more than 1 GiB (RFC 7323)
+
   Wrap32 seqno { 0 };
 
   bool SYN {};
@@ -32,6 +48,12 @@ struct TCPSenderMessage
 
   bool RST {};
 
+  bool SACK_permitted {};
+  uint16_t MSS {};
+  std::optional<uint8_t> window_scale {};
+
+  uint64_t segment_size {};
+
   // How many sequence numbers does this segment use?
   size_t sequence_length() const { return SYN + payload.size() + FIN; }
 };
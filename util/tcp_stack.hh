@@ -0,0 +1,234 @@
+#pragma once
+
+#include "address.hh"
+#include "connection_table.hh"
+#include "eventloop.hh"
+#include "file_descriptor.hh"
+#include "four_tuple.hh"
+#include "ipv4_datagram.hh"
+#include "syn_cookies.hh"
+#include "tcp_config.hh"
+#include "tcp_peer.hh"
+#include "timer_wheel.hh"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+//! \brief Many TCP connections sharing one IPv4 interface
+//! \details Each datagram from the network is demultiplexed by its 4-tuple, through a ConnectionTable, to the
+//! TCPPeer for its connection, and a SYN to a listening port makes a new connection. What the TCPPeers send
+//! goes out through one OutputPort (as a NetworkInterface's frames do), so a single event loop can serve
+//! thousands of connections: see TCPStackLoop.
+//!
+//! A connection made by a listener is half-open until the handshake's last ACK arrives; then it waits in the
+//! listener's accept queue. Both are bounded: a SYN that finds the half-open table full is dropped, and a
+//! handshake that finds the accept queue full stays half-open until accept() makes room. A half-open
+//! connection that fails (a RST, or too many SYN-ACKs unanswered) is forgotten. With TCPConfig::syn_cookies,
+//! a SYN that finds the half-open table full is answered with a SYN cookie instead, and the connection is
+//! made (straight into the accept queue) only when the last ACK of the handshake brings the cookie back.
+//!
+//! Once accepted, or opened by connect(), a connection belongs to the application, and stays in the table
+//! until the application has closed it and it is no longer active. So the application can read everything
+//! that arrived, and its ConnectionID stays valid until then.
+//!
+//! Time reaches a connection only when it has work to do: each one's next timer (a retransmission, a paced or
+//! delayed-ACK segment, the end of lingering) waits in one TimerWheel, and tick() runs just the connections
+//! whose timers expire. The rest catch up on the time that has passed when a segment or a call reaches them.
+class TCPStack
+{
+public:
+  //! Where the TCPStack sends its datagrams
+  class OutputPort
+  {
+  public:
+    virtual void transmit( const TCPStack& sender, const InternetDatagram& dgram ) = 0;
+    virtual ~OutputPort() = default;
+  };
+
+  using ConnectionID = uint32_t;
+
+  struct Stats
+  {
+    uint64_t bad_datagrams {};      //!< Not TCP to our address, or didn't parse
+    uint64_t unmatched_segments {}; //!< For no connection, and not a SYN to a listening port
+    uint64_t syn_drops {};          //!< SYNs to a listener whose half-open table was full
+    uint64_t syn_cookies_sent {};   //!< SYN-ACKs sent with a cookie, for SYNs that found the table full
+    uint64_t syn_cookies_valid {};  //!< ACKs that brought a cookie back (and made a connection)
+  };
+
+  //! Default bound on a listener's half-open connections, and on its accept queue
+  static constexpr size_t DEFAULT_BACKLOG = 128;
+
+  //! The first and last of the ports that connect() picks from
+  static constexpr uint16_t EPHEMERAL_PORT_MIN = 49152;
+  static constexpr uint16_t EPHEMERAL_PORT_MAX = 65535;
+
+  TCPStack( std::shared_ptr<OutputPort> port, const Address& ip_address );
+
+  //! Open a connection to `remote` from an unused ephemeral port, and send the SYN. Every connection gets a
+  //! random initial sequence number, whatever `cfg.isn` says.
+  ConnectionID connect( const Address& remote, const TCPConfig& cfg );
+
+  //! Listen on `port`: a SYN to it makes a new connection, configured with `cfg`, unless `syn_backlog`
+  //! connections are already half-open. At most `accept_backlog` established connections wait for accept().
+  //! (A runtime_error if something already listens on `port`.)
+  void listen( uint16_t port,
+               const TCPConfig& cfg,
+               size_t syn_backlog = DEFAULT_BACKLOG,
+               size_t accept_backlog = DEFAULT_BACKLOG );
+
+  //! Take the next established connection from `port`'s accept queue, if there is one
+  std::optional<ConnectionID> accept( uint16_t port );
+
+  //! How many of `port`'s connections are half-open, and how many wait in its accept queue
+  size_t half_open_count( uint16_t port ) const { return listener( port ).half_open; }
+  size_t accept_queue_length( uint16_t port ) const { return listener( port ).accept_queue.size(); }
+
+  //! Demultiplex a datagram from the network to its connection
+  void receive( const InternetDatagram& dgram );
+
+  //! Send what the application has written to a connection's outbound stream
+  void push( ConnectionID id );
+
+  //! The application is done with a connection: finish its outbound stream. The connection is forgotten (and
+  //! its ConnectionID reused) once it is no longer active.
+  void close( ConnectionID id );
+
+  //! Time has passed: run the connections whose timers expire. One that has retransmitted more than
+  //! MAX_RETX_ATTEMPTS times in a row is aborted: both its streams get an error.
+  void tick( uint64_t ms_since_last_tick );
+
+  //! How long until tick() has a connection to run (nothing if no connection has a timer)
+  std::optional<uint64_t> ms_until_next_timer() const;
+
+  //! \name
+  //! Access a connection (a runtime_error if there is none with that ID)
+
+  //!@{
+  TCPPeer& peer( ConnectionID id ) { return connection( id ).peer; }
+  const TCPPeer& peer( ConnectionID id ) const { return connection( id ).peer; }
+  const FourTuple& tuple( ConnectionID id ) const { return connection( id ).tuple; }
+  //!@}
+
+  bool contains( ConnectionID id ) const { return id < connections_.size() and connections_[id]; }
+  size_t connection_count() const { return table_.size(); }
+  const Stats& stats() const { return stats_; }
+  uint32_t ip_address() const { return ip_address_; }
+
+private:
+  static constexpr uint64_t NEVER = UINT64_MAX;
+
+  struct Connection
+  {
+    FourTuple tuple;
+    TCPPeer peer;
+    std::optional<uint16_t> listener {}; // the listening port that made it, until the application accepts it
+    bool queued {};                      // established, and waiting in the listener's accept queue
+    bool waiting {};                     // established, and waiting for room in the accept queue
+    bool closed {};                      // by the application
+    uint64_t ticked_at {};               // the time the peer has been told of
+    uint64_t deadline = NEVER;           // of its timer, armed in the wheel
+    TimerWheel<ConnectionID>::TimerID timer {};
+  };
+
+  struct Listener
+  {
+    TCPConfig cfg;
+    size_t syn_backlog;
+    size_t accept_backlog;
+    size_t half_open {};
+    std::queue<ConnectionID> accept_queue {};
+    std::queue<ConnectionID> waiting {}; // for room in the accept queue
+  };
+
+  std::shared_ptr<OutputPort> port_;
+  uint32_t ip_address_;
+  std::default_random_engine rd_;
+  ConnectionTable<ConnectionID> table_;
+  std::vector<std::unique_ptr<Connection>> connections_ {}; // indexed by ConnectionID (null when unused)
+  std::vector<ConnectionID> free_ids_ {};
+  std::unordered_map<uint16_t, Listener> listeners_ {};
+  SYNCookies cookies_;
+  uint64_t now_ms_ {}; // the time that has passed
+  TimerWheel<ConnectionID> timers_ {};
+  Stats stats_ {};
+
+  Connection& connection( ConnectionID id );
+  const Connection& connection( ConnectionID id ) const;
+  Listener& listener( uint16_t port );
+  const Listener& listener( uint16_t port ) const;
+
+  //! Add a connection to the table
+  ConnectionID add( const FourTuple& tuple, TCPConfig cfg, Wrap32 isn );
+  Wrap32 random_isn() { return Wrap32 { std::uniform_int_distribution<uint32_t> {}( rd_ ) }; }
+
+  //! A segment for no connection, to a listening port: a SYN makes a half-open connection (or, with SYN
+  //! cookies and the table full, gets a SYN-ACK with a cookie), and an ACK that brings back a cookie makes an
+  //! established one. Returns the connection the segment is for, if there is one now.
+  std::optional<ConnectionID> open_passive( const FourTuple& tuple, Listener& l, const TCPMessage& msg );
+
+  //! Answer a SYN with a SYN-ACK whose ISN is a cookie, keeping no state
+  void send_cookie( const FourTuple& tuple, const TCPConfig& cfg, const TCPSenderMessage& syn );
+
+  //! Rebuild the connection that a valid cookie's ACK finishes, as if the SYN had been received and answered
+  std::optional<ConnectionID> open_from_cookie( const FourTuple& tuple, Listener& l, const TCPMessage& ack );
+
+  //! The function a connection's TCPPeer sends its messages with
+  TCPPeer::TransmitFunction transmit_for( const FourTuple& tuple );
+
+  //! Before a connection's segment or call: tell its peer the time that has passed since its last tick
+  void catch_up( Connection& c );
+
+  //! After a connection's segment, tick or call: advance its handshake or reap it, and if it's still there,
+  //! arm its timer for the next time it has work to do
+  void settle( ConnectionID id );
+
+  //! After a half-open connection's segment or tick: move it to the accept queue if its handshake is done
+  //! (and there's room), or forget it if it failed
+  void advance_handshake( ConnectionID id );
+
+  //! After an application's connection's segment or tick: forget it if the application has closed it and
+  //! it's no longer active
+  void reap( ConnectionID id );
+
+  void schedule( ConnectionID id );
+
+  void forget( ConnectionID id );
+};
+
+//! \brief A TCPStack on a file descriptor that carries IPv4 datagrams (a TUN device, or a datagram socket),
+//! driven by an EventLoop that the application can add its own rules to
+class TCPStackLoop
+{
+  class FdOutputPort : public TCPStack::OutputPort
+  {
+    FileDescriptor fd_;
+
+  public:
+    explicit FdOutputPort( FileDescriptor&& fd ) : fd_( std::move( fd ) ) {}
+    void transmit( const TCPStack& sender, const InternetDatagram& dgram ) override;
+  };
+
+  FileDescriptor fd_;
+  TCPStack stack_;
+  EventLoop eventloop_ {};
+  uint64_t last_tick_ms_;
+
+  //! Read the datagrams waiting on the file descriptor, and hand them to the stack
+  void read_datagrams();
+
+public:
+  TCPStackLoop( FileDescriptor&& fd, const Address& ip_address );
+
+  TCPStack& stack() { return stack_; }
+  EventLoop& eventloop() { return eventloop_; }
+
+  //! Handle whatever happens within `timeout_ms` (or until a connection's timer expires, if that's sooner),
+  //! then tell the stack how much time has passed
+  EventLoop::Result wait_next_event( int timeout_ms );
+};
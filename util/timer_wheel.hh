@@ -0,0 +1,281 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+//! \brief A hierarchical timing wheel (Varghese and Lauck, as in Linux): many timers, each armed and cancelled
+//! in O(1), with a value that comes back when it expires
+//! \details Time is in whole milliseconds. Level 0 has a slot for each of the next 256 ms; each level above has
+//! 64 slots, and each of its slots spans a whole turn of the level below, so five levels reach 2^32 ms (about
+//! 50 days) ahead. (A timer further out waits on the top level, and goes round again.) A timer waits in the
+//! slot for its deadline on the lowest level that reaches it, and moves down (cascades) when the level below
+//! turns over to that slot. So advancing the time touches only the timers that expire, and each timer once for
+//! every level it moves down, and stretches with no timers are skipped.
+template<class Value>
+class TimerWheel
+{
+public:
+  //! Identifies an armed timer. Cancelling it after it has expired (or been cancelled) does nothing.
+  struct TimerID
+  {
+    uint32_t index = NONE;
+    uint32_t generation = 0;
+  };
+
+  //! A wheel whose time is `now_ms`
+  explicit TimerWheel( uint64_t now_ms = 0 ) : next_ms_( now_ms + 1 ) {}
+
+  //! Arm a timer that expires at `deadline_ms`, or at the next millisecond if that time has already come
+  TimerID arm( uint64_t deadline_ms, Value value )
+  {
+    uint32_t index = free_;
+    if ( index == NONE ) {
+      index = static_cast<uint32_t>( nodes_.size() );
+      nodes_.emplace_back();
+    } else {
+      free_ = nodes_[index].next;
+    }
+    Node& node = nodes_[index];
+    node.value = std::move( value );
+    node.deadline = deadline_ms < next_ms_ ? next_ms_ : deadline_ms;
+    place( index );
+    ++size_;
+    return { index, node.generation };
+  }
+
+  //! Cancel a timer that hasn't expired yet
+  void cancel( TimerID id )
+  {
+    if ( not armed( id ) ) {
+      return;
+    }
+    unlink( id.index );
+    release( id.index );
+  }
+
+  bool armed( TimerID id ) const
+  {
+    return id.index < nodes_.size() and nodes_[id.index].generation == id.generation
+           and nodes_[id.index].slot != NONE;
+  }
+
+  //! Move the time forward to `now_ms`, calling `expire( value )` for each timer whose deadline has come, in
+  //! order of deadline. `expire` may arm and cancel timers (one it arms for a time that has come expires at the
+  //! next millisecond).
+  template<class Expire>
+  void advance_to( uint64_t now_ms, Expire&& expire )
+  {
+    while ( next_ms_ <= now_ms ) {
+      const std::optional<uint64_t> next = next_change();
+      if ( not next.has_value() or *next > now_ms ) {
+        next_ms_ = now_ms + 1;
+        return;
+      }
+      next_ms_ = *next;
+      cascade();
+
+      // the slot's timers move to a list of their own, so that any armed meanwhile wait for the next turn
+      move_slot( next_ms_ & LEVEL0_MASK, EXPIRING );
+      ++next_ms_;
+      while ( heads_[EXPIRING] != NONE ) {
+        const uint32_t index = heads_[EXPIRING];
+        unlink( index );
+        Value value = std::move( nodes_[index].value );
+        release( index );
+        expire( std::move( value ) );
+      }
+    }
+  }
+
+  //! The earliest time that advance_to() could expire a timer: the first deadline once its timer is on level 0,
+  //! and otherwise when the next timers cascade down (earlier). Nothing if no timer is armed.
+  std::optional<uint64_t> next_deadline() const { return next_change(); }
+
+  uint64_t now() const { return next_ms_ - 1; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+private:
+  static constexpr uint32_t NONE = UINT32_MAX;
+  static constexpr unsigned LEVEL0_BITS = 8;
+  static constexpr unsigned LEVEL_BITS = 6;
+  static constexpr unsigned UPPER_LEVELS = 4;
+  static constexpr uint64_t LEVEL0_SLOTS = 1 << LEVEL0_BITS;
+  static constexpr uint64_t LEVEL_SLOTS = 1 << LEVEL_BITS;
+  static constexpr uint64_t LEVEL0_MASK = LEVEL0_SLOTS - 1;
+  static constexpr uint64_t LEVEL_MASK = LEVEL_SLOTS - 1;
+  static constexpr uint64_t HORIZON = uint64_t { 1 } << ( LEVEL0_BITS + UPPER_LEVELS * LEVEL_BITS );
+  static constexpr size_t SLOTS = LEVEL0_SLOTS + UPPER_LEVELS * LEVEL_SLOTS;
+  static constexpr uint32_t EXPIRING = SLOTS; // the list of timers that advance_to() is expiring
+
+  struct Node
+  {
+    Value value {};
+    uint64_t deadline {};
+    uint32_t prev = NONE;
+    uint32_t next = NONE; // (the next free node, when it's free)
+    uint32_t slot = NONE; // NONE when free
+    uint32_t generation = 0;
+  };
+
+  std::vector<Node> nodes_ {};
+  uint32_t free_ = NONE;
+  std::array<uint32_t, SLOTS + 1> heads_ = make_heads();
+  // which slots have timers: 4 words for level 0, then one for each level above
+  std::array<uint64_t, LEVEL0_SLOTS / 64> level0_occupied_ {};
+  std::array<uint64_t, UPPER_LEVELS> occupied_ {};
+  uint64_t next_ms_; // the first millisecond that hasn't been advanced through
+  size_t size_ {};
+
+  static constexpr std::array<uint32_t, SLOTS + 1> make_heads()
+  {
+    std::array<uint32_t, SLOTS + 1> heads {};
+    heads.fill( NONE );
+    return heads;
+  }
+
+  static unsigned shift( unsigned level ) { return LEVEL0_BITS + ( level - 1 ) * LEVEL_BITS; }
+
+  // put a timer in the slot for its deadline, on the lowest level that reaches it
+  void place( uint32_t index )
+  {
+    uint64_t deadline = nodes_[index].deadline;
+    if ( deadline - next_ms_ >= HORIZON ) {
+      deadline = next_ms_ + HORIZON - 1;
+    }
+    const uint64_t delta = deadline - next_ms_;
+    if ( delta < LEVEL0_SLOTS ) {
+      link( index, static_cast<uint32_t>( deadline & LEVEL0_MASK ) );
+      return;
+    }
+    unsigned level = 1;
+    while ( delta >> shift( level + 1 ) != 0 ) {
+      ++level;
+    }
+    link( index, static_cast<uint32_t>( upper_slot( level, deadline >> shift( level ) & LEVEL_MASK ) ) );
+  }
+
+  bool at_turn( unsigned level ) const { return ( next_ms_ & ( ( uint64_t { 1 } << shift( level ) ) - 1 ) ) == 0; }
+
+  static size_t upper_slot( unsigned level, uint64_t i ) { return LEVEL0_SLOTS + ( level - 1 ) * LEVEL_SLOTS + i; }
+
+  void link( uint32_t index, uint32_t slot )
+  {
+    Node& node = nodes_[index];
+    node.slot = slot;
+    node.prev = NONE;
+    node.next = heads_[slot];
+    if ( node.next != NONE ) {
+      nodes_[node.next].prev = index;
+    }
+    heads_[slot] = index;
+    mark( slot, true );
+  }
+
+  void unlink( uint32_t index )
+  {
+    Node& node = nodes_[index];
+    if ( node.prev != NONE ) {
+      nodes_[node.prev].next = node.next;
+    } else {
+      heads_[node.slot] = node.next;
+      if ( node.next == NONE ) {
+        mark( node.slot, false );
+      }
+    }
+    if ( node.next != NONE ) {
+      nodes_[node.next].prev = node.prev;
+    }
+    node.slot = NONE;
+  }
+
+  void release( uint32_t index )
+  {
+    Node& node = nodes_[index];
+    node.value = Value {};
+    ++node.generation;
+    node.next = free_;
+    free_ = index;
+    --size_;
+  }
+
+  void mark( uint32_t slot, bool occupied )
+  {
+    if ( slot == EXPIRING ) {
+      return;
+    }
+    uint64_t& word = slot < LEVEL0_SLOTS ? level0_occupied_[slot / 64] : occupied_[( slot - LEVEL0_SLOTS ) / 64];
+    const uint64_t bit = uint64_t { 1 } << ( slot % 64 );
+    word = occupied ? word | bit : word & ~bit;
+  }
+
+  void move_slot( uint64_t from, uint32_t to )
+  {
+    const auto slot = static_cast<uint32_t>( from );
+    for ( uint32_t index = heads_[slot]; index != NONE; index = nodes_[index].next ) {
+      nodes_[index].slot = to;
+    }
+    heads_[to] = heads_[slot];
+    heads_[slot] = NONE;
+    mark( slot, false );
+  }
+
+  // when the time reaches a turn of a level, the next slot of each level above moves down
+  void cascade()
+  {
+    for ( unsigned level = 1; level <= UPPER_LEVELS and at_turn( level ); ++level ) {
+      const size_t slot = upper_slot( level, next_ms_ >> shift( level ) & LEVEL_MASK );
+      uint32_t index = heads_[slot];
+      heads_[slot] = NONE;
+      mark( static_cast<uint32_t>( slot ), false );
+      while ( index != NONE ) {
+        const uint32_t next = nodes_[index].next;
+        place( index );
+        index = next;
+      }
+    }
+  }
+
+  // the first time from next_ms_ on when a level-0 slot expires or an upper slot cascades
+  std::optional<uint64_t> next_change() const
+  {
+    if ( size_ == 0 ) {
+      return {};
+    }
+    std::optional<uint64_t> next;
+    const auto consider = [&]( uint64_t t ) { next = next.has_value() and *next < t ? *next : t; };
+
+    const uint64_t start = next_ms_ & LEVEL0_MASK;
+    for ( uint64_t offset = 0; offset < LEVEL0_SLOTS; ) {
+      const uint64_t slot = ( start + offset ) & LEVEL0_MASK;
+      const uint64_t bits = level0_occupied_[slot / 64] >> ( slot % 64 );
+      if ( bits != 0 ) {
+        const uint64_t found = slot + static_cast<uint64_t>( std::countr_zero( bits ) );
+        consider( next_ms_ + ( ( found - start ) & LEVEL0_MASK ) );
+        break;
+      }
+      offset += 64 - slot % 64;
+    }
+
+    for ( unsigned level = 1; level <= UPPER_LEVELS; ++level ) {
+      const unsigned s = shift( level );
+      const uint64_t current = next_ms_ >> s;
+      uint64_t bits = std::rotr( occupied_[level - 1], static_cast<int>( current & LEVEL_MASK ) );
+      if ( bits == 0 ) {
+        continue;
+      }
+      // the current slot cascades now if the time is at its turn, and otherwise a whole turn from now
+      uint64_t offset = static_cast<uint64_t>( std::countr_zero( bits ) );
+      if ( offset == 0 and not at_turn( level ) ) {
+        bits &= ~uint64_t { 1 };
+        offset = bits == 0 ? LEVEL_SLOTS : static_cast<uint64_t>( std::countr_zero( bits ) );
+      }
+      consider( ( current + offset ) << s );
+    }
+    return next;
+  }
+};